@@ -109,6 +109,8 @@ static int32 ClickChangeDateCheat(int32 p1, int32 p2)
 
 	Date new_date = ConvertYMDToDate(p1, ymd.month, ymd.day);
 	LinkGraphSchedule::instance.ShiftDates(new_date - _date);
+	/* Finish the work of a period that is being spread over the day; do not start it for a day on which no period started. */
+	_period_tick_date = _period_tick_date == _date ? new_date : INVALID_DATE;
 	SetDate(new_date, _date_fract);
 	EnginesMonthlyLoop();
 	SetWindowDirty(WC_STATUS_BAR, 0);
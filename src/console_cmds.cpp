@@ -29,6 +29,7 @@
 #include "strings_func.h"
 #include "viewport_func.h"
 #include "window_func.h"
+#include "window_gui.h"
 #include "date_func.h"
 #include "company_func.h"
 #include "gamelog.h"
@@ -38,6 +39,8 @@
 #include "console_func.h"
 #include "engine_base.h"
 #include "game/game.hpp"
+#include "spritecache.h"
+#include "gfx_layout.h"
 #include "table/strings.h"
 
 #include "safeguards.h"
@@ -1327,6 +1330,67 @@ DEF_CONSOLE_CMD(ConGetDate)
 	return true;
 }
 
+DEF_CONSOLE_CMD(ConSpriteCacheStats)
+{
+	if (argc == 0) {
+		IConsoleHelp("Show the statistics of the sprite cache. Usage: 'sprite_cache_stats [reset]'");
+		IConsoleHelp("  'reset' resets the hit, miss, eviction and prefetch counters after showing them.");
+		return true;
+	}
+
+	if (argc > 2 || (argc == 2 && strcmp(argv[1], "reset") != 0)) return false;
+
+	const SpriteCacheStats &stats = GetSpriteCacheStats();
+	uint64 requests = stats.hits + stats.misses;
+	IConsolePrintF(CC_DEFAULT, "Requests:   " OTTD_PRINTF64 " (" OTTD_PRINTF64 " hits, " OTTD_PRINTF64 " misses, hit rate %u%%)",
+			requests, stats.hits, stats.misses, requests == 0 ? 0 : (uint)(stats.hits * 100 / requests));
+	IConsolePrintF(CC_DEFAULT, "Evictions:  " OTTD_PRINTF64, stats.evictions);
+	IConsolePrintF(CC_DEFAULT, "Prefetched: " OTTD_PRINTF64, stats.prefetched);
+	IConsolePrintF(CC_DEFAULT, "Memory:     " PRINTF_SIZE " of " PRINTF_SIZE " KiB in use", stats.used / 1024, stats.budget / 1024);
+	IConsolePrintF(CC_DEFAULT, "Blocks:     %u slabs, %u large blocks", stats.slabs, stats.large_blocks);
+
+	if (argc == 2) ResetSpriteCacheStats();
+	return true;
+}
+
+DEF_CONSOLE_CMD(ConLineCacheStats)
+{
+	if (argc == 0) {
+		IConsoleHelp("Show the statistics of the text layout cache. Usage: 'linecache_stats [reset]'");
+		IConsoleHelp("  'reset' resets the hit, miss and eviction counters after showing them.");
+		return true;
+	}
+
+	if (argc > 2 || (argc == 2 && strcmp(argv[1], "reset") != 0)) return false;
+
+	const Layouter::LineCacheStats &stats = Layouter::GetLineCacheStats();
+	uint64 requests = stats.hits + stats.misses;
+	IConsolePrintF(CC_DEFAULT, "Requests:  " OTTD_PRINTF64 " (" OTTD_PRINTF64 " hits, " OTTD_PRINTF64 " misses, hit rate %u%%)",
+			requests, stats.hits, stats.misses, requests == 0 ? 0 : (uint)(stats.hits * 100 / requests));
+	IConsolePrintF(CC_DEFAULT, "Evictions: " OTTD_PRINTF64, stats.evictions);
+	IConsolePrintF(CC_DEFAULT, "Lines:     %u", stats.items);
+	IConsolePrintF(CC_DEFAULT, "Memory:    " PRINTF_SIZE " of " PRINTF_SIZE " KiB in use", stats.used / 1024, stats.budget / 1024);
+
+	if (argc == 2) Layouter::ResetLineCacheStats();
+	return true;
+}
+
+DEF_CONSOLE_CMD(ConWindowStats)
+{
+	if (argc == 0) {
+		IConsoleHelp("Show how often the windows of each type were invalidated and painted. Usage: 'window_stats [reset]'");
+		IConsoleHelp("  'reset' resets the counters after showing them.");
+		return true;
+	}
+
+	if (argc > 2 || (argc == 2 && strcmp(argv[1], "reset") != 0)) return false;
+
+	WindowDesc::PrintRedrawStats();
+
+	if (argc == 2) WindowDesc::ResetRedrawStats();
+	return true;
+}
+
 
 DEF_CONSOLE_CMD(ConAlias)
 {
@@ -1355,7 +1419,8 @@ DEF_CONSOLE_CMD(ConScreenShot)
 		IConsoleHelp("Create a screenshot of the game. Usage: 'screenshot [big | giant | no_con] [file name]'");
 		IConsoleHelp("'big' makes a zoomed-in screenshot of the visible area, 'giant' makes a screenshot of the "
 				"whole map, 'no_con' hides the console to create the screenshot. 'big' or 'giant' "
-				"screenshots are always drawn without console");
+				"screenshots are always drawn without console. 'giant' screenshots can also be made on a "
+				"dedicated server");
 		return true;
 	}
 
@@ -1390,6 +1455,27 @@ DEF_CONSOLE_CMD(ConScreenShot)
 	return true;
 }
 
+#if defined(WITH_PNG)
+DEF_CONSOLE_CMD(ConMapTiles)
+{
+	if (argc == 0) {
+		IConsoleHelp("Export the map as PNG tiles for web map viewers. Usage: 'map_tiles [full] [directory]'");
+		IConsoleHelp("The tiles are written as 'z/x/y.png' into the directory in the screenshot directory, 'maptiles' by default. "
+				"Only tiles that changed since the previous export are written, unless 'full' is given");
+		return true;
+	}
+
+	if (argc > 3) return false;
+
+	bool full = argc > 1 && strcmp(argv[1], "full") == 0;
+	if (argc == 3 && !full) return false;
+	const char *name = argc > (full ? 2 : 1) ? argv[argc - 1] : NULL;
+
+	if (!MakeMapTiles(name, full)) IConsoleError("Failed to write all map tiles");
+	return true;
+}
+#endif /* WITH_PNG */
+
 DEF_CONSOLE_CMD(ConInfoCmd)
 {
 	if (argc == 0) {
@@ -1915,11 +2001,17 @@ void IConsoleStdLibRegister()
 	IConsoleCmdRegister("restart",      ConRestart);
 	IConsoleCmdRegister("getseed",      ConGetSeed);
 	IConsoleCmdRegister("getdate",      ConGetDate);
+	IConsoleCmdRegister("sprite_cache_stats", ConSpriteCacheStats);
+	IConsoleCmdRegister("linecache_stats", ConLineCacheStats);
+	IConsoleCmdRegister("window_stats", ConWindowStats);
 	IConsoleCmdRegister("quit",         ConExit);
 	IConsoleCmdRegister("resetengines", ConResetEngines, ConHookNoNetwork);
 	IConsoleCmdRegister("reset_enginepool", ConResetEnginePool, ConHookNoNetwork);
 	IConsoleCmdRegister("return",       ConReturn);
 	IConsoleCmdRegister("screenshot",   ConScreenShot);
+#if defined(WITH_PNG)
+	IConsoleCmdRegister("map_tiles",    ConMapTiles);
+#endif /* WITH_PNG */
 	IConsoleCmdRegister("script",       ConScript);
 	IConsoleCmdRegister("scrollto",     ConScrollToTile);
 	IConsoleCmdRegister("alias",        ConAlias);
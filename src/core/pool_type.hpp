@@ -60,6 +60,24 @@ struct PoolBase {
 	 */
 	virtual void CleanPool() = 0;
 
+	/**
+	 * Get the name of the pool.
+	 * @return The name.
+	 */
+	virtual const char *GetName() const = 0;
+
+	/**
+	 * Get the number of items in the pool.
+	 * @return The number of items.
+	 */
+	virtual size_t GetNumItems() const = 0;
+
+	/**
+	 * Get the number of items the pool has allocated memory for.
+	 * @return The allocated size.
+	 */
+	virtual size_t GetAllocatedSize() const = 0;
+
 private:
 	/**
 	 * Dummy private copy constructor to prevent compilers from
@@ -102,6 +120,10 @@ struct Pool : PoolBase {
 	Pool(const char *name);
 	virtual void CleanPool();
 
+	virtual const char *GetName() const { return this->name; }
+	virtual size_t GetNumItems() const { return this->items; }
+	virtual size_t GetAllocatedSize() const { return this->size; }
+
 	/**
 	 * Returns Titem with given index
 	 * @param index of item to get
@@ -319,4 +341,9 @@ private:
 
 #define FOR_ALL_ITEMS(type, iter, var) FOR_ALL_ITEMS_FROM(type, iter, var, 0)
 
+/** Loop over every \a step th item of a pool, starting with the item at index \a start. */
+#define FOR_ALL_ITEMS_STEP(type, iter, var, start, step) \
+	for (size_t iter = start; var = NULL, iter < type::GetPoolSize(); iter += step) \
+		if ((var = type::Get(iter)) != NULL)
+
 #endif /* POOL_TYPE_HPP */
@@ -28,6 +28,7 @@ Month     _cur_month;  ///< Current month (0..11)
 Date      _date;       ///< Current date in days (day counter)
 DateFract _date_fract; ///< Fractional part of the day.
 uint16 _tick_counter;  ///< Ever incrementing (and sometimes wrapping) tick counter for setting off various events
+Date _period_tick_date; ///< First day of the month whose monthly/yearly work is spread over its ticks; only the day on which #OnNewMonth ran.
 
 /**
  * Set the date.
@@ -165,14 +166,15 @@ extern void IndustryDailyLoop();
 
 extern void CompaniesMonthlyLoop();
 extern void EnginesMonthlyLoop();
-extern void TownsMonthlyLoop();
 extern void IndustryMonthlyLoop();
 extern void StationMonthlyLoop();
 extern void SubsidyMonthlyLoop();
+extern void TownsMonthlyTick();
+extern void IndustryMonthlyTick();
 
 extern void CompaniesYearlyLoop();
-extern void VehiclesYearlyLoop();
-extern void TownsYearlyLoop();
+extern void VehiclesYearlyTick();
+extern void TownsYearlyTick();
 
 extern void ShowEndGameChart();
 
@@ -192,8 +194,6 @@ static const Month _autosave_months[] = {
 static void OnNewYear()
 {
 	CompaniesYearlyLoop();
-	VehiclesYearlyLoop();
-	TownsYearlyLoop();
 	InvalidateWindowClassesData(WC_BUILD_STATION);
 #ifdef ENABLE_NETWORK
 	if (_network_server) NetworkServerYearlyLoop();
@@ -240,7 +240,6 @@ static void OnNewMonth()
 	SetWindowClassesDirty(WC_CHEATS);
 	CompaniesMonthlyLoop();
 	EnginesMonthlyLoop();
-	TownsMonthlyLoop();
 	IndustryMonthlyLoop();
 	SubsidyMonthlyLoop();
 	StationMonthlyLoop();
@@ -269,20 +268,10 @@ static void OnNewDay()
 }
 
 /**
- * Increases the tick counter, increases date  and possibly calls
- * procedures that have to be called daily, monthly or yearly.
+ * Increases the date and calls the daily, monthly and yearly loops.
  */
-void IncreaseDate()
+static void OnNewDate()
 {
-	/* increase day, and check if a new day is there? */
-	_tick_counter++;
-
-	if (_game_mode == GM_MENU) return;
-
-	_date_fract++;
-	if (_date_fract < DAY_TICKS) return;
-	_date_fract = 0;
-
 	/* increase day counter */
 	_date++;
 
@@ -307,4 +296,50 @@ void IncreaseDate()
 
 	/* yes, call various yearly loops */
 	if (new_year) OnNewYear();
+
+	/* The rest of the work of the new period is spread over this day; the yearly loop might have moved the date. */
+	if (new_month) _period_tick_date = _date;
+}
+
+/**
+ * Runs the part of the monthly and yearly procedures that is done per town,
+ * industry, vehicle or tile. Instead of doing all of it in the tick the month
+ * or year starts, it is spread over the ticks of the first day of the period.
+ * This is only done on a day on which #OnNewMonth ran, so not on the first
+ * day of a new game or on a first day reached by changing the date.
+ */
+static void OnPeriodTick()
+{
+	if (_date != _period_tick_date) return;
+
+	YearMonthDay ymd;
+	ConvertDateToYMD(_date, &ymd);
+
+	TownsMonthlyTick();
+	IndustryMonthlyTick();
+
+	if (ymd.month != 0) return;
+
+	VehiclesYearlyTick();
+	TownsYearlyTick();
+}
+
+/**
+ * Increases the tick counter, increases date  and possibly calls
+ * procedures that have to be called daily, monthly or yearly.
+ */
+void IncreaseDate()
+{
+	/* increase day, and check if a new day is there? */
+	_tick_counter++;
+
+	if (_game_mode == GM_MENU) return;
+
+	_date_fract++;
+	if (_date_fract >= DAY_TICKS) {
+		_date_fract = 0;
+		OnNewDate();
+	}
+
+	OnPeriodTick();
 }
@@ -19,6 +19,7 @@ extern Month     _cur_month;
 extern Date      _date;
 extern DateFract _date_fract;
 extern uint16 _tick_counter;
+extern Date      _period_tick_date;
 
 void SetDate(Date date, DateFract fract);
 void ConvertDateToYMD(Date date, YearMonthDay *ymd);
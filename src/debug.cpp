@@ -18,6 +18,11 @@
 #include "settings_type.h"
 
 #include <time.h>
+#if defined(WIN32)
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
 
 #if defined(ENABLE_NETWORK)
 #include "network/network_admin.h"
@@ -248,6 +253,27 @@ const char *GetDebugString()
 	return dbgstr;
 }
 
+/**
+ * Get a timestamp for measuring how long something takes, e.g. when profiling.
+ * Only the difference between two timestamps has a meaning.
+ * @return The current time in microseconds.
+ */
+uint64 GetPerformanceTimer()
+{
+#if defined(WIN32)
+	static LARGE_INTEGER frequency = { 0 };
+	if (frequency.QuadPart == 0) QueryPerformanceFrequency(&frequency);
+
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	return (uint64)now.QuadPart * 1000000 / (uint64)frequency.QuadPart;
+#else
+	struct timeval tim;
+	gettimeofday(&tim, NULL);
+	return (uint64)tim.tv_sec * 1000000 + tim.tv_usec;
+#endif
+}
+
 /**
  * Get the prefix for logs; if show_date_in_logs is enabled it returns
  * the date, otherwise it returns nothing.
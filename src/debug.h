@@ -102,6 +102,8 @@ const char *GetDebugString();
 	}\
 }
 
+uint64 GetPerformanceTimer();
+
 void ShowInfo(const char *str);
 void CDECL ShowInfoF(const char *str, ...) WARN_FORMAT(1, 2);
 
@@ -101,39 +101,76 @@ Prices _price;
 Money _additional_cash_required;
 static PriceMultipliers _price_base_multiplier;
 
+/** Totals over the vehicles and stations of a company, for its value, rating and maintenance. */
+struct CompanyAggregates {
+	uint facilities;            ///< Number of facilities of the stations.
+	uint serviced_facilities;   ///< Number of facilities of the stations that were serviced recently.
+	Money airport_maintenance;  ///< Maintenance of the airports, with 3 bits fraction.
+	Money vehicle_value;        ///< Value of the vehicles, as counted for the company value.
+	uint profitable_vehicles;   ///< Number of primary vehicles that made a profit last year.
+	Money min_profit;           ///< Lowest profit last year of the primary vehicles older than two years.
+	bool has_min_profit;        ///< Whether there is a primary vehicle older than two years.
+
+	CompanyAggregates() : facilities(0), serviced_facilities(0), airport_maintenance(0), vehicle_value(0), profitable_vehicles(0), min_profit(0), has_min_profit(false) {}
+};
+
 /**
- * Calculate the value of the company. That is the value of all
- * assets (vehicles, stations, etc) and money minus the loan,
- * except when including_loan is \c false which is useful when
- * we want to calculate the value for bankruptcy.
- * @param c              the company to get the value of.
- * @param including_loan include the loan in the company value.
- * @return the value of the company.
+ * Gather the totals over the vehicles and stations of the companies.
+ * All companies are done in a single pass over the vehicles and stations,
+ * instead of one pass per company.
+ * @param aggregates The totals to add to, indexed by company.
+ * @param owner Only gather the totals of this company, or #INVALID_OWNER for all companies.
  */
-Money CalculateCompanyValue(const Company *c, bool including_loan)
+static void GatherCompanyAggregates(CompanyAggregates aggregates[MAX_COMPANIES], Owner owner)
 {
-	Owner owner = c->index;
-
-	Station *st;
-	uint num = 0;
-
+	const Station *st;
 	FOR_ALL_STATIONS(st) {
-		if (st->owner == owner) num += CountBits((byte)st->facilities);
-	}
+		if (owner == INVALID_OWNER ? !Company::IsValidID(st->owner) : st->owner != owner) continue;
 
-	Money value = num * _price[PR_STATION_VALUE] * 25;
+		CompanyAggregates &a = aggregates[st->owner];
+		uint facilities = CountBits((byte)st->facilities);
+		a.facilities += facilities;
+		/* Only count stations that are actually serviced */
+		if (st->time_since_load <= 20 || st->time_since_unload <= 20) a.serviced_facilities += facilities;
+		if (st->facilities & FACIL_AIRPORT) a.airport_maintenance += _price[PR_INFRASTRUCTURE_AIRPORT] * st->airport.GetSpec()->maintenance_cost;
+	}
 
-	Vehicle *v;
+	const Vehicle *v;
 	FOR_ALL_VEHICLES(v) {
-		if (v->owner != owner) continue;
+		if (owner == INVALID_OWNER ? !Company::IsValidID(v->owner) : v->owner != owner) continue;
 
+		CompanyAggregates &a = aggregates[v->owner];
 		if (v->type == VEH_TRAIN ||
 				v->type == VEH_ROAD ||
 				(v->type == VEH_AIRCRAFT && Aircraft::From(v)->IsNormalAircraft()) ||
 				v->type == VEH_SHIP) {
-			value += v->value * 3 >> 1;
+			a.vehicle_value += v->value * 3 >> 1;
+		}
+
+		if (IsCompanyBuildableVehicleType(v->type) && v->IsPrimaryVehicle()) {
+			if (v->profit_last_year > 0) a.profitable_vehicles++; // For the vehicle score only count profitable vehicles
+			if (v->age > 730) {
+				/* Find the vehicle with the lowest amount of profit */
+				if (!a.has_min_profit || a.min_profit > v->profit_last_year) {
+					a.min_profit = v->profit_last_year;
+					a.has_min_profit = true;
+				}
+			}
 		}
 	}
+}
+
+/**
+ * Calculate the value of the company from its totals.
+ * @param c              the company to get the value of.
+ * @param aggregates     the totals over the vehicles and stations of the company.
+ * @param including_loan include the loan in the company value.
+ * @return the value of the company.
+ */
+static Money CalculateCompanyValue(const Company *c, const CompanyAggregates &aggregates, bool including_loan)
+{
+	Money value = aggregates.facilities * _price[PR_STATION_VALUE] * 25;
+	value += aggregates.vehicle_value;
 
 	/* Add real money value */
 	if (including_loan) value -= c->current_loan;
@@ -142,15 +179,32 @@ Money CalculateCompanyValue(const Company *c, bool including_loan)
 	return max(value, (Money)1);
 }
 
+/**
+ * Calculate the value of the company. That is the value of all
+ * assets (vehicles, stations, etc) and money minus the loan,
+ * except when including_loan is \c false which is useful when
+ * we want to calculate the value for bankruptcy.
+ * @param c              the company to get the value of.
+ * @param including_loan include the loan in the company value.
+ * @return the value of the company.
+ */
+Money CalculateCompanyValue(const Company *c, bool including_loan)
+{
+	CompanyAggregates aggregates[MAX_COMPANIES];
+	GatherCompanyAggregates(aggregates, c->index);
+	return CalculateCompanyValue(c, aggregates[c->index], including_loan);
+}
+
 /**
  * if update is set to true, the economy is updated with this score
  *  (also the house is updated, should only be true in the on-tick event)
  * @param update the economy with calculated score
  * @param c company been evaluated
+ * @param aggregates the totals over the vehicles and stations of the company
  * @return actual score of this company
  *
  */
-int UpdateCompanyRatingAndValue(Company *c, bool update)
+static int UpdateCompanyRatingAndValue(Company *c, const CompanyAggregates &aggregates, bool update)
 {
 	Owner owner = c->index;
 	int score = 0;
@@ -159,28 +213,11 @@ int UpdateCompanyRatingAndValue(Company *c, bool update)
 
 	/* Count vehicles */
 	{
-		Vehicle *v;
-		Money min_profit = 0;
-		bool min_profit_first = true;
-		uint num = 0;
-
-		FOR_ALL_VEHICLES(v) {
-			if (v->owner != owner) continue;
-			if (IsCompanyBuildableVehicleType(v->type) && v->IsPrimaryVehicle()) {
-				if (v->profit_last_year > 0) num++; // For the vehicle score only count profitable vehicles
-				if (v->age > 730) {
-					/* Find the vehicle with the lowest amount of profit */
-					if (min_profit_first || min_profit > v->profit_last_year) {
-						min_profit = v->profit_last_year;
-						min_profit_first = false;
-					}
-				}
-			}
-		}
+		Money min_profit = aggregates.has_min_profit ? aggregates.min_profit : (Money)0;
 
 		min_profit >>= 8; // remove the fract part
 
-		_score_part[owner][SCORE_VEHICLES] = num;
+		_score_part[owner][SCORE_VEHICLES] = aggregates.profitable_vehicles;
 		/* Don't allow negative min_profit to show */
 		if (min_profit > 0) {
 			_score_part[owner][SCORE_MIN_PROFIT] = ClampToI32(min_profit);
@@ -189,14 +226,7 @@ int UpdateCompanyRatingAndValue(Company *c, bool update)
 
 	/* Count stations */
 	{
-		uint num = 0;
-		const Station *st;
-
-		FOR_ALL_STATIONS(st) {
-			/* Only count stations that are actually serviced */
-			if (st->owner == owner && (st->time_since_load <= 20 || st->time_since_unload <= 20)) num += CountBits((byte)st->facilities);
-		}
-		_score_part[owner][SCORE_STATIONS] = num;
+		_score_part[owner][SCORE_STATIONS] = aggregates.serviced_facilities;
 	}
 
 	/* Generate statistics depending on recent income statistics */
@@ -274,13 +304,40 @@ int UpdateCompanyRatingAndValue(Company *c, bool update)
 	if (update) {
 		c->old_economy[0].performance_history = score;
 		UpdateCompanyHQ(c->location_of_HQ, score);
-		c->old_economy[0].company_value = CalculateCompanyValue(c);
+		c->old_economy[0].company_value = CalculateCompanyValue(c, aggregates, true);
 	}
 
 	SetWindowDirty(WC_PERFORMANCE_DETAIL, 0);
 	return score;
 }
 
+/**
+ * Calculate the performance rating of a company.
+ * @param c company been evaluated
+ * @param update the economy with calculated score
+ * @return actual score of this company
+ */
+int UpdateCompanyRatingAndValue(Company *c, bool update)
+{
+	CompanyAggregates aggregates[MAX_COMPANIES];
+	GatherCompanyAggregates(aggregates, c->index);
+	return UpdateCompanyRatingAndValue(c, aggregates[c->index], update);
+}
+
+/**
+ * Calculate the performance rating of all companies, walking all vehicles
+ * and stations only once instead of once for every company.
+ * @param update the economy with calculated score
+ */
+void UpdateAllCompanyRatingsAndValues(bool update)
+{
+	CompanyAggregates aggregates[MAX_COMPANIES];
+	GatherCompanyAggregates(aggregates, INVALID_OWNER);
+
+	Company *c;
+	FOR_ALL_COMPANIES(c) UpdateCompanyRatingAndValue(c, aggregates[c->index], update);
+}
+
 /**
  * Change the ownership of all the items of a company.
  * @param old_owner The company that gets removed.
@@ -488,9 +545,11 @@ void ChangeOwnershipOfCompanyItems(Owner old_owner, Owner new_owner)
 	/*  Change ownership of tiles */
 	{
 		TileIndex tile = 0;
+		FlushSignalBlockCache();
 		do {
 			ChangeTileOwner(tile, old_owner, new_owner);
 		} while (++tile != MapSize());
+		FlushSignalBlockCache();
 
 		if (new_owner != INVALID_OWNER) {
 			/* Update all signals because there can be new segment that was owned by two companies
@@ -667,6 +726,9 @@ static void CompaniesGenStatistics()
 		}
 	} else {
 		/* Improved monthly infrastructure costs. */
+		CompanyAggregates aggregates[MAX_COMPANIES];
+		GatherCompanyAggregates(aggregates, INVALID_OWNER);
+
 		FOR_ALL_COMPANIES(c) {
 			cur_company.Change(c->index);
 
@@ -681,7 +743,8 @@ static void CompaniesGenStatistics()
 			}
 			cost.AddCost(CanalMaintenanceCost(c->infrastructure.water));
 			cost.AddCost(StationMaintenanceCost(c->infrastructure.station));
-			cost.AddCost(AirportMaintenanceCost(c->index));
+			/* 3 bits fraction for the maintenance cost factor. */
+			cost.AddCost(aggregates[c->index].airport_maintenance >> 3);
 
 			SubtractMoneyFromCompany(cost);
 		}
@@ -703,10 +766,11 @@ static void CompaniesGenStatistics()
 
 		if (c->num_valid_stat_ent != MAX_HISTORY_QUARTERS) c->num_valid_stat_ent++;
 
-		UpdateCompanyRatingAndValue(c, true);
 		if (c->block_preview != 0) c->block_preview--;
 	}
 
+	UpdateAllCompanyRatingsAndValues(true);
+
 	SetWindowDirty(WC_INCOME_GRAPH, 0);
 	SetWindowDirty(WC_OPERATING_PROFIT, 0);
 	SetWindowDirty(WC_DELIVERED_CARGO, 0);
@@ -15,6 +15,7 @@
 #include "fios.h"
 #include "string_func.h"
 #include "tar_type.h"
+#include "thread/thread.h"
 #ifdef WIN32
 #include <windows.h>
 # define access _taccess
@@ -28,6 +29,12 @@
 #include <sys/stat.h>
 #include <algorithm>
 
+#if defined(UNIX) && !defined(__MORPHOS__) && !defined(__AMIGA__) && !defined(LIMITED_FDS)
+/** Slotted files are memory mapped, so their data can be read without going through the shared buffer. */
+#define FIO_MMAP
+#include <sys/mman.h>
+#endif
+
 #ifdef WITH_XDG_BASEDIR
 #include "basedir.h"
 #endif
@@ -37,6 +44,9 @@
 /** Size of the #Fio data buffer. */
 #define FIO_BUFFER_SIZE 512
 
+/** Largest file that is memory mapped when the address space is only 32 bits. */
+static const size_t FIO_MAX_MAPPED_SIZE_32BIT = 64 * 1024 * 1024;
+
 /** Structure for keeping several open files with just one data buffer. */
 struct Fio {
 	byte *buffer, *buffer_end;             ///< position pointer in local buffer and last valid byte of buffer
@@ -47,6 +57,13 @@ struct Fio {
 	byte buffer_start[FIO_BUFFER_SIZE];    ///< local buffer when read from file
 	const char *filenames[MAX_FILE_SLOTS]; ///< array of filenames we (should) have open
 	char *shortnames[MAX_FILE_SLOTS];      ///< array of short names for spriteloader's use
+	const byte *mapped[MAX_FILE_SLOTS];    ///< array of the memory mapped data of the files, or NULL when not mapped
+	size_t mapped_pos[MAX_FILE_SLOTS];     ///< array of positions in the files where the mapped data starts
+	size_t mapped_size[MAX_FILE_SLOTS];    ///< array of sizes of the mapped data
+#if defined(FIO_MMAP)
+	void *mappings[MAX_FILE_SLOTS];        ///< array of the (page aligned) memory mappings
+	size_t mapping_sizes[MAX_FILE_SLOTS];  ///< array of sizes of the memory mappings
+#endif /* FIO_MMAP */
 #if defined(LIMITED_FDS)
 	uint open_handles;                     ///< current amount of open handles
 	uint usage_count[MAX_FILE_SLOTS];      ///< count how many times this file has been opened
@@ -54,6 +71,7 @@ struct Fio {
 };
 
 static Fio _fio; ///< #Fio instance.
+static ThreadMutex *_fio_slots_mutex = NULL; ///< Mutex protecting the files and mappings of the slots against readers of the mapped data in other threads.
 
 /** Whether the working directory should be scanned. */
 static bool _do_scan_working_directory = true;
@@ -190,6 +208,87 @@ void FioReadBlock(void *ptr, size_t size)
 	_fio.pos += fread(ptr, 1, size, _fio.cur_fh);
 }
 
+/**
+ * Get direct access to the data of a slotted file, when it is memory mapped.
+ * The returned data stays valid until the slot is closed; threads other
+ * than the main thread must hold #FioLockSlots while using it.
+ * @param slot Slot number of the file.
+ * @param pos Absolute position in the file.
+ * @param[out] size Number of bytes that can be read from the returned data.
+ * @return The data at \a pos, or \c NULL when the file is not memory mapped.
+ */
+const byte *FioGetMappedData(uint8 slot, size_t pos, size_t *size)
+{
+	const byte *data = _fio.mapped[slot];
+	if (data == NULL || pos < _fio.mapped_pos[slot] || pos > _fio.mapped_pos[slot] + _fio.mapped_size[slot]) return NULL;
+
+	*size = _fio.mapped_pos[slot] + _fio.mapped_size[slot] - pos;
+	return data + (pos - _fio.mapped_pos[slot]);
+}
+
+/**
+ * Memory map the data of a slotted file read-only, when the platform supports it.
+ * @param slot Slot number of the file.
+ * @param pos Position in the file where its data starts; not at the start when the file is in a tar.
+ * @param size Size of the data of the file.
+ */
+static void FioMapFile(int slot, size_t pos, size_t size)
+{
+#if defined(FIO_MMAP)
+	if (size == 0) return;
+	/* Do not exhaust the address space of 32 bits systems. */
+	if (sizeof(size_t) < 8 && size > FIO_MAX_MAPPED_SIZE_32BIT) return;
+
+	/* The offset of a mapping must be a multiple of the page size. */
+	size_t page_size = sysconf(_SC_PAGESIZE);
+	size_t offset = pos - pos % page_size;
+	size_t length = pos + size - offset;
+	void *mapping = mmap(NULL, length, PROT_READ, MAP_SHARED, fileno(_fio.handles[slot]), offset);
+	if (mapping == MAP_FAILED) {
+		DEBUG(misc, 1, "Cannot memory map '%s'; reading it through the buffer instead", _fio.filenames[slot]);
+		return;
+	}
+
+	_fio.mappings[slot] = mapping;
+	_fio.mapping_sizes[slot] = length;
+	_fio.mapped[slot] = (const byte *)mapping + (pos - offset);
+	_fio.mapped_pos[slot] = pos;
+	_fio.mapped_size[slot] = size;
+#endif /* FIO_MMAP */
+}
+
+/**
+ * Remove the memory mapping of a slotted file.
+ * @param slot Slot number of the file.
+ */
+static void FioUnmapFile(int slot)
+{
+	if (_fio.mapped[slot] == NULL) return;
+
+#if defined(FIO_MMAP)
+	munmap(_fio.mappings[slot], _fio.mapping_sizes[slot]);
+	_fio.mappings[slot] = NULL;
+#endif /* FIO_MMAP */
+	_fio.mapped[slot] = NULL;
+}
+
+/**
+ * Keep the files of the slots and their memory mappings from being opened
+ * or closed, so another thread can read the mapped data. The position and
+ * the buffer of the Fio slot layer are not covered; they are only to be used
+ * by the main thread.
+ */
+void FioLockSlots()
+{
+	if (_fio_slots_mutex != NULL) _fio_slots_mutex->BeginCritical();
+}
+
+/** Allow the files of the slots to be opened and closed again. */
+void FioUnlockSlots()
+{
+	if (_fio_slots_mutex != NULL) _fio_slots_mutex->EndCritical();
+}
+
 /**
  * Close the file at the given slot number.
  * @param slot File index to close.
@@ -197,6 +296,9 @@ void FioReadBlock(void *ptr, size_t size)
 static inline void FioCloseFile(int slot)
 {
 	if (_fio.handles[slot] != NULL) {
+		FioLockSlots();
+		FioUnmapFile(slot);
+		FioUnlockSlots();
 		fclose(_fio.handles[slot]);
 
 		free(_fio.shortnames[slot]);
@@ -254,14 +356,21 @@ void FioOpenFile(int slot, const char *filename, Subdirectory subdir)
 #if defined(LIMITED_FDS)
 	FioFreeHandle();
 #endif /* LIMITED_FDS */
-	f = FioFOpenFile(filename, "rb", subdir);
+	size_t size;
+	f = FioFOpenFile(filename, "rb", subdir, &size);
 	if (f == NULL) usererror("Cannot open file '%s'", filename);
 	long pos = ftell(f);
 	if (pos < 0) usererror("Cannot read file '%s'", filename);
 
+	/* The first files are opened at start up by the main thread, before any other thread is started. */
+	if (_fio_slots_mutex == NULL) _fio_slots_mutex = ThreadMutex::New();
+
 	FioCloseFile(slot); // if file was opened before, close it
+	FioLockSlots();
 	_fio.handles[slot] = f;
 	_fio.filenames[slot] = filename;
+	FioMapFile(slot, pos, size);
+	FioUnlockSlots();
 
 	/* Store the filename without path and extension */
 	const char *t = strrchr(filename, PATHSEPCHAR);
@@ -540,7 +649,7 @@ FILE *FioFOpenFile(const char *filename, const char *mode, Subdirectory subdir,
  * Create a directory with the given name
  * @param name the new name of the directory
  */
-static void FioCreateDirectory(const char *name)
+void FioCreateDirectory(const char *name)
 {
 	/* Ignore directory creation errors; they'll surface later on, and most
 	 * of the time they are 'directory already exists' errors anyhow. */
@@ -1261,6 +1370,8 @@ void DeterminePaths(const char *exe)
 	_hotkeys_file = str_fmt("%shotkeys.cfg", config_dir);
 	extern char *_windows_file;
 	_windows_file = str_fmt("%swindows.cfg", config_dir);
+	extern char *_newgrf_scan_cache_file;
+	_newgrf_scan_cache_file = str_fmt("%snewgrf_scan.dat", config_dir);
 
 #if defined(WITH_XDG_BASEDIR) && defined(WITH_PERSONAL_DIR)
 	if (config_dir == config_home) {
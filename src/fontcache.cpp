@@ -204,6 +204,86 @@ bool SpriteFontCache::GetDrawGlyphShadow()
 #include FT_GLYPH_H
 #include FT_TRUETYPE_TABLES_H
 
+/**
+ * Atlas of the rendered glyphs of a font. The encoded glyph sprites are
+ * packed into large pages, so the glyphs that are drawn together are close
+ * together in memory, and all glyphs can be freed at once.
+ */
+struct GlyphAtlas {
+	static const size_t PAGE_SIZE = 64 * 1024; ///< Size of the data of a normal page.
+
+	/** A page of the atlas. */
+	struct Page {
+		Page *next;   ///< Next page of the atlas.
+		size_t size;  ///< Size of the data of the page.
+		size_t used;  ///< Number of bytes of the data that are in use.
+		byte data[];  ///< The packed glyphs.
+	};
+
+	Page *pages;      ///< The pages of the atlas, the page that is being filled first.
+
+	GlyphAtlas() : pages(NULL) {}
+	~GlyphAtlas() { this->Clear(); }
+
+	/**
+	 * Allocate memory for a glyph.
+	 * @param size Number of bytes to allocate.
+	 * @return The allocated memory.
+	 */
+	void *Allocate(size_t size)
+	{
+		size = Align(size, sizeof(void *));
+
+		if (size > PAGE_SIZE) {
+			/* Glyphs that do not fit in a normal page get a page of their own. */
+			Page *page = this->NewPage(size);
+			page->used = size;
+			if (this->pages == NULL) {
+				page->next = NULL;
+				this->pages = page;
+			} else {
+				/* Keep filling the current page. */
+				page->next = this->pages->next;
+				this->pages->next = page;
+			}
+			return page->data;
+		}
+
+		if (this->pages == NULL || this->pages->used + size > this->pages->size) {
+			Page *page = this->NewPage(PAGE_SIZE);
+			page->next = this->pages;
+			this->pages = page;
+		}
+
+		void *ptr = this->pages->data + this->pages->used;
+		this->pages->used += size;
+		return ptr;
+	}
+
+	/**
+	 * Allocate a new, empty page.
+	 * @param size Size of the data of the page.
+	 * @return The page.
+	 */
+	static Page *NewPage(size_t size)
+	{
+		Page *page = (Page *)MallocT<byte>(sizeof(Page) + size);
+		page->size = size;
+		page->used = 0;
+		return page;
+	}
+
+	/** Free all glyphs of the atlas. */
+	void Clear()
+	{
+		while (this->pages != NULL) {
+			Page *next = this->pages->next;
+			free(this->pages);
+			this->pages = next;
+		}
+	}
+};
+
 /** Font cache for fonts that are based on a freetype font. */
 class FreeTypeFontCache : public FontCache {
 private:
@@ -233,6 +313,7 @@ private:
 	 * This can be simply changed in the two functions Get & SetGlyphPtr.
 	 */
 	GlyphEntry **glyph_to_sprite;
+	GlyphAtlas atlas; ///< Memory of the glyph sprites.
 
 	GlyphEntry *GetGlyphPtr(GlyphID key);
 	void SetGlyphPtr(GlyphID key, const GlyphEntry *glyph, bool duplicate = false);
@@ -410,16 +491,12 @@ void FreeTypeFontCache::ClearFontCache()
 	for (int i = 0; i < 256; i++) {
 		if (this->glyph_to_sprite[i] == NULL) continue;
 
-		for (int j = 0; j < 256; j++) {
-			if (this->glyph_to_sprite[i][j].duplicate) continue;
-			free(this->glyph_to_sprite[i][j].sprite);
-		}
-
 		free(this->glyph_to_sprite[i]);
 	}
 
 	free(this->glyph_to_sprite);
 	this->glyph_to_sprite = NULL;
+	this->atlas.Clear();
 
 	Layouter::ResetFontCache(this->fs);
 }
@@ -450,9 +527,11 @@ void FreeTypeFontCache::SetGlyphPtr(GlyphID key, const GlyphEntry *glyph, bool d
 	this->glyph_to_sprite[GB(key, 8, 8)][GB(key, 0, 8)].duplicate = duplicate;
 }
 
+static GlyphAtlas *_glyph_atlas; ///< The atlas #AllocateFont allocates the glyphs in.
+
 static void *AllocateFont(size_t size)
 {
-	return MallocT<byte>(size);
+	return _glyph_atlas->Allocate(size);
 }
 
 
@@ -515,7 +594,10 @@ const Sprite *FreeTypeFontCache::GetGlyph(GlyphID key)
 				builtin_questionmark_data
 			};
 
+			_glyph_atlas = &this->atlas;
+			LockSpriteEncoding();
 			Sprite *spr = BlitterFactory::GetCurrentBlitter()->Encode(&builtin_questionmark, AllocateFont);
+			UnlockSpriteEncoding();
 			assert(spr != NULL);
 			new_glyph.sprite = spr;
 			new_glyph.width  = spr->width + (this->fs != FS_NORMAL);
@@ -542,7 +624,9 @@ const Sprite *FreeTypeFontCache::GetGlyph(GlyphID key)
 	/* Limit glyph size to prevent overflows later on. */
 	if (width > 256 || height > 256) usererror("Font glyph is too large");
 
-	/* FreeType has rendered the glyph, now we allocate a sprite and copy the image into it */
+	/* FreeType has rendered the glyph, now we allocate a sprite and copy the image into it.
+	 * The buffers for decoding and encoding sprites are shared with the sprite prefetch thread. */
+	LockSpriteEncoding();
 	SpriteLoader::Sprite sprite;
 	sprite.AllocateData(ZOOM_LVL_NORMAL, width * height);
 	sprite.type = ST_FONT;
@@ -572,7 +656,9 @@ const Sprite *FreeTypeFontCache::GetGlyph(GlyphID key)
 		}
 	}
 
+	_glyph_atlas = &this->atlas;
 	new_glyph.sprite = BlitterFactory::GetCurrentBlitter()->Encode(&sprite, AllocateFont);
+	UnlockSpriteEncoding();
 	new_glyph.width  = slot->advance.x >> 6;
 
 	this->SetGlyphPtr(key, &new_glyph);
@@ -60,6 +60,9 @@ GenWorldInfo _gw;
 /** Whether we are generating the map or not. */
 bool _generating_world;
 
+/** Number of maps the map generation benchmark generates back to back; 0 when it does not run. */
+uint _genworld_benchmark_maps;
+
 /**
  * Tells if the world generation is done in a thread or not.
  * @return the 'threaded' status
@@ -90,6 +93,128 @@ static void CleanupGeneration()
 	MarkWholeScreenDirty();
 }
 
+/** Function doing the work of a single stage of the world generation; returns false when the generation has to be aborted. */
+typedef bool GenWorldStageProc();
+
+/** A single stage of the world generation pipeline. */
+struct GenWorldStage {
+	const char *name;        ///< Name of the stage, used when reporting how long it took.
+	GenWorldStageProc *proc; ///< The work of this stage.
+	uint64 time;             ///< Total time spent in this stage, in microseconds; for the map generation benchmark.
+};
+
+static bool GenWorldStageLandscape()
+{
+	GenerateLandscape(_gw.mode);
+	return true;
+}
+
+static bool GenWorldStageClearTiles()
+{
+	GenerateClearTile();
+	return true;
+}
+
+static bool GenWorldStageTowns()
+{
+	return GenerateTowns(_settings_game.economy.town_layout);
+}
+
+static bool GenWorldStageIndustries()
+{
+	GenerateIndustries();
+	return true;
+}
+
+static bool GenWorldStageObjects()
+{
+	GenerateObjects();
+	return true;
+}
+
+static bool GenWorldStageTrees()
+{
+	GenerateTrees();
+	return true;
+}
+
+static bool GenWorldStageTileLoop()
+{
+	SetGeneratingWorldProgress(GWP_RUNTILELOOP, 0x500);
+	for (uint i = 0; i < 0x500; i++) {
+		RunTileLoop();
+		_tick_counter++;
+		IncreaseGeneratingWorldProgress(GWP_RUNTILELOOP);
+	}
+	return true;
+}
+
+static bool GenWorldStageGameScript()
+{
+	Game::StartNew();
+
+	if (Game::GetInstance() != NULL) {
+		SetGeneratingWorldProgress(GWP_RUNSCRIPT, 2500);
+		_generating_world = true;
+		for (uint i = 0; i < 2500; i++) {
+			Game::GameLoop();
+			IncreaseGeneratingWorldProgress(GWP_RUNSCRIPT);
+			if (Game::GetInstance()->IsSleeping()) break;
+		}
+		_generating_world = false;
+	}
+	return true;
+}
+
+/**
+ * Stages shaping the terrain: heights, water, rivers, rough and rocky land.
+ * Every stage works on the result of the previous ones and all of them draw
+ * from the same random generator, so they have to run in this very order for
+ * a seed to always produce the same map.
+ */
+static GenWorldStage _landscape_stages[] = {
+	{ "landscape",   &GenWorldStageLandscape,  0 },
+	{ "clear tiles", &GenWorldStageClearTiles, 0 },
+};
+
+/** Stages populating the terrain; these are skipped in the scenario editor. */
+static GenWorldStage _populate_stages[] = {
+	{ "towns",       &GenWorldStageTowns,      0 },
+	{ "industries",  &GenWorldStageIndustries, 0 },
+	{ "objects",     &GenWorldStageObjects,    0 },
+	{ "trees",       &GenWorldStageTrees,      0 },
+};
+
+/** Stages letting the freshly generated world settle; these are skipped for empty maps. */
+static GenWorldStage _settle_stages[] = {
+	{ "tile loop",   &GenWorldStageTileLoop,   0 },
+};
+
+/** Stages starting the game script; these are only run for new games. */
+static GenWorldStage _script_stages[] = {
+	{ "game script", &GenWorldStageGameScript, 0 },
+};
+
+/**
+ * Run a part of the world generation pipeline, stage by stage, and report
+ * the time every stage took with the 'map' debug category.
+ * @param stages The first stage to run.
+ * @param count  The number of stages to run.
+ * @return False when one of the stages requested to abort the generation.
+ */
+static bool RunGenWorldStages(GenWorldStage *stages, uint count)
+{
+	for (uint i = 0; i < count; i++) {
+		uint64 start = GetPerformanceTimer();
+		bool result = stages[i].proc();
+		uint64 time = GetPerformanceTimer() - start;
+		stages[i].time += time;
+		DEBUG(map, 2, "Map generation stage '%s' took " OTTD_PRINTF64 " ms", stages[i].name, time / 1000);
+		if (!result) return false;
+	}
+	return true;
+}
+
 /**
  * The internal, real, generate function.
  */
@@ -99,6 +224,8 @@ static void _GenerateWorld(void *)
 	Backup<CompanyByte> _cur_company(_current_company, OWNER_NONE, FILE_LINE);
 
 	try {
+		uint64 start = GetPerformanceTimer();
+
 		_generating_world = true;
 		_modal_progress_work_mutex->BeginCritical();
 		if (_network_dedicated) DEBUG(net, 1, "Generating map, please wait...");
@@ -130,19 +257,13 @@ static void _GenerateWorld(void *)
 			ConvertGroundTilesIntoWaterTiles();
 			IncreaseGeneratingWorldProgress(GWP_OBJECT);
 		} else {
-			GenerateLandscape(_gw.mode);
-			GenerateClearTile();
+			RunGenWorldStages(_landscape_stages, lengthof(_landscape_stages));
 
 			/* only generate towns, tree and industries in newgame mode. */
-			if (_game_mode != GM_EDITOR) {
-				if (!GenerateTowns(_settings_game.economy.town_layout)) {
-					_cur_company.Restore();
-					HandleGeneratingWorldAbortion();
-					return;
-				}
-				GenerateIndustries();
-				GenerateObjects();
-				GenerateTrees();
+			if (_game_mode != GM_EDITOR && !RunGenWorldStages(_populate_stages, lengthof(_populate_stages))) {
+				_cur_company.Restore();
+				HandleGeneratingWorldAbortion();
+				return;
 			}
 		}
 
@@ -157,31 +278,9 @@ static void _GenerateWorld(void *)
 
 		/* No need to run the tile loop in the scenario editor. */
 		if (_gw.mode != GWM_EMPTY) {
-			uint i;
-
-			SetGeneratingWorldProgress(GWP_RUNTILELOOP, 0x500);
-			for (i = 0; i < 0x500; i++) {
-				RunTileLoop();
-				_tick_counter++;
-				IncreaseGeneratingWorldProgress(GWP_RUNTILELOOP);
-			}
-
-			if (_game_mode != GM_EDITOR) {
-				Game::StartNew();
-
-				if (Game::GetInstance() != NULL) {
-					SetGeneratingWorldProgress(GWP_RUNSCRIPT, 2500);
-					_generating_world = true;
-					for (i = 0; i < 2500; i++) {
-						Game::GameLoop();
-						IncreaseGeneratingWorldProgress(GWP_RUNSCRIPT);
-						if (Game::GetInstance()->IsSleeping()) break;
-					}
-					_generating_world = false;
-				}
-			}
+			RunGenWorldStages(_settle_stages, lengthof(_settle_stages));
+			if (_game_mode != GM_EDITOR) RunGenWorldStages(_script_stages, lengthof(_script_stages));
 		}
-
 		BasePersistentStorageArray::SwitchMode(PSM_LEAVE_GAMELOOP);
 
 		ResetObjectToPlace();
@@ -200,6 +299,7 @@ static void _GenerateWorld(void *)
 
 		if (_network_dedicated) DEBUG(net, 1, "Map generated, starting game");
 		DEBUG(desync, 1, "new_map: %08x", _settings_game.game_creation.generation_seed);
+		if (_gw.mode != GWM_EMPTY) DEBUG(map, 1, "Generated %ux%u map with seed %u in " OTTD_PRINTF64 " ms", MapSizeX(), MapSizeY(), _settings_game.game_creation.generation_seed, (GetPerformanceTimer() - start) / 1000);
 
 		if (_debug_desync_level > 0) {
 			char name[MAX_PATH];
@@ -354,3 +454,66 @@ void GenerateWorld(GenWorldMode mode, uint size_x, uint size_y, bool reset_setti
 		ScrollMainWindowToTile(TileXY(MapSizeX() / 2, MapSizeY() / 2), true);
 	}
 }
+
+/**
+ * Clear the time spent in some stages of the world generation.
+ * @param stages The first stage to clear.
+ * @param count  The number of stages to clear.
+ */
+static void ResetGenWorldStageTimes(GenWorldStage *stages, uint count)
+{
+	for (uint i = 0; i < count; i++) stages[i].time = 0;
+}
+
+/**
+ * Report the time spent in some stages of the world generation.
+ * @param stages  The first stage to report.
+ * @param count   The number of stages to report.
+ * @param elapsed The total time of the benchmark, in microseconds.
+ */
+static void ShowGenWorldStageTimes(const GenWorldStage *stages, uint count, uint64 elapsed)
+{
+	for (uint i = 0; i < count; i++) {
+		ShowInfoF("genworld:   %-11s " OTTD_PRINTF64 " ms (" OTTD_PRINTF64 "%%)", stages[i].name, stages[i].time / 1000, stages[i].time * 100 / elapsed);
+	}
+}
+
+/**
+ * Generate the requested number of new games back to back, headless, with
+ * consecutive seeds starting at the seed of the first one, and report how
+ * long every map and every stage of the generation took.
+ */
+void RunGenerateWorldBenchmark()
+{
+	ResetGenWorldStageTimes(_landscape_stages, lengthof(_landscape_stages));
+	ResetGenWorldStageTimes(_populate_stages, lengthof(_populate_stages));
+	ResetGenWorldStageTimes(_settle_stages, lengthof(_settle_stages));
+	ResetGenWorldStageTimes(_script_stages, lengthof(_script_stages));
+
+	/* Every map is generated here, not by the first game loop. */
+	_switch_mode = SM_NONE;
+
+	uint32 seed = _settings_newgame.game_creation.generation_seed;
+	uint64 start = GetPerformanceTimer();
+	uint maps;
+	for (maps = 0; maps < _genworld_benchmark_maps; maps++) {
+		_settings_newgame.game_creation.generation_seed = seed + maps;
+
+		uint64 map_start = GetPerformanceTimer();
+		SwitchToMode(SM_NEWGAME);
+		if (_game_mode != GM_NORMAL) {
+			ShowInfoF("genworld: cannot generate the map with seed %u", seed + maps);
+			break;
+		}
+		ShowInfoF("genworld: map %u with seed %u took " OTTD_PRINTF64 " ms", maps + 1, seed + maps, (GetPerformanceTimer() - map_start) / 1000);
+	}
+	if (maps == 0) return;
+	uint64 elapsed = max<uint64>(GetPerformanceTimer() - start, 1);
+
+	ShowInfoF("genworld: %u maps of %ux%u in " OTTD_PRINTF64 " ms, " OTTD_PRINTF64 " ms per map, " OTTD_PRINTF64 " tiles/s",
+			maps, MapSizeX(), MapSizeY(), elapsed / 1000, elapsed / 1000 / maps, (uint64)maps * MapSize() * 1000000 / elapsed);
+	ShowGenWorldStageTimes(_landscape_stages, lengthof(_landscape_stages), elapsed);
+	ShowGenWorldStageTimes(_populate_stages, lengthof(_populate_stages), elapsed);
+	ShowGenWorldStageTimes(_settle_stages, lengthof(_settle_stages), elapsed);
+	ShowGenWorldStageTimes(_script_stages, lengthof(_script_stages), elapsed);
+}
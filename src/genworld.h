@@ -90,6 +90,7 @@ void GenerateWorld(GenWorldMode mode, uint size_x, uint size_y, bool reset_setti
 void AbortGeneratingWorld();
 bool IsGeneratingWorldAborted();
 void HandleGeneratingWorldAbortion();
+void RunGenerateWorldBenchmark();
 
 /* genworld_gui.cpp */
 void SetNewLandscapeType(byte landscape);
@@ -102,5 +103,6 @@ void ShowCreateScenario();
 void StartScenarioEditor();
 
 extern bool _generating_world;
+extern uint _genworld_benchmark_maps;
 
 #endif /* GENWORLD_H */
@@ -21,6 +21,7 @@
 #include "network/network_func.h"
 #include "window_func.h"
 #include "newgrf_debug.h"
+#include "smallmap_gui.h"
 
 #include "table/palettes.h"
 #include "table/sprites.h"
@@ -324,6 +325,62 @@ static void SetColourRemap(TextColour colour)
 	_colour_remap_ptr = _string_colourremap;
 }
 
+/** A glyph of a run of text that is to be drawn. */
+struct GlyphToDraw {
+	const Sprite *sprite; ///< The sprite of the glyph.
+	int x;                ///< Left position of the glyph.
+	int y;                ///< Top position of the glyph.
+	bool shadow;          ///< Whether to draw a shadow below the glyph.
+};
+
+/** Glyphs of the run of text that is being drawn. */
+static SmallVector<GlyphToDraw, 64> _glyphs_to_draw;
+
+/**
+ * Add a glyph to the run of glyphs to draw.
+ * @param sprite The sprite of the glyph.
+ * @param x      Left position of the glyph.
+ * @param y      Top position of the glyph.
+ * @param shadow Whether to draw a shadow below the glyph.
+ */
+static inline void AddGlyphToDraw(const Sprite *sprite, int x, int y, bool shadow)
+{
+	GlyphToDraw *g = _glyphs_to_draw.Append();
+	g->sprite = sprite;
+	g->x = x;
+	g->y = y;
+	g->shadow = shadow;
+}
+
+/**
+ * Draw the collected run of glyphs in one colour. All shadows are drawn
+ * before the glyphs themselves, so the colour remap only has to be set up
+ * twice per run instead of twice per glyph, and no shadow is drawn over
+ * the previous glyph.
+ * @param colour The colour of the glyphs.
+ */
+static void DrawGlyphsToDraw(TextColour colour)
+{
+	const GlyphToDraw *end = _glyphs_to_draw.End();
+
+	bool remapped = false;
+	for (const GlyphToDraw *g = _glyphs_to_draw.Begin(); g != end; g++) {
+		if (!g->shadow) continue;
+		if (!remapped) {
+			SetColourRemap(TC_BLACK);
+			remapped = true;
+		}
+		GfxMainBlitter(g->sprite, g->x + 1, g->y + 1, BM_COLOUR_REMAP);
+	}
+
+	SetColourRemap(colour);
+	for (const GlyphToDraw *g = _glyphs_to_draw.Begin(); g != end; g++) {
+		GfxMainBlitter(g->sprite, g->x, g->y, BM_COLOUR_REMAP);
+	}
+
+	_glyphs_to_draw.Clear();
+}
+
 /**
  * Drawing routine for drawing a laid out line of text.
  * @param line      String to draw.
@@ -426,7 +483,6 @@ static int DrawLayoutLine(const ParagraphLayouter::Line *line, int y, int left,
 
 		FontCache *fc = f->fc;
 		colour = f->colour;
-		SetColourRemap(colour);
 
 		DrawPixelInfo *dpi = _cur_dpi;
 		int dpi_left  = dpi->left;
@@ -451,25 +507,18 @@ static int DrawLayoutLine(const ParagraphLayouter::Line *line, int y, int left,
 			/* Check clipping (the "+ 1" is for the shadow). */
 			if (begin_x + sprite->x_offs > dpi_right || begin_x + sprite->x_offs + sprite->width /* - 1 + 1 */ < dpi_left) continue;
 
-			if (draw_shadow && (glyph & SPRITE_GLYPH) == 0) {
-				SetColourRemap(TC_BLACK);
-				GfxMainBlitter(sprite, begin_x + 1, top + 1, BM_COLOUR_REMAP);
-				SetColourRemap(colour);
-			}
-			GfxMainBlitter(sprite, begin_x, top, BM_COLOUR_REMAP);
+			AddGlyphToDraw(sprite, begin_x, top, draw_shadow && (glyph & SPRITE_GLYPH) == 0);
 		}
+
+		DrawGlyphsToDraw(colour);
 	}
 
 	if (truncation) {
 		int x = (_current_text_dir == TD_RTL) ? left : (right - 3 * dot_width);
 		for (int i = 0; i < 3; i++, x += dot_width) {
-			if (draw_shadow) {
-				SetColourRemap(TC_BLACK);
-				GfxMainBlitter(dot_sprite, x + 1, y + 1, BM_COLOUR_REMAP);
-				SetColourRemap(colour);
-			}
-			GfxMainBlitter(dot_sprite, x, y, BM_COLOUR_REMAP);
+			AddGlyphToDraw(dot_sprite, x, y, draw_shadow);
 		}
+		DrawGlyphsToDraw(colour);
 	}
 
 	if (underline) {
@@ -1455,6 +1504,7 @@ void SetDirtyBlocks(int left, int top, int right, int bottom)
  */
 void MarkWholeScreenDirty()
 {
+	InvalidateSmallMapColours();
 	SetDirtyBlocks(0, 0, _screen.width, _screen.height);
 }
 
@@ -24,6 +24,87 @@
 #include "safeguards.h"
 
 
+/**
+ * Cache of ParagraphLayout lines. The lines are found by a hash table of
+ * their key, and kept in a list ordered by their last use so the least
+ * recently used lines can be removed when the cache grows too large.
+ */
+struct Layouter::LineCache {
+	static const uint HASH_BITS = 12;                    ///< Number of bits of the hash used for the buckets.
+	static const size_t BUDGET = 4 * 1024 * 1024;        ///< Number of bytes the cache tries to stay within.
+
+	LineCacheItem *buckets[1 << HASH_BITS];              ///< Hash table of the items.
+	LineCacheItem *lru_first;                            ///< Most recently used item.
+	LineCacheItem *lru_last;                             ///< Least recently used item.
+	LineCacheStats stats;                                ///< Statistics of the cache.
+
+	LineCache() : lru_first(NULL), lru_last(NULL)
+	{
+		MemSetT(this->buckets, 0, lengthof(this->buckets));
+		MemSetT(&this->stats, 0);
+		this->stats.budget = BUDGET;
+	}
+
+	~LineCache()
+	{
+		this->Clear();
+	}
+
+	/**
+	 * Get the bucket of the hash table for the given hash.
+	 * @param hash The hash of the item.
+	 * @return The bucket, i.e. the head of its list of items.
+	 */
+	inline LineCacheItem *&GetBucket(uint32 hash)
+	{
+		return this->buckets[hash >> (32 - HASH_BITS)];
+	}
+
+	/**
+	 * Remove an item from the list of recently used items.
+	 * @param item The item to unlink.
+	 */
+	void UnlinkLRU(LineCacheItem *item)
+	{
+		if (item->lru_prev != NULL) item->lru_prev->lru_next = item->lru_next; else this->lru_first = item->lru_next;
+		if (item->lru_next != NULL) item->lru_next->lru_prev = item->lru_prev; else this->lru_last = item->lru_prev;
+	}
+
+	/**
+	 * Add an item as the most recently used one.
+	 * @param item The item to link.
+	 */
+	void LinkLRU(LineCacheItem *item)
+	{
+		item->lru_prev = NULL;
+		item->lru_next = this->lru_first;
+		if (this->lru_first != NULL) this->lru_first->lru_prev = item; else this->lru_last = item;
+		this->lru_first = item;
+	}
+
+	/**
+	 * Remove an item from the cache and free it.
+	 * @param item The item to remove.
+	 */
+	void Remove(LineCacheItem *item)
+	{
+		LineCacheItem **prev = &this->GetBucket(item->hash);
+		while (*prev != item) prev = &(*prev)->hash_next;
+		*prev = item->hash_next;
+
+		this->UnlinkLRU(item);
+		this->stats.items--;
+		this->stats.used -= item->footprint;
+		delete item;
+	}
+
+	/** Remove all items from the cache. */
+	void Clear()
+	{
+		while (this->lru_last != NULL) this->Remove(this->lru_last);
+	}
+};
+
 /** Cache of ParagraphLayout lines. */
 Layouter::LineCache *Layouter::linecache;
 
@@ -573,16 +654,15 @@ static FallbackParagraphLayout *GetParagraphLayout(WChar *buff, WChar *buff_end,
 template <typename T>
 static inline void GetLayouter(Layouter::LineCacheItem &line, const char *&str, FontState &state)
 {
-	if (line.buffer != NULL) free(line.buffer);
+	free(line.buffer);
 
-	typename T::CharType *buff_begin = MallocT<typename T::CharType>(DRAW_STRING_BUFFER);
-	const typename T::CharType *buffer_last = buff_begin + DRAW_STRING_BUFFER;
+	/* Convert into a temporary buffer first, so the cached buffer does not need to be larger than the line. */
+	typename T::CharType buff_begin[DRAW_STRING_BUFFER];
+	const typename T::CharType *buffer_last = lastof(buff_begin);
 	typename T::CharType *buff = buff_begin;
 	FontMap &fontMapping = line.runs;
 	Font *f = Layouter::GetFont(state.fontsize, state.cur_colour);
 
-	line.buffer = buff_begin;
-
 	/*
 	 * Go through the whole string while adding Font instances to the font map
 	 * whenever the font changes, and convert the wide characters into a format
@@ -621,8 +701,15 @@ static inline void GetLayouter(Layouter::LineCacheItem &line, const char *&str,
 	if (!fontMapping.Contains(buff - buff_begin)) {
 		fontMapping.Insert(buff - buff_begin, f);
 	}
-	line.layout = GetParagraphLayout(buff_begin, buff, fontMapping);
+
+	size_t length = buff - buff_begin;
+	typename T::CharType *line_buffer = MallocT<typename T::CharType>(length + 1);
+	MemCpyT(line_buffer, buff_begin, length + 1);
+	line.buffer = line_buffer;
+	line.layout = GetParagraphLayout(line_buffer, line_buffer + length, fontMapping);
 	line.state_after = state;
+	/* The layout itself keeps glyphs, positions and character maps of about the same size as the buffer. */
+	line.footprint = sizeof(line) + line.len + (length + 1) * sizeof(typename T::CharType) * 4;
 }
 
 /**
@@ -673,6 +760,7 @@ Layouter::Layouter(const char *str, int maxw, TextColour colour, FontSize fontsi
 #else
 			GetLayouter<FallbackParagraphLayout>(line, str, state);
 #endif
+			AccountLineCacheItem(line);
 		}
 
 		/* Copy all lines into a local cache so we can reuse them later on more easily. */
@@ -826,10 +914,46 @@ Layouter::LineCacheItem &Layouter::GetCachedParagraphLayout(const char *str, siz
 		linecache = new LineCache();
 	}
 
-	LineCacheKey key;
-	key.state_before = state;
-	key.str.assign(str, len);
-	return (*linecache)[key];
+	/* FNV-1a hash of the key. */
+	uint32 hash = 2166136261U;
+	hash = (hash ^ state.fontsize) * 16777619;
+	hash = (hash ^ state.cur_colour) * 16777619;
+	hash = (hash ^ state.prev_colour) * 16777619;
+	for (size_t i = 0; i < len; i++) hash = (hash ^ (byte)str[i]) * 16777619;
+
+	LineCacheItem *&bucket = linecache->GetBucket(hash);
+	for (LineCacheItem *item = bucket; item != NULL; item = item->hash_next) {
+		if (item->hash != hash || item->len != len || memcmp(item->str, str, len) != 0) continue;
+		if (item->state_before.fontsize != state.fontsize || item->state_before.cur_colour != state.cur_colour || item->state_before.prev_colour != state.prev_colour) continue;
+
+		linecache->stats.hits++;
+		linecache->UnlinkLRU(item);
+		linecache->LinkLRU(item);
+		return *item;
+	}
+
+	linecache->stats.misses++;
+	linecache->stats.items++;
+
+	LineCacheItem *item = new LineCacheItem();
+	item->state_before = state;
+	item->str = MallocT<char>(max<size_t>(len, 1));
+	MemCpyT(item->str, str, len);
+	item->len = len;
+	item->hash = hash;
+	item->hash_next = bucket;
+	bucket = item;
+	linecache->LinkLRU(item);
+	return *item;
+}
+
+/**
+ * Account the memory of a cache item that just got its layout.
+ * @param line The cache item.
+ */
+void Layouter::AccountLineCacheItem(LineCacheItem &line)
+{
+	linecache->stats.used += line.footprint;
 }
 
 /**
@@ -837,16 +961,41 @@ Layouter::LineCacheItem &Layouter::GetCachedParagraphLayout(const char *str, siz
  */
 void Layouter::ResetLineCache()
 {
-	if (linecache != NULL) linecache->clear();
+	if (linecache != NULL) linecache->Clear();
 }
 
 /**
  * Reduce the size of linecache if necessary to prevent infinite growth.
+ * The least recently used lines are removed until the cache is within its budget.
+ * @note Lines are never removed while laying out a string, as the layouters
+ *       still reference them; hence this is only done between game loops.
  */
 void Layouter::ReduceLineCache()
 {
-	if (linecache != NULL) {
-		/* TODO LRU cache would be fancy, but not exactly necessary */
-		if (linecache->size() > 4096) ResetLineCache();
+	if (linecache == NULL) return;
+
+	while (linecache->stats.used > LineCache::BUDGET && linecache->lru_last != NULL) {
+		linecache->Remove(linecache->lru_last);
+		linecache->stats.evictions++;
 	}
 }
+
+/**
+ * Get the statistics of the linecache.
+ * @return The statistics.
+ */
+const Layouter::LineCacheStats &Layouter::GetLineCacheStats()
+{
+	if (linecache == NULL) linecache = new LineCache();
+	return linecache->stats;
+}
+
+/** Reset the hit, miss and eviction counters of the linecache. */
+void Layouter::ResetLineCacheStats()
+{
+	if (linecache == NULL) return;
+
+	linecache->stats.hits = 0;
+	linecache->stats.misses = 0;
+	linecache->stats.evictions = 0;
+}
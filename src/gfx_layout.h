@@ -16,8 +16,6 @@
 #include "gfx_func.h"
 #include "core/smallmap_type.hpp"
 
-#include <map>
-#include <string>
 
 #ifdef WITH_ICU
 #include "layout/ParagraphLayout.h"
@@ -139,20 +137,6 @@ public:
 class Layouter : public AutoDeleteSmallVector<const ParagraphLayouter::Line *, 4> {
 	const char *string; ///< Pointer to the original string.
 
-	/** Key into the linecache */
-	struct LineCacheKey {
-		FontState state_before;  ///< Font state at the beginning of the line.
-		std::string str;         ///< Source string of the line (including colour and font size codes).
-
-		/** Comparison operator for std::map */
-		bool operator<(const LineCacheKey &other) const
-		{
-			if (this->state_before.fontsize != other.state_before.fontsize) return this->state_before.fontsize < other.state_before.fontsize;
-			if (this->state_before.cur_colour != other.state_before.cur_colour) return this->state_before.cur_colour < other.state_before.cur_colour;
-			if (this->state_before.prev_colour != other.state_before.prev_colour) return this->state_before.prev_colour < other.state_before.prev_colour;
-			return this->str < other.str;
-		}
-	};
 public:
 	/** Item in the linecache */
 	struct LineCacheItem {
@@ -163,14 +147,37 @@ public:
 		FontState state_after;     ///< Font state after the line.
 		ParagraphLayouter *layout; ///< Layout of the line.
 
-		LineCacheItem() : buffer(NULL), layout(NULL) {}
-		~LineCacheItem() { delete layout; free(buffer); }
+		/* Key of the item */
+		FontState state_before;    ///< Font state at the beginning of the line.
+		char *str;                 ///< Source string of the line (including colour and font size codes), not terminated.
+		size_t len;                ///< Length of #str in bytes.
+		uint32 hash;               ///< Hash of #state_before and #str.
+
+		/* Bookkeeping of the cache */
+		size_t footprint;          ///< Estimated number of bytes used by this item.
+		LineCacheItem *hash_next;  ///< Next item in the same bucket of the hash table.
+		LineCacheItem *lru_prev;   ///< Item that was used more recently.
+		LineCacheItem *lru_next;   ///< Item that was used less recently.
+
+		LineCacheItem() : buffer(NULL), layout(NULL), str(NULL), footprint(0) {}
+		~LineCacheItem() { delete layout; free(buffer); free(str); }
+	};
+
+	/** Statistics of the linecache. */
+	struct LineCacheStats {
+		uint64 hits;      ///< Number of lines that were found in the cache.
+		uint64 misses;    ///< Number of lines that had to be laid out.
+		uint64 evictions; ///< Number of lines removed from the cache to stay within its budget.
+		uint items;       ///< Number of lines in the cache.
+		size_t used;      ///< Estimated number of bytes used by the cached lines.
+		size_t budget;    ///< Number of bytes the cache tries to stay within.
 	};
 private:
-	typedef std::map<LineCacheKey, LineCacheItem> LineCache;
+	struct LineCache;
 	static LineCache *linecache;
 
 	static LineCacheItem &GetCachedParagraphLayout(const char *str, size_t len, const FontState &state);
+	static void AccountLineCacheItem(LineCacheItem &line);
 
 	typedef SmallMap<TextColour, Font *> FontColourMap;
 	static FontColourMap fonts[FS_END];
@@ -185,6 +192,8 @@ public:
 	static void ResetFontCache(FontSize size);
 	static void ResetLineCache();
 	static void ReduceLineCache();
+	static const LineCacheStats &GetLineCacheStats();
+	static void ResetLineCacheStats();
 };
 
 #endif /* GFX_LAYOUT_H */
@@ -318,6 +318,7 @@ void GfxLoadSprites()
 	GfxInitSpriteMem();
 	LoadSpriteTables();
 	GfxInitPalettes();
+	GfxStartSpritePrefetch();
 
 	UpdateCursorSize();
 }
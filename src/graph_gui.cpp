@@ -1304,10 +1304,7 @@ struct PerformanceRatingDetailWindow : Window {
 	{
 		/* Update all company stats with the current data
 		 * (this is because _score_info is not saved to a savegame) */
-		Company *c;
-		FOR_ALL_COMPANIES(c) {
-			UpdateCompanyRatingAndValue(c, false);
-		}
+		UpdateAllCompanyRatingsAndValues(false);
 
 		this->timeout = DAY_TICKS * 5;
 	}
@@ -2716,8 +2716,20 @@ void IndustryMonthlyLoop()
 
 	_industry_builder.MonthlyLoop();
 
+	cur_company.Restore();
+}
+
+/**
+ * Monthly update of the industries whose index belongs to the current tick.
+ * The industries are spread over the ticks of the first day of the month, so
+ * the production of all industries does not change in the same tick.
+ */
+void IndustryMonthlyTick()
+{
+	Backup<CompanyByte> cur_company(_current_company, OWNER_NONE, FILE_LINE);
+
 	Industry *i;
-	FOR_ALL_INDUSTRIES(i) {
+	FOR_ALL_ITEMS_STEP(Industry, industry_index, i, _date_fract, DAY_TICKS) {
 		UpdateIndustryStatistics(i);
 		if (i->prod_level == PRODLEVEL_CLOSURE) {
 			delete i;
@@ -2730,10 +2742,9 @@ void IndustryMonthlyLoop()
 	cur_company.Restore();
 
 	/* production-change */
-	InvalidateWindowData(WC_INDUSTRY_DIRECTORY, 0, 1);
+	if (_date_fract == DAY_TICKS - 1) InvalidateWindowData(WC_INDUSTRY_DIRECTORY, 0, 1);
 }
 
-
 void InitializeIndustries()
 {
 	Industry::ResetIndustryCounts();
@@ -31,6 +31,7 @@
 #include "object_base.h"
 #include "company_func.h"
 #include "pathfinder/npf/aystar.h"
+#include "pathfinder/yapf/yapf_cache.h"
 #include <list>
 #include <set>
 
@@ -492,6 +493,7 @@ void DoClearSquare(TileIndex tile)
 	if (_tile_type_procs[GetTileType(tile)]->animate_tile_proc != NULL) DeleteAnimatedTile(tile);
 
 	MakeClear(tile, CLEAR_GRASS, _generating_world ? 3 : 0);
+	YapfNotifyWaterLayoutChange(tile);
 	MarkTileDirtyByTile(tile);
 }
 
@@ -10,6 +10,7 @@
 /** @file linkgraphschedule.cpp Definition of link graph schedule used for cargo distribution. */
 
 #include "../stdafx.h"
+#include "../debug.h"
 #include "linkgraphschedule.h"
 #include "init.h"
 #include "demands.h"
@@ -59,7 +60,9 @@ void LinkGraphSchedule::JoinNext()
 	if (!next->IsFinished()) return;
 	this->running.pop_front();
 	LinkGraphID id = next->LinkGraphIndex();
+	uint64 start = GetPerformanceTimer();
 	delete next; // implicitly joins the thread
+	this->join_wait_time += GetPerformanceTimer() - start;
 	if (LinkGraph::IsValidID(id)) {
 		LinkGraph *lg = LinkGraph::Get(id);
 		this->Unqueue(lg); // Unqueue to avoid double-queueing recycled IDs.
@@ -119,7 +122,7 @@ void LinkGraphSchedule::ShiftDates(int interval)
 /**
  * Create a link graph schedule and initialize its handlers.
  */
-LinkGraphSchedule::LinkGraphSchedule()
+LinkGraphSchedule::LinkGraphSchedule() : join_wait_time(0)
 {
 	this->handlers[0] = new InitHandler;
 	this->handlers[1] = new DemandHandler;
@@ -47,6 +47,7 @@ protected:
 	ComponentHandler *handlers[6]; ///< Handlers to be run for each job.
 	GraphList schedule;            ///< Queue for new jobs.
 	JobList running;               ///< Currently running jobs.
+	uint64 join_wait_time;         ///< Time the game loop waited for jobs that did not finish in time, in microseconds.
 
 public:
 	/* This is a tick where not much else is happening, so a small lag might go unnoticed. */
@@ -76,6 +77,24 @@ public:
 	 * @param lg Link graph to be removed.
 	 */
 	void Unqueue(LinkGraph *lg) { this->schedule.remove(lg); }
+
+	/**
+	 * Get the number of link graphs waiting for their next job.
+	 * @return Number of queued link graphs.
+	 */
+	uint GetNumQueued() const { return (uint)this->schedule.size(); }
+
+	/**
+	 * Get the number of jobs that are running.
+	 * @return Number of running jobs.
+	 */
+	uint GetNumRunning() const { return (uint)this->running.size(); }
+
+	/**
+	 * Get the total time the game loop waited for jobs to finish when joining them.
+	 * @return The time in microseconds.
+	 */
+	uint64 GetJoinWaitTime() const { return this->join_wait_time; }
 };
 
 #endif /* LINKGRAPHSCHEDULE_H */
@@ -28,6 +28,8 @@
 #include "core/pool_type.hpp"
 #include "game/game.hpp"
 #include "linkgraph/linkgraphschedule.h"
+#include "pathfinder/yapf/yapf_cache.h"
+#include "signal_func.h"
 
 #include "safeguards.h"
 
@@ -62,6 +64,7 @@ void InitializeGame(uint size_x, uint size_y, bool reset_date, bool reset_settin
 	_pause_mode = PM_UNPAUSED;
 	_fast_forward = 0;
 	_tick_counter = 0;
+	_period_tick_date = INVALID_DATE;
 	_cur_tileloop_tile = 1;
 	_thd.redsq = INVALID_TILE;
 	if (reset_settings) MakeNewgameSettingsLive();
@@ -95,6 +98,9 @@ void InitializeGame(uint size_x, uint size_y, bool reset_date, bool reset_settin
 	InitializeBuildingCounts();
 
 	InitializeNPF();
+	YapfNotifyRoadLayoutChange(INVALID_TILE);
+	YapfNotifyWaterLayoutChange(INVALID_TILE);
+	FlushSignalBlockCache();
 
 	InitializeCompanies();
 	AI::Initialize();
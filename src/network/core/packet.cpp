@@ -15,11 +15,83 @@
 
 #include "../../stdafx.h"
 #include "../../string_func.h"
+#include "../../thread/thread.h"
 
 #include "packet.h"
 
 #include "../../safeguards.h"
 
+/** Header in front of the buffer of a packet, to share and pool the buffers. */
+struct PacketBufferHeader {
+	uint32 refcount; ///< Number of packets using the buffer.
+	uint32 capacity; ///< Number of bytes that fit in the buffer.
+};
+
+static const uint SMALL_PACKET_BUFFER = 64;   ///< Capacity of the buffers that queued small packets are moved to.
+static const uint MAX_POOLED_BUFFERS  = 256;  ///< Maximum number of free buffers kept per capacity.
+
+/** Free buffers of packets, for both capacities; they are used by the game loop and the savegame thread. */
+static SmallVector<PacketBufferHeader *, 16> _free_packet_buffers[2];
+static ThreadMutex *_packet_buffer_mutex = NULL; ///< Mutex for #_free_packet_buffers.
+
+/**
+ * Get the header of a packet buffer.
+ * @param buffer The buffer.
+ * @return The header.
+ */
+static inline PacketBufferHeader *GetPacketBufferHeader(byte *buffer)
+{
+	return (PacketBufferHeader *)buffer - 1;
+}
+
+/**
+ * Get a buffer for a packet, from the pool when possible.
+ * @param capacity Number of bytes the buffer has to hold; either #SEND_MTU or #SMALL_PACKET_BUFFER.
+ * @return The buffer, which is not shared yet.
+ */
+static byte *AllocatePacketBuffer(uint capacity)
+{
+	/* The first packet is made before any other thread is started. */
+	if (_packet_buffer_mutex == NULL) _packet_buffer_mutex = ThreadMutex::New();
+
+	SmallVector<PacketBufferHeader *, 16> &pool = _free_packet_buffers[capacity == SEND_MTU];
+	PacketBufferHeader *header = NULL;
+	_packet_buffer_mutex->BeginCritical();
+	if (pool.Length() != 0) {
+		header = pool[pool.Length() - 1];
+		pool.Erase(pool.End() - 1);
+	}
+	_packet_buffer_mutex->EndCritical();
+
+	if (header == NULL) {
+		header = (PacketBufferHeader *)MallocT<byte>(sizeof(PacketBufferHeader) + capacity);
+		header->capacity = capacity;
+	}
+	header->refcount = 1;
+	return (byte *)(header + 1);
+}
+
+/**
+ * Release a buffer of a packet; when no other packet uses it, it is returned to the pool.
+ * @param buffer The buffer.
+ */
+static void FreePacketBuffer(byte *buffer)
+{
+	PacketBufferHeader *header = GetPacketBufferHeader(buffer);
+	/* Buffers are only shared by the game loop, so no locking is needed to count the references. */
+	if (--header->refcount != 0) return;
+
+	SmallVector<PacketBufferHeader *, 16> &pool = _free_packet_buffers[header->capacity == SEND_MTU];
+	_packet_buffer_mutex->BeginCritical();
+	if (pool.Length() < MAX_POOLED_BUFFERS) {
+		*pool.Append() = header;
+		header = NULL;
+	}
+	_packet_buffer_mutex->EndCritical();
+
+	free(header);
+}
+
 /**
  * Create a packet that is used to read from a network socket
  * @param cs the socket handler associated with the socket we are reading from
@@ -32,7 +104,7 @@ Packet::Packet(NetworkSocketHandler *cs)
 	this->next   = NULL;
 	this->pos    = 0; // We start reading from here
 	this->size   = 0;
-	this->buffer = MallocT<byte>(SEND_MTU);
+	this->buffer = AllocatePacketBuffer(SEND_MTU);
 }
 
 /**
@@ -47,16 +119,31 @@ Packet::Packet(PacketType type)
 	/* Skip the size so we can write that in before sending the packet */
 	this->pos                  = 0;
 	this->size                 = sizeof(PacketSize);
-	this->buffer               = MallocT<byte>(SEND_MTU);
+	this->buffer               = AllocatePacketBuffer(SEND_MTU);
 	this->buffer[this->size++] = type;
 }
 
+/**
+ * Creates a packet to send with the same contents as another packet, without
+ * copying it. This is used to send the same packet to multiple sockets.
+ * @param shared The packet to share the buffer of; it must not be changed anymore.
+ */
+Packet::Packet(const Packet *shared)
+{
+	this->cs     = NULL;
+	this->next   = NULL;
+	this->pos    = 0;
+	this->size   = shared->size;
+	this->buffer = shared->buffer;
+	GetPacketBufferHeader(this->buffer)->refcount++;
+}
+
 /**
  * Free the buffer of this packet.
  */
 Packet::~Packet()
 {
-	free(this->buffer);
+	FreePacketBuffer(this->buffer);
 }
 
 /**
@@ -72,6 +159,23 @@ void Packet::PrepareToSend()
 	this->pos  = 0; // We start reading from here
 }
 
+/**
+ * Move the contents of a small packet to a small buffer, as in 99+% of the
+ * times we send at most 25 bytes and keeping the other 1400+ bytes wastes
+ * memory while the packet is queued, especially when someone tries to do
+ * a denial of service attack!
+ */
+void Packet::ShrinkBuffer()
+{
+	PacketBufferHeader *header = GetPacketBufferHeader(this->buffer);
+	if (this->size > SMALL_PACKET_BUFFER || header->capacity == SMALL_PACKET_BUFFER || header->refcount != 1) return;
+
+	byte *buffer = AllocatePacketBuffer(SMALL_PACKET_BUFFER);
+	MemCpyT(buffer, this->buffer, this->size);
+	FreePacketBuffer(this->buffer);
+	this->buffer = buffer;
+}
+
 /*
  * The next couple of functions make sure we can send
  *  uint8, uint16, uint32 and uint64 endian-safe
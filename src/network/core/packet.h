@@ -52,7 +52,11 @@ struct Packet {
 	PacketSize size;
 	/** The current read/write position in the packet */
 	PacketSize pos;
-	/** The buffer of this packet, of basically variable length up to SEND_MTU. */
+	/**
+	 * The buffer of this packet, of basically variable length up to SEND_MTU.
+	 * Buffers come from a pool and may be shared by multiple packets that are
+	 * sent to different sockets; shared buffers must not be changed.
+	 */
 	byte *buffer;
 
 private:
@@ -62,10 +66,12 @@ private:
 public:
 	Packet(NetworkSocketHandler *cs);
 	Packet(PacketType type);
+	explicit Packet(const Packet *shared);
 	~Packet();
 
 	/* Sending/writing of packets */
 	void PrepareToSend();
+	void ShrinkBuffer();
 
 	void Send_bool  (bool   data);
 	void Send_uint8 (uint8  data);
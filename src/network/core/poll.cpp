@@ -0,0 +1,211 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file poll.cpp Waiting for sockets that are ready for reading or writing.
+ */
+
+#ifdef ENABLE_NETWORK
+
+#include "../../stdafx.h"
+#include "../../debug.h"
+#include "poll.h"
+#include "tcp.h"
+
+#ifdef WITH_EPOLL
+#include <sys/epoll.h>
+#endif
+
+#include "../../safeguards.h"
+
+#ifdef WITH_EPOLL
+/** Bit set in the epoll data of listening sockets; connections are stored as (aligned) pointers. */
+static const uint64 EPOLL_LISTENER_TAG = 1;
+
+/** Maximum number of events handled per poll; the remaining events are reported by the next poll. */
+static const int EPOLL_MAX_EVENTS = 1024;
+
+/**
+ * Add, modify or remove a socket of an epoll instance.
+ * @param epoll_fd The epoll instance.
+ * @param op       The operation, one of EPOLL_CTL_ADD, EPOLL_CTL_MOD and EPOLL_CTL_DEL.
+ * @param s        The socket.
+ * @param events   The events to watch for.
+ * @param data     The data to report with the events.
+ */
+static void EpollControl(int epoll_fd, int op, SOCKET s, uint32 events, uint64 data)
+{
+	struct epoll_event ev;
+	memset(&ev, 0, sizeof(ev));
+	ev.events = events;
+	ev.data.u64 = data;
+	if (epoll_ctl(epoll_fd, op, s, &ev) < 0) DEBUG(net, 0, "epoll_ctl failed with error %d", GET_LAST_ERROR());
+}
+#endif /* WITH_EPOLL */
+
+SocketPoller::SocketPoller()
+{
+#ifdef WITH_EPOLL
+	this->epoll_fd = -1;
+#endif
+}
+
+SocketPoller::~SocketPoller()
+{
+#ifdef WITH_EPOLL
+	if (this->epoll_fd >= 0) close(this->epoll_fd);
+#endif
+}
+
+/**
+ * Start watching a listening socket for connections to accept.
+ * @param s The listening socket.
+ */
+void SocketPoller::AddListener(SOCKET s)
+{
+	*this->listeners.Append() = s;
+#ifdef WITH_EPOLL
+	/* Created on first use, as pollers are static members of the listen handlers. */
+	if (this->epoll_fd < 0) {
+		this->epoll_fd = epoll_create(16);
+		if (this->epoll_fd < 0) usererror("Cannot create epoll instance: error %d", GET_LAST_ERROR());
+	}
+	EpollControl(this->epoll_fd, EPOLL_CTL_ADD, s, EPOLLIN, ((uint64)s << 1) | EPOLL_LISTENER_TAG);
+#endif
+}
+
+/**
+ * Stop watching all listening sockets. Must be called before the sockets are closed.
+ */
+void SocketPoller::RemoveListeners()
+{
+#ifdef WITH_EPOLL
+	for (const SOCKET *s = this->listeners.Begin(); s != this->listeners.End(); s++) {
+		EpollControl(this->epoll_fd, EPOLL_CTL_DEL, *s, 0, 0);
+	}
+#endif
+	this->listeners.Clear();
+	this->acceptable.Clear();
+}
+
+/**
+ * Start watching a connection.
+ * @param handler The connection.
+ */
+void SocketPoller::Add(NetworkTCPSocketHandler *handler)
+{
+	assert(handler->poller == NULL);
+	handler->poller = this;
+	handler->writable = false;
+#ifdef WITH_EPOLL
+	assert(((size_t)handler & EPOLL_LISTENER_TAG) == 0);
+	EpollControl(this->epoll_fd, EPOLL_CTL_ADD, handler->sock, EPOLLIN | EPOLLOUT, (size_t)handler);
+#else
+	*this->handlers.Append() = handler;
+#endif
+}
+
+/**
+ * Stop watching a connection. Must be called before its socket is closed.
+ * @param handler The connection.
+ */
+void SocketPoller::Remove(NetworkTCPSocketHandler *handler)
+{
+	assert(handler->poller == this);
+	handler->poller = NULL;
+#ifdef WITH_EPOLL
+	if (handler->sock != INVALID_SOCKET) EpollControl(this->epoll_fd, EPOLL_CTL_DEL, handler->sock, 0, 0);
+#else
+	this->handlers.Erase(this->handlers.Find(handler));
+#endif
+
+	/* The connection may be removed while the results of the last poll are processed. */
+	for (NetworkTCPSocketHandler **iter = this->readable.Begin(); iter != this->readable.End(); iter++) {
+		if (*iter == handler) *iter = NULL;
+	}
+}
+
+/**
+ * Watch a connection for becoming writable again, as a send could not be completed.
+ * @param handler The connection.
+ */
+void SocketPoller::WatchWritable(NetworkTCPSocketHandler *handler)
+{
+#ifdef WITH_EPOLL
+	EpollControl(this->epoll_fd, EPOLL_CTL_MOD, handler->sock, EPOLLIN | EPOLLOUT, (size_t)handler);
+#endif
+}
+
+/**
+ * Check, without blocking, which sockets are ready.
+ * @return Whether polling succeeded.
+ */
+bool SocketPoller::Poll()
+{
+	this->readable.Clear();
+	this->acceptable.Clear();
+
+#ifdef WITH_EPOLL
+	if (this->epoll_fd < 0) return true;
+
+	static struct epoll_event events[EPOLL_MAX_EVENTS];
+	int n = epoll_wait(this->epoll_fd, events, EPOLL_MAX_EVENTS, 0);
+	if (n < 0) return GET_LAST_ERROR() == EINTR;
+
+	for (int i = 0; i < n; i++) {
+		if ((events[i].data.u64 & EPOLL_LISTENER_TAG) != 0) {
+			*this->acceptable.Append() = (SOCKET)(events[i].data.u64 >> 1);
+			continue;
+		}
+
+		NetworkTCPSocketHandler *handler = (NetworkTCPSocketHandler *)(size_t)events[i].data.u64;
+		if ((events[i].events & EPOLLOUT) != 0) {
+			/* Assume the connection stays writable until a send fails to complete. */
+			handler->writable = true;
+			EpollControl(this->epoll_fd, EPOLL_CTL_MOD, handler->sock, EPOLLIN, (size_t)handler);
+		}
+		if ((events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) != 0) *this->readable.Append() = handler;
+	}
+#else
+	fd_set read_fd, write_fd;
+	struct timeval tv;
+
+	FD_ZERO(&read_fd);
+	FD_ZERO(&write_fd);
+
+	for (NetworkTCPSocketHandler **iter = this->handlers.Begin(); iter != this->handlers.End(); iter++) {
+		FD_SET((*iter)->sock, &read_fd);
+		FD_SET((*iter)->sock, &write_fd);
+	}
+
+	for (const SOCKET *s = this->listeners.Begin(); s != this->listeners.End(); s++) {
+		FD_SET(*s, &read_fd);
+	}
+
+	tv.tv_sec = tv.tv_usec = 0; // don't block at all.
+#if !defined(__MORPHOS__) && !defined(__AMIGA__)
+	if (select(FD_SETSIZE, &read_fd, &write_fd, NULL, &tv) < 0) return false;
+#else
+	if (WaitSelect(FD_SETSIZE, &read_fd, &write_fd, NULL, &tv, NULL) < 0) return false;
+#endif
+
+	for (const SOCKET *s = this->listeners.Begin(); s != this->listeners.End(); s++) {
+		if (FD_ISSET(*s, &read_fd)) *this->acceptable.Append() = *s;
+	}
+
+	for (NetworkTCPSocketHandler **iter = this->handlers.Begin(); iter != this->handlers.End(); iter++) {
+		(*iter)->writable = !!FD_ISSET((*iter)->sock, &write_fd);
+		if (FD_ISSET((*iter)->sock, &read_fd)) *this->readable.Append() = *iter;
+	}
+#endif
+
+	return true;
+}
+
+#endif /* ENABLE_NETWORK */
@@ -0,0 +1,78 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file poll.h Waiting for sockets that are ready for reading or writing.
+ */
+
+#ifndef NETWORK_CORE_POLL_H
+#define NETWORK_CORE_POLL_H
+
+#include "os_abstraction.h"
+#include "../../core/smallvec_type.hpp"
+
+#ifdef ENABLE_NETWORK
+
+#if defined(__linux__)
+/** Use epoll instead of select, so polling does not scale with the number of sockets. */
+#	define WITH_EPOLL
+#endif
+
+class NetworkTCPSocketHandler;
+
+/**
+ * Readiness based polling of a set of TCP connections and listening sockets.
+ * With epoll only the sockets with pending events are reported, and a
+ * connection is only watched for writability after a send could not be
+ * completed. The select fallback checks all sockets on every poll.
+ *
+ * Polling updates NetworkTCPSocketHandler::writable of the connections,
+ * and reports the connections that have something to receive and the
+ * listening sockets that have connections to accept.
+ */
+class SocketPoller {
+#ifdef WITH_EPOLL
+	int epoll_fd;                                         ///< The epoll instance, or -1 when not created yet.
+#else
+	SmallVector<NetworkTCPSocketHandler *, 16> handlers;  ///< The watched connections.
+#endif
+	SmallVector<SOCKET, 2> listeners;                     ///< The watched listening sockets.
+	SmallVector<NetworkTCPSocketHandler *, 16> readable;  ///< Connections with something to receive, as found by the last poll.
+	SmallVector<SOCKET, 2> acceptable;                    ///< Listening sockets with connections to accept, as found by the last poll.
+
+public:
+	SocketPoller();
+	~SocketPoller();
+
+	void AddListener(SOCKET s);
+	void RemoveListeners();
+
+	void Add(NetworkTCPSocketHandler *handler);
+	void Remove(NetworkTCPSocketHandler *handler);
+	void WatchWritable(NetworkTCPSocketHandler *handler);
+
+	bool Poll();
+
+	/**
+	 * Get the connections that have something to receive, as found by the last poll.
+	 * Connections that are removed after the poll are set to \c NULL.
+	 * @return The connections.
+	 */
+	SmallVector<NetworkTCPSocketHandler *, 16> &GetReadable() { return this->readable; }
+
+	/**
+	 * Get the listening sockets that have a connection to accept, as found by the last poll.
+	 * @return The listening sockets.
+	 */
+	const SmallVector<SOCKET, 2> &GetAcceptable() const { return this->acceptable; }
+};
+
+#endif /* ENABLE_NETWORK */
+
+#endif /* NETWORK_CORE_POLL_H */
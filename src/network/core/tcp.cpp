@@ -18,6 +18,13 @@
 
 #include "tcp.h"
 
+#if defined(UNIX) && !defined(__OS2__) && !defined(__MORPHOS__) && !defined(__AMIGA__) && !defined(PSP)
+#	include <sys/uio.h>
+#	define HAS_WRITEV
+/** Maximum number of queued packets that are sent with a single call to writev. */
+static const int MAX_SEND_IOVECS = 16;
+#endif
+
 #include "../../safeguards.h"
 
 /**
@@ -27,7 +34,7 @@
 NetworkTCPSocketHandler::NetworkTCPSocketHandler(SOCKET s) :
 		NetworkSocketHandler(),
 		packet_queue(NULL), packet_recv(NULL),
-		sock(s), writable(false)
+		sock(s), writable(false), poller(NULL)
 {
 }
 
@@ -35,6 +42,7 @@ NetworkTCPSocketHandler::~NetworkTCPSocketHandler()
 {
 	this->CloseConnection();
 
+	if (this->poller != NULL) this->poller->Remove(this);
 	if (this->sock != INVALID_SOCKET) closesocket(this->sock);
 	this->sock = INVALID_SOCKET;
 }
@@ -68,11 +76,7 @@ void NetworkTCPSocketHandler::SendPacket(Packet *packet)
 	assert(packet != NULL);
 
 	packet->PrepareToSend();
-
-	/* Reallocate the packet as in 99+% of the times we send at most 25 bytes and
-	 * keeping the other 1400+ bytes wastes memory, especially when someone tries
-	 * to do a denial of service attack! */
-	packet->buffer = ReallocT(packet->buffer, packet->size);
+	packet->ShrinkBuffer();
 
 	/* Locate last packet buffered for the client */
 	p = this->packet_queue;
@@ -107,7 +111,18 @@ SendPacketsState NetworkTCPSocketHandler::SendPackets(bool closing_down)
 
 	p = this->packet_queue;
 	while (p != NULL) {
+#ifdef HAS_WRITEV
+		/* Hand as many queued packets as possible to the OS in one go. */
+		struct iovec iov[MAX_SEND_IOVECS];
+		int count = 0;
+		for (Packet *q = p; q != NULL && count < MAX_SEND_IOVECS; q = q->next, count++) {
+			iov[count].iov_base = q->buffer + q->pos;
+			iov[count].iov_len  = q->size - q->pos;
+		}
+		res = writev(this->sock, iov, count);
+#else
 		res = send(this->sock, (const char*)p->buffer + p->pos, p->size - p->pos, 0);
+#endif
 		if (res == -1) {
 			int err = GET_LAST_ERROR();
 			if (err != EWOULDBLOCK) {
@@ -118,6 +133,11 @@ SendPacketsState NetworkTCPSocketHandler::SendPackets(bool closing_down)
 				}
 				return SPS_CLOSED;
 			}
+			/* Wait until the OS reports the socket writable again. */
+			if (this->poller != NULL) {
+				this->writable = false;
+				this->poller->WatchWritable(this);
+			}
 			return SPS_PARTLY_SENT;
 		}
 		if (res == 0) {
@@ -126,16 +146,19 @@ SendPacketsState NetworkTCPSocketHandler::SendPackets(bool closing_down)
 			return SPS_CLOSED;
 		}
 
-		p->pos += res;
+		/* Remove the packets that are sent completely. */
+		while (res > 0) {
+			ssize_t left = p->size - p->pos;
+			if (res < left) {
+				p->pos += res;
+				return SPS_PARTLY_SENT;
+			}
 
-		/* Is this packet sent? */
-		if (p->pos == p->size) {
 			/* Go to the next packet */
+			res -= left;
 			this->packet_queue = p->next;
 			delete p;
 			p = this->packet_queue;
-		} else {
-			return SPS_PARTLY_SENT;
 		}
 	}
 
@@ -16,6 +16,7 @@
 
 #include "address.h"
 #include "packet.h"
+#include "poll.h"
 
 #ifdef ENABLE_NETWORK
 
@@ -35,6 +36,7 @@ private:
 public:
 	SOCKET sock;              ///< The socket currently connected to
 	bool writable;            ///< Can we write to this socket?
+	SocketPoller *poller;     ///< The poller watching this socket, or \c NULL when it is not watched.
 
 	/**
 	 * Whether this socket is currently bound to a socket.
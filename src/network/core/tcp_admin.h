@@ -63,6 +63,7 @@ enum PacketAdminType {
 	ADMIN_PACKET_SERVER_GAMESCRIPT,      ///< The server gives the admin information from the GameScript in JSON.
 	ADMIN_PACKET_SERVER_RCON_END,        ///< The server indicates that the remote console command has completed.
 	ADMIN_PACKET_SERVER_PONG,            ///< The server replies to a ping request from the admin.
+	ADMIN_PACKET_SERVER_PERFORMANCE,     ///< The server gives the admin telemetry about its performance.
 
 	INVALID_ADMIN_PACKET = 0xFF,         ///< An invalid marker for admin packets.
 };
@@ -86,6 +87,7 @@ enum AdminUpdateType {
 	ADMIN_UPDATE_CMD_NAMES,       ///< The admin would like a list of all DoCommand names.
 	ADMIN_UPDATE_CMD_LOGGING,     ///< The admin would like to have DoCommand information.
 	ADMIN_UPDATE_GAMESCRIPT,      ///< The admin would like to have gamescript messages.
+	ADMIN_UPDATE_PERFORMANCE,     ///< The admin would like to have performance telemetry.
 	ADMIN_UPDATE_END,             ///< Must ALWAYS be on the end of this list!! (period)
 };
 
@@ -98,6 +100,7 @@ enum AdminUpdateFrequency {
 	ADMIN_FREQUENCY_QUARTERLY = 0x10, ///< The admin gets information about this on a quarterly basis.
 	ADMIN_FREQUENCY_ANUALLY   = 0x20, ///< The admin gets information about this on a yearly basis.
 	ADMIN_FREQUENCY_AUTOMATIC = 0x40, ///< The admin gets information about this when it changes.
+	ADMIN_FREQUENCY_TICKS     = 0x80, ///< The admin gets information about this every given number of ticks.
 };
 DECLARE_ENUM_AS_BIT_SET(AdminUpdateFrequency)
 
@@ -140,6 +143,7 @@ protected:
 	 * Register updates to be sent at certain frequencies (as announced in the PROTOCOL packet):
 	 * uint16  Update type (see #AdminUpdateType).
 	 * uint16  Update frequency (see #AdminUpdateFrequency), setting #ADMIN_FREQUENCY_POLL is always ignored.
+	 * uint16  Number of ticks between the updates, only when the frequency contains #ADMIN_FREQUENCY_TICKS.
 	 * @param p The packet that was just received.
 	 * @return The state the network should have.
 	 */
@@ -473,6 +477,29 @@ protected:
 	 */
 	virtual NetworkRecvStatus Receive_SERVER_PONG(Packet *p);
 
+	/**
+	 * Send telemetry about the performance of the server; all times are in microseconds
+	 * and all totals are counted since the server started:
+	 * uint32  Frame of the game.
+	 * uint64  Total number of game loop ticks.
+	 * uint32  Time the last game loop tick took.
+	 * uint8   Number of game loop phases, followed for each phase by:
+	 *   uint64  Total time spent in the phase.
+	 * uint8   Number of vehicle types, followed for each type by:
+	 *   uint32  Number of vehicles of the type, including articulated parts and wagons.
+	 * uint16  Number of running link graph jobs.
+	 * uint16  Number of link graphs waiting for their next job.
+	 * uint64  Total time the game loop waited for link graph jobs that did not finish in time.
+	 * bool    Whether the names of the pools are included; only when the admin polled.
+	 * uint8   Number of pools, followed for each pool by:
+	 *   string  Name of the pool, only when the names are included.
+	 *   uint32  Number of items in the pool.
+	 *   uint32  Number of items the pool has allocated memory for.
+	 * @param p The packet that was just received.
+	 * @return The state the network should have.
+	 */
+	virtual NetworkRecvStatus Receive_SERVER_PERFORMANCE(Packet *p);
+
 	/**
 	 * Notify the admin connection that the rcon command has finished.
 	 * string The command as requested by the admin connection.
@@ -15,6 +15,7 @@
 #define NETWORK_CORE_TCP_LISTEN_H
 
 #include "tcp.h"
+#include "poll.h"
 #include "../network.h"
 #include "../../core/pool_type.hpp"
 #include "../../debug.h"
@@ -32,6 +33,8 @@ template <class Tsocket, PacketType Tfull_packet, PacketType Tban_packet>
 class TCPListenHandler {
 	/** List of sockets we listen on. */
 	static SocketList sockets;
+	/** Poller of the listening sockets and the accepted connections. */
+	static SocketPoller poller;
 
 public:
 	/**
@@ -89,7 +92,7 @@ public:
 				continue;
 			}
 
-			Tsocket::AcceptConnection(s, address);
+			poller.Add(Tsocket::AcceptConnection(s, address));
 		}
 	}
 
@@ -99,42 +102,18 @@ public:
 	 */
 	static bool Receive()
 	{
-		fd_set read_fd, write_fd;
-		struct timeval tv;
-
-		FD_ZERO(&read_fd);
-		FD_ZERO(&write_fd);
-
-
-		Tsocket *cs;
-		FOR_ALL_ITEMS_FROM(Tsocket, idx, cs, 0) {
-			FD_SET(cs->sock, &read_fd);
-			FD_SET(cs->sock, &write_fd);
-		}
-
-		/* take care of listener port */
-		for (SocketList::iterator s = sockets.Begin(); s != sockets.End(); s++) {
-			FD_SET(s->second, &read_fd);
-		}
-
-		tv.tv_sec = tv.tv_usec = 0; // don't block at all.
-#if !defined(__MORPHOS__) && !defined(__AMIGA__)
-		if (select(FD_SETSIZE, &read_fd, &write_fd, NULL, &tv) < 0) return false;
-#else
-		if (WaitSelect(FD_SETSIZE, &read_fd, &write_fd, NULL, &tv, NULL) < 0) return false;
-#endif
+		if (!poller.Poll()) return false;
 
 		/* accept clients.. */
-		for (SocketList::iterator s = sockets.Begin(); s != sockets.End(); s++) {
-			if (FD_ISSET(s->second, &read_fd)) AcceptClient(s->second);
+		const SmallVector<SOCKET, 2> &acceptable = poller.GetAcceptable();
+		for (const SOCKET *s = acceptable.Begin(); s != acceptable.End(); s++) {
+			AcceptClient(*s);
 		}
 
-		/* read stuff from clients */
-		FOR_ALL_ITEMS_FROM(Tsocket, idx, cs, 0) {
-			cs->writable = !!FD_ISSET(cs->sock, &write_fd);
-			if (FD_ISSET(cs->sock, &read_fd)) {
-				cs->ReceivePackets();
-			}
+		/* read stuff from clients; receiving may close other connections, which are then set to NULL */
+		SmallVector<NetworkTCPSocketHandler *, 16> &readable = poller.GetReadable();
+		for (uint i = 0; i < readable.Length(); i++) {
+			if (*readable.Get(i) != NULL) static_cast<Tsocket *>(*readable.Get(i))->ReceivePackets();
 		}
 		return _networking;
 	}
@@ -155,6 +134,10 @@ public:
 			address->Listen(SOCK_STREAM, &sockets);
 		}
 
+		for (SocketList::iterator s = sockets.Begin(); s != sockets.End(); s++) {
+			poller.AddListener(s->second);
+		}
+
 		if (sockets.Length() == 0) {
 			DEBUG(net, 0, "[server] could not start network: could not create listening socket");
 			NetworkError(STR_NETWORK_ERROR_SERVER_START);
@@ -167,6 +150,7 @@ public:
 	/** Close the sockets we're listening on. */
 	static void CloseListeners()
 	{
+		poller.RemoveListeners();
 		for (SocketList::iterator s = sockets.Begin(); s != sockets.End(); s++) {
 			closesocket(s->second);
 		}
@@ -176,6 +160,7 @@ public:
 };
 
 template <class Tsocket, PacketType Tfull_packet, PacketType Tban_packet> SocketList TCPListenHandler<Tsocket, Tfull_packet, Tban_packet>::sockets;
+template <class Tsocket, PacketType Tfull_packet, PacketType Tban_packet> SocketPoller TCPListenHandler<Tsocket, Tfull_packet, Tban_packet>::poller;
 
 #endif /* ENABLE_NETWORK */
 
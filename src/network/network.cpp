@@ -57,6 +57,7 @@ bool _networking;         ///< are we in networking mode?
 bool _network_server;     ///< network-server is active
 bool _network_available;  ///< is network mode available?
 bool _network_dedicated;  ///< are we a dedicated server?
+bool _network_relay;      ///< are we relaying another server to our clients?
 bool _is_network_server;  ///< Does this client wants to be a network-server?
 NetworkServerGameInfo _network_game_info; ///< Information about our game.
 NetworkCompanyState *_network_company_states = NULL; ///< Statistics about some companies.
@@ -78,6 +79,8 @@ uint32 _sync_seed_1;                  ///< Seed to compare during sync checks.
 uint32 _sync_seed_2;                  ///< Second part of the seed.
 #endif
 uint32 _sync_frame;                   ///< The frame to perform the sync check.
+uint32 _sync_checksums[SCS_END];      ///< Checksums of the parts of the game state to compare during sync checks.
+uint8 _sync_checksum_count;           ///< Number of valid entries in _sync_checksums; 0 when the server does not send them.
 bool _network_first_time;             ///< Whether we have finished joining or not.
 bool _network_udp_server;             ///< Is the UDP server started?
 uint16 _network_udp_broadcast;        ///< Timeout for the UDP broadcasts.
@@ -504,8 +507,9 @@ void ParseConnectionString(const char **company, const char **port, char *connec
  * Handle the accepting of a connection to the server.
  * @param s The socket of the new connection.
  * @param address The address of the peer.
+ * @return The handler of the new connection.
  */
-/* static */ void ServerNetworkGameSocketHandler::AcceptConnection(SOCKET s, const NetworkAddress &address)
+/* static */ ServerNetworkGameSocketHandler *ServerNetworkGameSocketHandler::AcceptConnection(SOCKET s, const NetworkAddress &address)
 {
 	/* Register the login */
 	_network_clients_connected++;
@@ -513,6 +517,7 @@ void ParseConnectionString(const char **company, const char **port, char *connec
 	SetWindowDirty(WC_CLIENT_LIST, 0);
 	ServerNetworkGameSocketHandler *cs = new ServerNetworkGameSocketHandler(s);
 	cs->client_address = address; // Save the IP of the client
+	return cs;
 }
 
 /**
@@ -544,9 +549,20 @@ void NetworkClose(bool close_admins)
 		}
 		ServerNetworkGameSocketHandler::CloseListeners();
 		ServerNetworkAdminSocketHandler::CloseListeners();
-	} else if (MyClient::my_client != NULL) {
-		MyClient::SendQuit();
-		MyClient::my_client->CloseConnection(NETWORK_RECV_STATUS_CONN_LOST);
+	} else {
+		/* A relay serves its own clients, even when the connection to the relayed server is gone already. */
+		if (_network_relay) {
+			NetworkClientSocket *cs;
+			FOR_ALL_CLIENT_SOCKETS(cs) {
+				cs->CloseConnection(NETWORK_RECV_STATUS_CONN_LOST);
+			}
+			ServerNetworkGameSocketHandler::CloseListeners();
+		}
+
+		if (MyClient::my_client != NULL) {
+			MyClient::SendQuit();
+			MyClient::my_client->CloseConnection(NETWORK_RECV_STATUS_CONN_LOST);
+		}
 	}
 
 	TCPConnecter::KillAll();
@@ -799,14 +815,14 @@ void NetworkReboot()
  */
 void NetworkDisconnect(bool blocking, bool close_admins)
 {
-	if (_network_server) {
+	if (_network_server || _network_relay) {
 		NetworkClientSocket *cs;
 		FOR_ALL_CLIENT_SOCKETS(cs) {
 			cs->SendShutdown();
 			cs->SendPackets();
 		}
 
-		if (close_admins) {
+		if (close_admins && _network_server) {
 			ServerNetworkAdminSocketHandler *as;
 			FOR_ALL_ACTIVE_ADMIN_SOCKETS(as) {
 				as->SendShutdown();
@@ -835,6 +851,7 @@ static bool NetworkReceive()
 		ServerNetworkAdminSocketHandler::Receive();
 		return ServerNetworkGameSocketHandler::Receive();
 	} else {
+		if (_network_relay) ServerNetworkGameSocketHandler::Receive();
 		return ClientNetworkGameSocketHandler::Receive();
 	}
 }
@@ -846,6 +863,7 @@ static void NetworkSend()
 		ServerNetworkAdminSocketHandler::Send();
 		ServerNetworkGameSocketHandler::Send();
 	} else {
+		if (_network_relay) ServerNetworkGameSocketHandler::Send();
 		ClientNetworkGameSocketHandler::Send();
 	}
 }
@@ -1008,6 +1026,7 @@ void NetworkGameLoop()
 #endif
 
 		NetworkServer_Tick(send_frame);
+		NetworkAdminTick();
 	} else {
 		/* Client */
 
@@ -1024,6 +1043,8 @@ void NetworkGameLoop()
 				if (!ClientNetworkGameSocketHandler::GameLoop()) return;
 			}
 		}
+
+		if (_network_relay) NetworkRelay_Tick();
 	}
 
 	NetworkSend();
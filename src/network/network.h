@@ -24,6 +24,7 @@ extern bool _networking;         ///< are we in networking mode?
 extern bool _network_server;     ///< network-server is active
 extern bool _network_available;  ///< is network mode available?
 extern bool _network_dedicated;  ///< are we a dedicated server?
+extern bool _network_relay;      ///< are we relaying another server to our clients?
 extern bool _is_network_server;  ///< Does this client wants to be a network-server?
 
 #else /* ENABLE_NETWORK */
@@ -38,6 +39,7 @@ static inline bool HasClients() { return false; }
 #define _network_server 0
 #define _network_available 0
 #define _network_dedicated 0
+#define _network_relay 0
 #define _is_network_server 0
 
 #endif /* ENABLE_NETWORK */
@@ -23,7 +23,10 @@
 #include "../core/pool_func.hpp"
 #include "../map_func.h"
 #include "../rev.h"
+#include "../replay.h"
+#include "../vehicle_base.h"
 #include "../game/game.hpp"
+#include "../linkgraph/linkgraphschedule.h"
 
 #include "../safeguards.h"
 
@@ -56,6 +59,7 @@ static const AdminUpdateFrequency _admin_update_type_frequencies[] = {
 	ADMIN_FREQUENCY_POLL,                                                                                                                                  ///< ADMIN_UPDATE_CMD_NAMES
 	                       ADMIN_FREQUENCY_AUTOMATIC,                                                                                                      ///< ADMIN_UPDATE_CMD_LOGGING
 	                       ADMIN_FREQUENCY_AUTOMATIC,                                                                                                      ///< ADMIN_UPDATE_GAMESCRIPT
+	ADMIN_FREQUENCY_POLL | ADMIN_FREQUENCY_TICKS,                                                                                                          ///< ADMIN_UPDATE_PERFORMANCE
 };
 /** Sanity check. */
 assert_compile(lengthof(_admin_update_type_frequencies) == ADMIN_UPDATE_END);
@@ -115,11 +119,13 @@ ServerNetworkAdminSocketHandler::~ServerNetworkAdminSocketHandler()
  * Handle the acception of a connection.
  * @param s The socket of the new connection.
  * @param address The address of the peer.
+ * @return The handler of the new connection.
  */
-/* static */ void ServerNetworkAdminSocketHandler::AcceptConnection(SOCKET s, const NetworkAddress &address)
+/* static */ ServerNetworkAdminSocketHandler *ServerNetworkAdminSocketHandler::AcceptConnection(SOCKET s, const NetworkAddress &address)
 {
 	ServerNetworkAdminSocketHandler *as = new ServerNetworkAdminSocketHandler(s);
 	as->address = address; // Save the IP of the client
+	return as;
 }
 
 /***********
@@ -663,6 +669,60 @@ NetworkRecvStatus ServerNetworkAdminSocketHandler::SendCmdLogging(ClientID clien
 	return NETWORK_RECV_STATUS_OKAY;
 }
 
+/**
+ * Create a packet with telemetry about the performance of the server.
+ * @param pool_names Whether to include the names of the pools.
+ * @return The packet.
+ */
+static Packet *NewPerformancePacket(bool pool_names)
+{
+	Packet *p = new Packet(ADMIN_PACKET_SERVER_PERFORMANCE);
+
+	p->Send_uint32(_frame_counter);
+	p->Send_uint64(_game_loop_timings.ticks);
+	p->Send_uint32((uint32)min<uint64>(_game_loop_timings.last_tick_time, UINT32_MAX));
+	p->Send_uint8 (GLP_END);
+	for (uint i = 0; i < GLP_END; i++) {
+		p->Send_uint64(_game_loop_timings.phase_time[i]);
+	}
+
+	uint32 vehicles[VEH_END];
+	memset(vehicles, 0, sizeof(vehicles));
+	const Vehicle *v;
+	FOR_ALL_VEHICLES(v) vehicles[v->type]++;
+	p->Send_uint8 (VEH_END);
+	for (uint i = 0; i < VEH_END; i++) {
+		p->Send_uint32(vehicles[i]);
+	}
+
+	const LinkGraphSchedule &schedule = LinkGraphSchedule::instance;
+	p->Send_uint16(min<uint>(schedule.GetNumRunning(), UINT16_MAX));
+	p->Send_uint16(min<uint>(schedule.GetNumQueued(), UINT16_MAX));
+	p->Send_uint64(schedule.GetJoinWaitTime());
+
+	const PoolVector *pools = PoolBase::GetPools();
+	p->Send_bool  (pool_names);
+	p->Send_uint8 (pools->Length());
+	for (PoolBase * const *ppool = pools->Begin(); ppool != pools->End(); ppool++) {
+		if (pool_names) p->Send_string((*ppool)->GetName());
+		p->Send_uint32((uint32)(*ppool)->GetNumItems());
+		p->Send_uint32((uint32)(*ppool)->GetAllocatedSize());
+	}
+
+	return p;
+}
+
+/**
+ * Send telemetry about the performance of the server.
+ * @param shared The performance packet, without pool names, to share with other admins; \c NULL to poll.
+ */
+NetworkRecvStatus ServerNetworkAdminSocketHandler::SendPerformance(const Packet *shared)
+{
+	this->SendPacket(shared != NULL ? new Packet(shared) : NewPerformancePacket(true));
+
+	return NETWORK_RECV_STATUS_OKAY;
+}
+
 /***********
  * Receiving functions
  ************/
@@ -707,14 +767,16 @@ NetworkRecvStatus ServerNetworkAdminSocketHandler::Receive_ADMIN_UPDATE_FREQUENC
 
 	AdminUpdateType type = (AdminUpdateType)p->Recv_uint16();
 	AdminUpdateFrequency freq = (AdminUpdateFrequency)p->Recv_uint16();
+	uint16 ticks = (freq & ADMIN_FREQUENCY_TICKS) ? p->Recv_uint16() : 0;
 
-	if (type >= ADMIN_UPDATE_END || (_admin_update_type_frequencies[type] & freq) != freq) {
+	if (type >= ADMIN_UPDATE_END || (_admin_update_type_frequencies[type] & freq) != freq || ((freq & ADMIN_FREQUENCY_TICKS) && ticks == 0)) {
 		/* The server does not know of this UpdateType. */
 		DEBUG(net, 3, "[admin] Not supported update frequency %d (%d) from '%s' (%s).", type, freq, this->admin_name, this->admin_version);
 		return this->SendError(NETWORK_ERROR_ILLEGAL_PACKET);
 	}
 
 	this->update_frequency[type] = freq;
+	this->update_ticks[type] = ticks;
 
 	return NETWORK_RECV_STATUS_OKAY;
 }
@@ -778,6 +840,11 @@ NetworkRecvStatus ServerNetworkAdminSocketHandler::Receive_ADMIN_POLL(Packet *p)
 			this->SendCmdNames();
 			break;
 
+		case ADMIN_UPDATE_PERFORMANCE:
+			/* The admin is requesting performance telemetry. */
+			this->SendPerformance();
+			break;
+
 		default:
 			/* An unsupported "poll" update type. */
 			DEBUG(net, 3, "[admin] Not supported poll %d (%d) from '%s' (%s).", type, d1, this->admin_name, this->admin_version);
@@ -1046,4 +1113,25 @@ void NetworkAdminUpdate(AdminUpdateFrequency freq)
 	}
 }
 
+/**
+ * Send the updates that admins want every given number of ticks.
+ * This is called after every tick of the game loop.
+ */
+void NetworkAdminTick()
+{
+	/* The telemetry is the same for all admins, so create it only once. */
+	Packet *performance = NULL;
+
+	ServerNetworkAdminSocketHandler *as;
+	FOR_ALL_ACTIVE_ADMIN_SOCKETS(as) {
+		if (!(as->update_frequency[ADMIN_UPDATE_PERFORMANCE] & ADMIN_FREQUENCY_TICKS)) continue;
+		if (_frame_counter % as->update_ticks[ADMIN_UPDATE_PERFORMANCE] != 0) continue;
+
+		if (performance == NULL) performance = NewPerformancePacket(false);
+		as->SendPerformance(performance);
+	}
+
+	delete performance;
+}
+
 #endif /* ENABLE_NETWORK */
@@ -30,6 +30,7 @@
 #include "network.h"
 #include "network_base.h"
 #include "network_client.h"
+#include "network_server.h"
 #include "../core/backup_type.hpp"
 
 #include "table/strings.h"
@@ -248,10 +249,23 @@ void ClientNetworkGameSocketHandler::ClientError(NetworkRecvStatus res)
 	if (_sync_frame != 0) {
 		if (_sync_frame == _frame_counter) {
 #ifdef NETWORK_SEND_DOUBLE_SEED
-			if (_sync_seed_1 != _random.state[0] || _sync_seed_2 != _random.state[1]) {
+			bool desync = _sync_seed_1 != _random.state[0] || _sync_seed_2 != _random.state[1];
 #else
-			if (_sync_seed_1 != _random.state[0]) {
+			bool desync = _sync_seed_1 != _random.state[0];
 #endif
+			if (_sync_checksum_count != 0) {
+				uint32 checksums[SCS_END];
+				CalculateSyncChecksums(checksums);
+
+				for (uint i = 0; i < _sync_checksum_count; i++) {
+					if (checksums[i] == _sync_checksums[i]) continue;
+
+					DEBUG(net, 0, "Sync error in the %s at frame %d", GetSyncChecksumName((SyncChecksumSubsystem)i), _frame_counter);
+					desync = true;
+				}
+			}
+
+			if (desync) {
 				NetworkError(STR_NETWORK_ERROR_DESYNC);
 				DEBUG(desync, 1, "sync_err: %08x; %02x", _date, _date_fract);
 				DEBUG(net, 0, "Sync error detected!");
@@ -596,6 +610,8 @@ NetworkRecvStatus ClientNetworkGameSocketHandler::Receive_SERVER_CLIENT_INFO(Pac
 	if (this->status < STATUS_AUTHORIZED) return NETWORK_RECV_STATUS_MALFORMED_PACKET;
 	if (this->HasClientQuit()) return NETWORK_RECV_STATUS_CONN_LOST;
 
+	if (_network_relay) NetworkRelayPacket(p);
+
 	ci = NetworkClientInfo::GetByClientID(client_id);
 	if (ci != NULL) {
 		if (playas == ci->client_playas && strcmp(name, ci->client_name) != 0) {
@@ -849,6 +865,13 @@ NetworkRecvStatus ClientNetworkGameSocketHandler::Receive_SERVER_MAP_DONE(Packet
 	/* If the savegame has successfully loaded, ALL windows have been removed,
 	 * only toolbar/statusbar and gamefield are visible */
 
+	/* With the map a relay can serve its own clients; a relay that cannot has no reason to stay. */
+	if (_network_relay && !NetworkRelayStart()) {
+		DEBUG(net, 0, "Could not start listening for relayed clients on port %d, disconnecting", _settings_client.network.server_port);
+		ShowErrorMessage(STR_NETWORK_ERROR_SERVER_START, INVALID_STRING_ID, WL_CRITICAL);
+		return NETWORK_RECV_STATUS_CONN_LOST;
+	}
+
 	/* Say we received the map and loaded it correctly! */
 	SendMapOk();
 
@@ -915,6 +938,13 @@ NetworkRecvStatus ClientNetworkGameSocketHandler::Receive_SERVER_SYNC(Packet *p)
 	_sync_seed_2 = p->Recv_uint32();
 #endif
 
+	/* The checksums of parts of the game state are only there when the server has them enabled. */
+	_sync_checksum_count = 0;
+	if (p->pos < p->size) {
+		_sync_checksum_count = min<uint>(p->Recv_uint8(), SCS_END);
+		for (uint i = 0; i < _sync_checksum_count; i++) _sync_checksums[i] = p->Recv_uint32();
+	}
+
 	return NETWORK_RECV_STATUS_OKAY;
 }
 
@@ -933,6 +963,7 @@ NetworkRecvStatus ClientNetworkGameSocketHandler::Receive_SERVER_COMMAND(Packet
 	}
 
 	this->incoming_queue.Append(&cp);
+	if (_network_relay) NetworkRelayCommand(&cp);
 
 	return NETWORK_RECV_STATUS_OKAY;
 }
@@ -950,6 +981,9 @@ NetworkRecvStatus ClientNetworkGameSocketHandler::Receive_SERVER_CHAT(Packet *p)
 	p->Recv_string(msg, NETWORK_CHAT_LENGTH);
 	int64 data = p->Recv_uint64();
 
+	/* Private messages to the relay itself are not for its clients. */
+	if (_network_relay && action != NETWORK_ACTION_CHAT_CLIENT) NetworkRelayPacket(p);
+
 	ci_to = NetworkClientInfo::GetByClientID(client_id);
 	if (ci_to == NULL) return NETWORK_RECV_STATUS_OKAY;
 
@@ -993,6 +1027,8 @@ NetworkRecvStatus ClientNetworkGameSocketHandler::Receive_SERVER_ERROR_QUIT(Pack
 {
 	if (this->status < STATUS_AUTHORIZED) return NETWORK_RECV_STATUS_MALFORMED_PACKET;
 
+	if (_network_relay) NetworkRelayPacket(p);
+
 	ClientID client_id = (ClientID)p->Recv_uint32();
 
 	NetworkClientInfo *ci = NetworkClientInfo::GetByClientID(client_id);
@@ -1010,6 +1046,8 @@ NetworkRecvStatus ClientNetworkGameSocketHandler::Receive_SERVER_QUIT(Packet *p)
 {
 	if (this->status < STATUS_AUTHORIZED) return NETWORK_RECV_STATUS_MALFORMED_PACKET;
 
+	if (_network_relay) NetworkRelayPacket(p);
+
 	ClientID client_id = (ClientID)p->Recv_uint32();
 
 	NetworkClientInfo *ci = NetworkClientInfo::GetByClientID(client_id);
@@ -1030,6 +1068,8 @@ NetworkRecvStatus ClientNetworkGameSocketHandler::Receive_SERVER_JOIN(Packet *p)
 {
 	if (this->status < STATUS_AUTHORIZED) return NETWORK_RECV_STATUS_MALFORMED_PACKET;
 
+	if (_network_relay) NetworkRelayPacket(p);
+
 	ClientID client_id = (ClientID)p->Recv_uint32();
 
 	NetworkClientInfo *ci = NetworkClientInfo::GetByClientID(client_id);
@@ -1101,6 +1141,8 @@ NetworkRecvStatus ClientNetworkGameSocketHandler::Receive_SERVER_MOVE(Packet *p)
 	/* Just make sure we do not try to use a client_index that does not exist */
 	if (ci == NULL) return NETWORK_RECV_STATUS_OKAY;
 
+	if (_network_relay) NetworkRelayPacket(p);
+
 	/* if not valid player, force spectator, else check player exists */
 	if (!Company::IsValidID(company_id)) company_id = COMPANY_SPECTATOR;
 
@@ -1115,6 +1157,8 @@ NetworkRecvStatus ClientNetworkGameSocketHandler::Receive_SERVER_CONFIG_UPDATE(P
 {
 	if (this->status < STATUS_ACTIVE) return NETWORK_RECV_STATUS_MALFORMED_PACKET;
 
+	if (_network_relay) NetworkRelayPacket(p);
+
 	_network_server_max_companies = p->Recv_uint8();
 	_network_server_max_spectators = p->Recv_uint8();
 
@@ -1125,6 +1169,8 @@ NetworkRecvStatus ClientNetworkGameSocketHandler::Receive_SERVER_COMPANY_UPDATE(
 {
 	if (this->status < STATUS_ACTIVE) return NETWORK_RECV_STATUS_MALFORMED_PACKET;
 
+	if (_network_relay) NetworkRelayPacket(p);
+
 	_network_company_passworded = p->Recv_uint16();
 	SetWindowClassesDirty(WC_COMPANY);
 
@@ -42,6 +42,7 @@ private:
 protected:
 	friend void NetworkExecuteLocalCommandQueue();
 	friend void NetworkClose(bool close_admins);
+	friend void NetworkSyncCommandQueue(CommandQueue *queue);
 	static ClientNetworkGameSocketHandler *my_client; ///< This is us!
 
 	virtual NetworkRecvStatus Receive_SERVER_FULL(Packet *p);
@@ -17,6 +17,7 @@
 #include "network_server.h"
 #include "../command_func.h"
 #include "../company_func.h"
+#include "../map_func.h"
 #include "../settings_type.h"
 
 #include "../safeguards.h"
@@ -172,20 +173,24 @@ void NetworkSendCommand(TileIndex tile, uint32 p1, uint32 p2, uint32 cmd, Comman
 }
 
 /**
- * Sync our local command queue to the command queue of the given
- * socket. This is needed for the case where we receive a command
- * before saving the game for a joining client, but without the
- * execution of those commands. Not syncing those commands means
- * that the client will never get them and as such will be in a
- * desynced state from the time it started with joining.
- * @param cs The client to sync the queue to.
+ * Sync our local command queue to the given command queue. This is
+ * needed for the case where we receive a command before saving the
+ * game for joining clients, but without the execution of those
+ * commands. Not syncing those commands means that the clients will
+ * never get them and as such will be in a desynced state from the
+ * time they started with joining.
+ * @param queue The queue to sync our local command queue to.
  */
-void NetworkSyncCommandQueue(NetworkClientSocket *cs)
+void NetworkSyncCommandQueue(CommandQueue *queue)
 {
-	for (CommandPacket *p = _local_execution_queue.Peek(); p != NULL; p = p->next) {
+	/* A relay has not executed the commands it received from the relayed server yet. */
+	CommandQueue &pending = (_network_relay ? ClientNetworkGameSocketHandler::my_client->incoming_queue : _local_execution_queue);
+
+	for (CommandPacket *p = pending.Peek(); p != NULL; p = p->next) {
 		CommandPacket c = *p;
 		c.callback = 0;
-		cs->outgoing_queue.Append(&c);
+		c.my_cmd = false;
+		queue->Append(&c);
 	}
 }
 
@@ -253,27 +258,102 @@ static void DistributeCommandPacket(CommandPacket &cp, const NetworkClientSocket
 		}
 	}
 
+	NetworkAddMapSnapshotCommand(&cp);
+
 	cp.callback = (cs != owner) ? NULL : callback;
 	cp.my_cmd = (cs == owner);
 	_local_execution_queue.Append(&cp);
 }
 
+/**
+ * Pass a command of the relayed server on to the clients of a relay.
+ * @param cp The command, with the frame it is executed in by the relayed server.
+ */
+void NetworkRelayCommand(const CommandPacket *cp)
+{
+	CommandPacket c = *cp;
+	c.callback = NULL;
+	c.my_cmd = false;
+
+	NetworkClientSocket *cs;
+	FOR_ALL_CLIENT_SOCKETS(cs) {
+		if (cs->status >= NetworkClientSocket::STATUS_MAP) cs->outgoing_queue.Append(&c);
+	}
+
+	NetworkAddMapSnapshotCommand(&c);
+}
+
+/**
+ * Estimate how expensive executing a command is. Most commands affect a
+ * single tile or object, but dragged commands affect a whole line or area
+ * of tiles and thus cost as much as the tiles in it.
+ * @param cp The command to estimate the cost of.
+ * @return The cost; at least 1.
+ */
+static uint GetCommandExecutionCost(const CommandPacket *cp)
+{
+	TileIndex other;
+	bool area;
+	switch (cp->cmd & CMD_ID_MASK) {
+		case CMD_BUILD_RAILROAD_TRACK:
+		case CMD_REMOVE_RAILROAD_TRACK:
+		case CMD_BUILD_LONG_ROAD:
+		case CMD_REMOVE_LONG_ROAD:
+		case CMD_BUILD_SIGNAL_TRACK:
+		case CMD_REMOVE_SIGNAL_TRACK:
+			other = cp->p1;
+			area = false;
+			break;
+
+		case CMD_CLEAR_AREA:
+		case CMD_LEVEL_LAND:
+		case CMD_BUILD_CANAL:
+		case CMD_CONVERT_RAIL:
+			other = cp->p1;
+			area = true;
+			break;
+
+		case CMD_PLANT_TREE:
+			other = cp->p2;
+			area = true;
+			break;
+
+		default:
+			return 1;
+	}
+
+	/* Invalid tiles make the command fail quickly. */
+	if (cp->tile >= MapSize() || other >= MapSize()) return 1;
+
+	uint dx = Delta(TileX(cp->tile), TileX(other)) + 1;
+	uint dy = Delta(TileY(cp->tile), TileY(other)) + 1;
+	return area ? dx * dy : dx + dy - 1;
+}
+
 /**
  * "Send" a particular CommandQueue to all clients.
+ * The commands of a client are limited by the cost they may still execute,
+ * so a client flooding the server with (dragged) commands cannot delay the
+ * frames of everybody else.
  * @param queue The queue of commands that has to be distributed.
- * @param owner The client that owns the commands,
+ * @param owner The client that owns the commands, or \c NULL for the server.
  */
-static void DistributeQueue(CommandQueue *queue, const NetworkClientSocket *owner)
+static void DistributeQueue(CommandQueue *queue, NetworkClientSocket *owner)
 {
 #ifdef DEBUG_DUMP_COMMANDS
 	/* When replaying we do not want this limitation. */
 	int to_go = UINT16_MAX;
+	bool limited = false;
 #else
 	int to_go = _settings_client.network.commands_per_frame;
+	bool limited = owner != NULL;
 #endif
 
 	CommandPacket *cp;
-	while (--to_go >= 0 && (cp = queue->Pop(true)) != NULL) {
+	while (--to_go >= 0 && (!limited || owner->command_limit > 0) && (cp = queue->Pop(true)) != NULL) {
+		/* The limit may go negative; the client then has to wait until it is positive again.
+		 * A single command costs at most the burst, so one huge drag does not block the client for long. */
+		if (limited) owner->command_limit -= min<uint>(GetCommandExecutionCost(cp), _settings_client.network.command_cost_burst);
 		DistributeCommandPacket(*cp, owner);
 		NetworkAdminCmdLogging(owner, cp);
 		free(cp);
@@ -16,6 +16,7 @@
 #include "core/tcp_game.h"
 
 #include "../command_type.h"
+#include "../sync_checksum.h"
 
 #ifdef ENABLE_NETWORK
 
@@ -121,6 +122,8 @@ extern uint32 _sync_seed_1;
 extern uint32 _sync_seed_2;
 #endif
 extern uint32 _sync_frame;
+extern uint32 _sync_checksums[];
+extern uint8 _sync_checksum_count;
 extern bool _network_first_time;
 /* Vars needed for the join-GUI */
 extern NetworkJoinStatus _network_join_status;
@@ -162,7 +165,9 @@ struct CommandPacket : CommandContainer {
 void NetworkDistributeCommands();
 void NetworkExecuteLocalCommandQueue();
 void NetworkFreeLocalCommandQueue();
-void NetworkSyncCommandQueue(NetworkClientSocket *cs);
+void NetworkSyncCommandQueue(CommandQueue *queue);
+void NetworkRelayCommand(const CommandPacket *cp);
+void NetworkAddMapSnapshotCommand(const CommandPacket *cp);
 
 void NetworkError(StringID error_string);
 void NetworkTextMessage(NetworkAction action, TextColour colour, bool self_send, const char *name, const char *str = "", int64 data = 0);
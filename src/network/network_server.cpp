@@ -54,125 +54,95 @@ INSTANTIATE_POOL_METHODS(NetworkClientSocket)
 /** Instantiate the listen sockets. */
 template SocketList TCPListenHandler<ServerNetworkGameSocketHandler, PACKET_SERVER_FULL, PACKET_SERVER_BANNED>::sockets;
 
-/** Writing a savegame directly to a number of packets. */
-struct PacketWriter : SaveFilter {
-	ServerNetworkGameSocketHandler *cs; ///< Socket we are associated with.
-	Packet *current;                    ///< The packet we're currently writing to.
-	size_t total_size;                  ///< Total size of the compressed savegame.
-	Packet *packets;                    ///< Packet queue of the savegame; send these "slowly" to the client.
-	ThreadMutex *mutex;                 ///< Mutex for making threaded saving safe.
-
-	/**
-	 * Create the packet writer.
-	 * @param cs The socket handler we're making the packets for.
-	 */
-	PacketWriter(ServerNetworkGameSocketHandler *cs) : SaveFilter(NULL), cs(cs), current(NULL), total_size(0), packets(NULL)
+/**
+ * A savegame for joining clients, split into packets. All clients that request
+ * the map while the snapshot is recent download these same packets, so a burst
+ * of joining clients costs a single save and they do not have to wait for each
+ * other to finish downloading.
+ */
+struct MapSnapshot {
+	SmallVector<Packet *, 64> packets; ///< The packets of the savegame; once it is complete the last one is the PACKET_SERVER_MAP_DONE.
+	size_t total_size;                 ///< Total size of the compressed savegame.
+	bool finished;                     ///< Whether the savegame has been written completely.
+	bool aborted;                      ///< Whether nobody is interested in the savegame anymore, so writing it has to stop.
+	uint32 frame;                      ///< The frame the savegame has been made in.
+	uint32 start_time;                 ///< Realtime tick the saving started.
+	uint clients;                      ///< Number of clients that are downloading this savegame.
+	uint joiners;                      ///< Number of clients that have started downloading this savegame.
+	CommandQueue commands;             ///< Commands to execute after loading the savegame; this includes the ones distributed after it has been made.
+	ThreadMutex *mutex;                ///< Mutex for making threaded saving safe.
+
+	MapSnapshot() : total_size(0), finished(false), aborted(false), frame(_frame_counter), start_time(_realtime_tick), clients(0), joiners(0)
 	{
 		this->mutex = ThreadMutex::New();
 	}
 
-	/** Make sure everything is cleaned up. */
-	~PacketWriter()
+	~MapSnapshot()
 	{
-		if (this->mutex != NULL) this->mutex->BeginCritical();
-
-		if (this->cs != NULL && this->mutex != NULL) {
-			this->mutex->WaitForSignal();
-		}
-
-		/* This must all wait until the Destroy function is called. */
-
-		while (this->packets != NULL) {
-			Packet *p = this->packets->next;
-			delete this->packets;
-			this->packets = p;
-		}
-
-		delete this->current;
-
-		if (this->mutex != NULL) this->mutex->EndCritical();
-
+		for (Packet **p = this->packets.Begin(); p != this->packets.End(); p++) delete *p;
 		delete this->mutex;
-		this->mutex = NULL;
 	}
 
 	/**
-	 * Begin the destruction of this packet writer. It can happen in two ways:
-	 * in the first case the client disconnected while saving the map. In this
-	 * case the saving has not finished and killed this PacketWriter. In that
-	 * case we simply set cs to NULL, triggering the appending to fail due to
-	 * the connection problem and eventually triggering the destructor. In the
-	 * second case the destructor is already called, and it is waiting for our
-	 * signal which we will send. Only then the packets will be removed by the
-	 * destructor.
+	 * Whether clients that request the map can still start downloading this snapshot.
+	 * As every joining client has to execute all commands since the snapshot, it
+	 * is only shared for a limited time after it has been written.
+	 * @return True iff the snapshot is still being written or recent enough.
 	 */
-	void Destroy()
+	bool IsJoinable()
 	{
-		if (this->mutex != NULL) this->mutex->BeginCritical();
+		static const uint MAX_AGE = 10 * DAY_TICKS; ///< Number of frames a finished snapshot is handed out for.
 
-		this->cs = NULL;
+		this->mutex->BeginCritical();
+		bool finished = this->finished;
+		this->mutex->EndCritical();
 
-		if (this->mutex != NULL) this->mutex->SendSignal();
+		return !finished || _frame_counter - this->frame <= MAX_AGE;
+	}
+};
 
-		if (this->mutex != NULL) this->mutex->EndCritical();
+/** The snapshot clients that request the map start downloading, or \c NULL when a new one has to be made. */
+static MapSnapshot *_map_snapshot = NULL;
 
-		/* Make sure the saving is completely cancelled. Yes,
-		 * we need to handle the save finish as well as the
-		 * next connection might just be requesting a map. */
-		WaitTillSaved();
-		ProcessAsyncSaveFinish();
-	}
+/**
+ * Writing a savegame directly to the packets of a map snapshot.
+ * This filter is owned, and deleted, by the saveload code; the snapshot is owned by its clients.
+ */
+struct PacketWriter : SaveFilter {
+	MapSnapshot *snapshot; ///< The snapshot we're writing the packets of.
+	Packet *current;       ///< The packet we're currently writing to.
 
 	/**
-	 * Checks whether there are packets.
-	 * It's not 100% threading safe, but this is only asked for when checking
-	 * whether there still is something to send. Then another call will be made
-	 * to actually get the Packet, which will be the only one popping packets
-	 * and thus eventually setting this on false.
+	 * Create the packet writer.
+	 * @param snapshot The snapshot we're making the packets for.
 	 */
-	bool HasPackets()
+	PacketWriter(MapSnapshot *snapshot) : SaveFilter(NULL), snapshot(snapshot), current(NULL)
 	{
-		return this->packets != NULL;
 	}
 
-	/**
-	 * Pop a single created packet from the queue with packets.
-	 */
-	Packet *PopPacket()
+	/** Make sure everything is cleaned up. */
+	~PacketWriter()
 	{
-		if (this->mutex != NULL) this->mutex->BeginCritical();
-
-		Packet *p = this->packets;
-		this->packets = p->next;
-		p->next = NULL;
-
-		if (this->mutex != NULL) this->mutex->EndCritical();
-
-		return p;
+		delete this->current;
 	}
 
-	/** Append the current packet to the queue. */
+	/** Append the current packet to the snapshot. Must be called with the mutex held. */
 	void AppendQueue()
 	{
 		if (this->current == NULL) return;
 
-		Packet **p = &this->packets;
-		while (*p != NULL) {
-			p = &(*p)->next;
-		}
-		*p = this->current;
-
+		*this->snapshot->packets.Append() = this->current;
 		this->current = NULL;
 	}
 
 	/* virtual */ void Write(byte *buf, size_t size)
 	{
-		/* We want to abort the saving when the socket is closed. */
-		if (this->cs == NULL) SlError(STR_NETWORK_ERROR_LOSTCONNECTION);
+		/* We want to abort the saving when nobody wants the savegame anymore. */
+		if (this->snapshot->aborted) SlError(STR_NETWORK_ERROR_LOSTCONNECTION);
 
 		if (this->current == NULL) this->current = new Packet(PACKET_SERVER_MAP_DATA);
 
-		if (this->mutex != NULL) this->mutex->BeginCritical();
+		this->snapshot->mutex->BeginCritical();
 
 		byte *bufe = buf + size;
 		while (buf != bufe) {
@@ -187,17 +157,17 @@ struct PacketWriter : SaveFilter {
 			}
 		}
 
-		if (this->mutex != NULL) this->mutex->EndCritical();
+		this->snapshot->total_size += size;
 
-		this->total_size += size;
+		this->snapshot->mutex->EndCritical();
 	}
 
 	/* virtual */ void Finish()
 	{
-		/* We want to abort the saving when the socket is closed. */
-		if (this->cs == NULL) SlError(STR_NETWORK_ERROR_LOSTCONNECTION);
+		/* We want to abort the saving when nobody wants the savegame anymore. */
+		if (this->snapshot->aborted) SlError(STR_NETWORK_ERROR_LOSTCONNECTION);
 
-		if (this->mutex != NULL) this->mutex->BeginCritical();
+		this->snapshot->mutex->BeginCritical();
 
 		/* Make sure the last packet is flushed. */
 		this->AppendQueue();
@@ -206,15 +176,88 @@ struct PacketWriter : SaveFilter {
 		this->current = new Packet(PACKET_SERVER_MAP_DONE);
 		this->AppendQueue();
 
-		/* Fast-track the size to the client. */
-		Packet *p = new Packet(PACKET_SERVER_MAP_SIZE);
-		p->Send_uint32((uint32)this->total_size);
-		this->cs->NetworkTCPSocketHandler::SendPacket(p);
+		/* From here on the snapshot is not touched by the saving anymore. */
+		this->snapshot->finished = true;
 
-		if (this->mutex != NULL) this->mutex->EndCritical();
+		this->snapshot->mutex->EndCritical();
 	}
 };
 
+/**
+ * Get the map snapshot for a client that requests the map; making one when there is no joinable one.
+ * @return The snapshot, with the client counted as one of its downloaders.
+ */
+static MapSnapshot *AcquireMapSnapshot()
+{
+	if (_map_snapshot != NULL && !_map_snapshot->IsJoinable()) {
+		/* The clients that are still downloading it keep it alive, but it does not need to track commands anymore. */
+		_map_snapshot->commands.Free();
+		_map_snapshot = NULL;
+	}
+
+	if (_map_snapshot == NULL) {
+		/* The previous snapshot, or any other savegame, might still be finishing. */
+		WaitTillSaved();
+		ProcessAsyncSaveFinish();
+
+		_map_snapshot = new MapSnapshot();
+		NetworkSyncCommandQueue(&_map_snapshot->commands);
+
+		/* Make a dump of the current game */
+		if (SaveWithFilter(new PacketWriter(_map_snapshot), true) != SL_OK) usererror("network savedump failed");
+	}
+
+	_map_snapshot->clients++;
+	_map_snapshot->joiners++;
+	return _map_snapshot;
+}
+
+/**
+ * Stop downloading a map snapshot; the last client to do so frees it.
+ * @param snapshot The snapshot the client was downloading.
+ */
+static void ReleaseMapSnapshot(MapSnapshot *snapshot)
+{
+	if (--snapshot->clients != 0) return;
+	if (snapshot == _map_snapshot) _map_snapshot = NULL;
+
+	snapshot->mutex->BeginCritical();
+	bool finished = snapshot->finished;
+	snapshot->aborted = true;
+	snapshot->mutex->EndCritical();
+
+	if (!finished) {
+		/* Make sure the saving is completely cancelled before the snapshot is
+		 * gone. Yes, we need to handle the save finish as well as the next
+		 * connection might just be requesting a map. */
+		WaitTillSaved();
+		ProcessAsyncSaveFinish();
+	}
+
+	DEBUG(net, 2, "Map snapshot of frame %u (" PRINTF_SIZE " bytes) was downloaded by %u clients", snapshot->frame, snapshot->total_size, snapshot->joiners);
+	delete snapshot;
+}
+
+/**
+ * Remember a command for the clients that start downloading the current map snapshot later on.
+ * @param cp The command that is distributed to the clients.
+ */
+void NetworkAddMapSnapshotCommand(const CommandPacket *cp)
+{
+	if (_map_snapshot == NULL) return;
+
+	if (!_map_snapshot->IsJoinable()) {
+		_map_snapshot->commands.Free();
+		_map_snapshot = NULL;
+		return;
+	}
+
+	CommandPacket c = *cp;
+	c.callback = NULL;
+	c.my_cmd = false;
+	_map_snapshot->commands.Append(&c);
+}
+
 
 /**
  * Create a new socket for the server side of the game connection.
@@ -225,6 +268,7 @@ ServerNetworkGameSocketHandler::ServerNetworkGameSocketHandler(SOCKET s) : Netwo
 	this->status = STATUS_INACTIVE;
 	this->client_id = _network_client_id++;
 	this->receive_limit = _settings_client.network.bytes_per_frame_burst;
+	this->command_limit = _settings_client.network.command_cost_burst;
 
 	/* The Socket and Info pools need to be the same in size. After all,
 	 * each Socket will be associated with at most one Info object. As
@@ -238,12 +282,10 @@ ServerNetworkGameSocketHandler::ServerNetworkGameSocketHandler(SOCKET s) : Netwo
 ServerNetworkGameSocketHandler::~ServerNetworkGameSocketHandler()
 {
 	if (_redirect_console_to_client == this->client_id) _redirect_console_to_client = INVALID_CLIENT_ID;
-	OrderBackup::ResetUser(this->client_id);
+	/* The clients of a relay cannot have order backups; those are made by commands of the relayed server. */
+	if (!_network_relay) OrderBackup::ResetUser(this->client_id);
 
-	if (this->savegame != NULL) {
-		this->savegame->Destroy();
-		this->savegame = NULL;
-	}
+	if (this->savegame != NULL) ReleaseMapSnapshot(this->savegame);
 }
 
 Packet *ServerNetworkGameSocketHandler::ReceivePacket()
@@ -543,6 +585,15 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::SendWelcome()
 	p->Send_string(_settings_client.network.network_id);
 	this->SendPacket(p);
 
+	if (_network_relay) {
+		/* The clients of the relayed server, including itself, are only known by their info. */
+		NetworkClientInfo *ci;
+		FOR_ALL_CLIENT_INFOS(ci) {
+			if (ci != this->GetInfo()) this->SendClientInfo(ci);
+		}
+		return NETWORK_RECV_STATUS_OKAY;
+	}
+
 	/* Transmit info about all the active clients */
 	FOR_ALL_CLIENT_SOCKETS(new_cs) {
 		if (new_cs != this && new_cs->status > STATUS_AUTHORIZED) {
@@ -553,64 +604,58 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::SendWelcome()
 	return this->SendClientInfo(NetworkClientInfo::GetByClientID(CLIENT_ID_SERVER));
 }
 
-/** Tell the client that its put in a waiting queue. */
-NetworkRecvStatus ServerNetworkGameSocketHandler::SendWait()
-{
-	int waiting = 0;
-	NetworkClientSocket *new_cs;
-	Packet *p;
-
-	/* Count how many clients are waiting in the queue, in front of you! */
-	FOR_ALL_CLIENT_SOCKETS(new_cs) {
-		if (new_cs->status != STATUS_MAP_WAIT) continue;
-		if (new_cs->GetInfo()->join_date < this->GetInfo()->join_date || (new_cs->GetInfo()->join_date == this->GetInfo()->join_date && new_cs->client_id < this->client_id)) waiting++;
-	}
-
-	p = new Packet(PACKET_SERVER_WAIT);
-	p->Send_uint8(waiting);
-	this->SendPacket(p);
-	return NETWORK_RECV_STATUS_OKAY;
-}
-
 /** This sends the map to the client */
 NetworkRecvStatus ServerNetworkGameSocketHandler::SendMap()
 {
-	static uint sent_packets; // How many packets we did send successfully last time
-
 	if (this->status < STATUS_AUTHORIZED) {
 		/* Illegal call, return error and ignore the packet */
 		return this->SendError(NETWORK_ERROR_NOT_AUTHORIZED);
 	}
 
 	if (this->status == STATUS_AUTHORIZED) {
-		this->savegame = new PacketWriter(this);
+		this->savegame = AcquireMapSnapshot();
+		this->savegame_pos = 0;
+		this->savegame_size_sent = false;
 
-		/* Now send the _frame_counter and how many packets are coming */
+		/* Now send the frame of the savegame; the client catches up from there */
 		Packet *p = new Packet(PACKET_SERVER_MAP_BEGIN);
-		p->Send_uint32(_frame_counter);
+		p->Send_uint32(this->savegame->frame);
 		this->SendPacket(p);
 
-		NetworkSyncCommandQueue(this);
+		/* The commands that are executed after the savegame has been made. */
+		for (CommandPacket *cp = this->savegame->commands.Peek(); cp != NULL; cp = cp->next) {
+			this->outgoing_queue.Append(cp);
+		}
 		this->status = STATUS_MAP;
 		/* Mark the start of download */
 		this->last_frame = _frame_counter;
 		this->last_frame_server = _frame_counter;
+		this->map_start_time = _realtime_tick;
 
-		sent_packets = 4; // We start with trying 4 packets
-
-		/* Make a dump of the current game */
-		if (SaveWithFilter(this->savegame, true) != SL_OK) usererror("network savedump failed");
+		this->savegame_packets = 4; // We start with trying 4 packets
 	}
 
 	if (this->status == STATUS_MAP) {
 		bool last_packet = false;
 		bool has_packets = false;
 
-		for (uint i = 0; (has_packets = this->savegame->HasPackets()) && i < sent_packets; i++) {
-			Packet *p = this->savegame->PopPacket();
-			last_packet = p->buffer[2] == PACKET_SERVER_MAP_DONE;
+		MapSnapshot *snapshot = this->savegame;
+		snapshot->mutex->BeginCritical();
 
+		/* The size is known as soon as the savegame is complete; fast-track it to the client. */
+		if (snapshot->finished && !this->savegame_size_sent) {
+			Packet *p = new Packet(PACKET_SERVER_MAP_SIZE);
+			p->Send_uint32((uint32)snapshot->total_size);
 			this->SendPacket(p);
+			this->savegame_size_sent = true;
+		}
+
+		for (uint i = 0; (has_packets = this->savegame_pos < snapshot->packets.Length()) && i < this->savegame_packets; i++) {
+			Packet *p = snapshot->packets[this->savegame_pos++];
+			last_packet = p->buffer[2] == PACKET_SERVER_MAP_DONE;
+
+			/* The packets are shared by all clients downloading this snapshot. */
+			this->SendPacket(new Packet(p));
 
 			if (last_packet) {
 				/* There is no more data, so break the for */
@@ -618,37 +663,17 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::SendMap()
 			}
 		}
 
+		snapshot->mutex->EndCritical();
+
 		if (last_packet) {
-			/* Done reading, make sure saving is done as well */
-			this->savegame->Destroy();
+			/* Done reading; the last client to finish cleans up the snapshot */
+			ReleaseMapSnapshot(this->savegame);
 			this->savegame = NULL;
 
 			/* Set the status to DONE_MAP, no we will wait for the client
 			 *  to send it is ready (maybe that happens like never ;)) */
 			this->status = STATUS_DONE_MAP;
-
-			/* Find the best candidate for joining, i.e. the first joiner. */
-			NetworkClientSocket *new_cs;
-			NetworkClientSocket *best = NULL;
-			FOR_ALL_CLIENT_SOCKETS(new_cs) {
-				if (new_cs->status == STATUS_MAP_WAIT) {
-					if (best == NULL || best->GetInfo()->join_date > new_cs->GetInfo()->join_date || (best->GetInfo()->join_date == new_cs->GetInfo()->join_date && best->client_id > new_cs->client_id)) {
-						best = new_cs;
-					}
-				}
-			}
-
-			/* Is there someone else to join? */
-			if (best != NULL) {
-				/* Let the first start joining. */
-				best->status = STATUS_AUTHORIZED;
-				best->SendMap();
-
-				/* And update the rest. */
-				FOR_ALL_CLIENT_SOCKETS(new_cs) {
-					if (new_cs->status == STATUS_MAP_WAIT) new_cs->SendWait();
-				}
-			}
+			this->map_done_time = _realtime_tick;
 		}
 
 		switch (this->SendPackets()) {
@@ -656,8 +681,8 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::SendMap()
 				return NETWORK_RECV_STATUS_CONN_LOST;
 
 			case SPS_ALL_SENT:
-				/* All are sent, increase the sent_packets */
-				if (has_packets) sent_packets *= 2;
+				/* All are sent, increase the savegame_packets */
+				if (has_packets) this->savegame_packets *= 2;
 				break;
 
 			case SPS_PARTLY_SENT:
@@ -665,8 +690,8 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::SendMap()
 				break;
 
 			case SPS_NONE_SENT:
-				/* Not everything is sent, decrease the sent_packets */
-				if (sent_packets > 1) sent_packets /= 2;
+				/* Not everything is sent, decrease the savegame_packets */
+				if (this->savegame_packets > 1) this->savegame_packets /= 2;
 				break;
 		}
 	}
@@ -687,40 +712,90 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::SendJoin(ClientID client_id)
 	return NETWORK_RECV_STATUS_OKAY;
 }
 
-/** Tell the client that they may run to a particular frame. */
-NetworkRecvStatus ServerNetworkGameSocketHandler::SendFrame()
+/**
+ * Get a part of the seed the clients have to match at the current frame.
+ * @param i The part of the seed, 0 or 1.
+ * @return The seed.
+ */
+static inline uint32 GetSyncSeed(uint i)
+{
+	/* A relay is in sync with the relayed server, so its own state is what its clients must match. */
+	if (_network_relay) return _random.state[i];
+#ifdef NETWORK_SEND_DOUBLE_SEED
+	if (i == 1) return _sync_seed_2;
+#endif
+	return _sync_seed_1;
+}
+
+/**
+ * Create the packet telling clients that they may run to the current frame, without token.
+ * @return The packet.
+ */
+static Packet *NewFramePacket()
 {
 	Packet *p = new Packet(PACKET_SERVER_FRAME);
 	p->Send_uint32(_frame_counter);
 	p->Send_uint32(_frame_counter_max);
 #ifdef ENABLE_NETWORK_SYNC_EVERY_FRAME
-	p->Send_uint32(_sync_seed_1);
+	p->Send_uint32(GetSyncSeed(0));
 #ifdef NETWORK_SEND_DOUBLE_SEED
-	p->Send_uint32(_sync_seed_2);
+	p->Send_uint32(GetSyncSeed(1));
+#endif
 #endif
+	return p;
+}
+
+/**
+ * Create the packet requesting clients to sync.
+ * @return The packet.
+ */
+static Packet *NewSyncPacket()
+{
+	Packet *p = new Packet(PACKET_SERVER_SYNC);
+	p->Send_uint32(_frame_counter);
+	p->Send_uint32(GetSyncSeed(0));
+
+#ifdef NETWORK_SEND_DOUBLE_SEED
+	p->Send_uint32(GetSyncSeed(1));
 #endif
 
+	/* Optionally tell which part of the game state desynced. */
+	if (_settings_client.network.sync_checksums) {
+		uint32 checksums[SCS_END];
+		CalculateSyncChecksums(checksums);
+
+		p->Send_uint8(SCS_END);
+		for (uint i = 0; i < SCS_END; i++) p->Send_uint32(checksums[i]);
+	}
+	return p;
+}
+
+/**
+ * Tell the client that they may run to a particular frame.
+ * @param shared Frame packet, without token, that is sent to all clients; \c NULL to create one.
+ */
+NetworkRecvStatus ServerNetworkGameSocketHandler::SendFrame(const Packet *shared)
+{
 	/* If token equals 0, we need to make a new token and send that. */
 	if (this->last_token == 0) {
+		Packet *p = NewFramePacket();
 		this->last_token = InteractiveRandomRange(UINT8_MAX - 1) + 1;
 		p->Send_uint8(this->last_token);
+		this->SendPacket(p);
+		return NETWORK_RECV_STATUS_OKAY;
 	}
 
-	this->SendPacket(p);
+	this->SendPacket(shared != NULL ? new Packet(shared) : NewFramePacket());
 	return NETWORK_RECV_STATUS_OKAY;
 }
 
-/** Request the client to sync. */
-NetworkRecvStatus ServerNetworkGameSocketHandler::SendSync()
+/**
+ * Request the client to sync.
+ * @param shared Sync packet that is sent to all clients; \c NULL to create one.
+ */
+NetworkRecvStatus ServerNetworkGameSocketHandler::SendSync(const Packet *shared)
 {
-	Packet *p = new Packet(PACKET_SERVER_SYNC);
-	p->Send_uint32(_frame_counter);
-	p->Send_uint32(_sync_seed_1);
-
-#ifdef NETWORK_SEND_DOUBLE_SEED
-	p->Send_uint32(_sync_seed_2);
-#endif
-	this->SendPacket(p);
+	this->SendPacket(shared != NULL ? new Packet(shared) : NewSyncPacket());
 	return NETWORK_RECV_STATUS_OKAY;
 }
 
@@ -741,17 +816,16 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::SendCommand(const CommandPacke
 }
 
 /**
- * Send a chat message.
+ * Create a chat message packet.
  * @param action The action associated with the message.
  * @param client_id The origin of the chat message.
  * @param self_send Whether we did send the message.
  * @param msg The actual message.
  * @param data Arbitrary extra data.
+ * @return The packet.
  */
-NetworkRecvStatus ServerNetworkGameSocketHandler::SendChat(NetworkAction action, ClientID client_id, bool self_send, const char *msg, int64 data)
+static Packet *NewChatPacket(NetworkAction action, ClientID client_id, bool self_send, const char *msg, int64 data)
 {
-	if (this->status < STATUS_PRE_ACTIVE) return NETWORK_RECV_STATUS_OKAY;
-
 	Packet *p = new Packet(PACKET_SERVER_CHAT);
 
 	p->Send_uint8 (action);
@@ -759,8 +833,22 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::SendChat(NetworkAction action,
 	p->Send_bool  (self_send);
 	p->Send_string(msg);
 	p->Send_uint64(data);
+	return p;
+}
 
-	this->SendPacket(p);
+/**
+ * Send a chat message.
+ * @param action The action associated with the message.
+ * @param client_id The origin of the chat message.
+ * @param self_send Whether we did send the message.
+ * @param msg The actual message.
+ * @param data Arbitrary extra data.
+ */
+NetworkRecvStatus ServerNetworkGameSocketHandler::SendChat(NetworkAction action, ClientID client_id, bool self_send, const char *msg, int64 data)
+{
+	if (this->status < STATUS_PRE_ACTIVE) return NETWORK_RECV_STATUS_OKAY;
+
+	this->SendPacket(NewChatPacket(action, client_id, self_send, msg, data));
 	return NETWORK_RECV_STATUS_OKAY;
 }
 
@@ -919,6 +1007,13 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::Receive_CLIENT_JOIN(Packet *p)
 
 	if (this->HasClientQuit()) return NETWORK_RECV_STATUS_CONN_LOST;
 
+	if (_network_relay) {
+		/* A relay only has spectators; their number is limited by max_clients. The
+		 * client infos are shared with the clients of the relayed server though. */
+		if (!NetworkClientInfo::CanAllocateItem()) return this->SendError(NETWORK_ERROR_FULL);
+		playas = COMPANY_SPECTATOR;
+	}
+
 	/* join another company does not affect these values */
 	switch (playas) {
 		case COMPANY_NEW_COMPANY: // New company
@@ -927,7 +1022,7 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::Receive_CLIENT_JOIN(Packet *p)
 			}
 			break;
 		case COMPANY_SPECTATOR: // Spectator
-			if (NetworkSpectatorCount() >= _settings_client.network.max_spectators) {
+			if (!_network_relay && NetworkSpectatorCount() >= _settings_client.network.max_spectators) {
 				return this->SendError(NETWORK_ERROR_FULL);
 			}
 			break;
@@ -1017,23 +1112,14 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::Receive_CLIENT_COMPANY_PASSWOR
 
 NetworkRecvStatus ServerNetworkGameSocketHandler::Receive_CLIENT_GETMAP(Packet *p)
 {
-	NetworkClientSocket *new_cs;
 	/* The client was never joined.. so this is impossible, right?
 	 *  Ignore the packet, give the client a warning, and close his connection */
 	if (this->status < STATUS_AUTHORIZED || this->HasClientQuit()) {
 		return this->SendError(NETWORK_ERROR_NOT_AUTHORIZED);
 	}
 
-	/* Check if someone else is receiving the map */
-	FOR_ALL_CLIENT_SOCKETS(new_cs) {
-		if (new_cs->status == STATUS_MAP) {
-			/* Tell the new client to wait */
-			this->status = STATUS_MAP_WAIT;
-			return this->SendWait();
-		}
-	}
-
-	/* We receive a request to upload the map.. give it to the client! */
+	/* We receive a request to upload the map.. give it to the client!
+	 * Clients that request it at about the same time share the savegame. */
 	return this->SendMap();
 }
 
@@ -1092,10 +1178,20 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::Receive_CLIENT_COMMAND(Packet
 		return this->SendError(NETWORK_ERROR_NOT_EXPECTED);
 	}
 
-	if (this->incoming_queue.Count() >= _settings_client.network.max_commands_in_queue) {
+	/* Commands held back by the command cost limit do not count; while the client
+	 * waits it may queue as many commands as could have been executed meanwhile. */
+	uint max_commands = _settings_client.network.max_commands_in_queue;
+	if (this->command_limit <= 0) {
+		uint frames = (uint)-this->command_limit / _settings_client.network.command_cost_per_frame + 1;
+		max_commands += frames * _settings_client.network.commands_per_frame;
+	}
+	if (this->incoming_queue.Count() >= max_commands) {
 		return this->SendError(NETWORK_ERROR_TOO_MANY_COMMANDS);
 	}
 
+	/* A relay only passes the commands of the relayed server on. */
+	if (_network_relay) return NETWORK_RECV_STATUS_OKAY;
+
 	CommandPacket cp;
 	const char *err = this->ReceiveCommand(p, &cp);
 
@@ -1227,6 +1323,9 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::Receive_CLIENT_ACK(Packet *p)
 		this->status = STATUS_ACTIVE;
 		this->last_token_frame = _frame_counter;
 
+		DEBUG(net, 1, "Client #%d joined in %u ms: %u ms waiting for and downloading the map, %u ms loading it and catching up",
+				this->client_id, _realtime_tick - this->map_start_time, this->map_done_time - this->map_start_time, _realtime_tick - this->map_done_time);
+
 		/* Execute script for, e.g. MOTD */
 		IConsoleCmdExec("exec scripts/on_server_connect.scr 0");
 	}
@@ -1362,10 +1461,13 @@ void NetworkServerSendChat(NetworkAction action, DestType desttype, int dest, co
 		default:
 			DEBUG(net, 0, "[server] received unknown chat destination type %d. Doing broadcast instead", desttype);
 			/* FALL THROUGH */
-		case DESTTYPE_BROADCAST:
+		case DESTTYPE_BROADCAST: {
+			/* All clients get the same message, so share its buffer. */
+			Packet *p = NewChatPacket(action, from_id, false, msg, data);
 			FOR_ALL_CLIENT_SOCKETS(cs) {
-				cs->SendChat(action, from_id, false, msg, data);
+				if (cs->status >= NetworkClientSocket::STATUS_PRE_ACTIVE) cs->SendPacket(new Packet(p));
 			}
+			delete p;
 
 			NetworkAdminChat(action, desttype, from_id, msg, data, from_admin);
 
@@ -1374,6 +1476,7 @@ void NetworkServerSendChat(NetworkAction action, DestType desttype, int dest, co
 				NetworkTextMessage(action, GetDrawStringCompanyColour(ci->client_playas), false, ci->client_name, msg, data);
 			}
 			break;
+		}
 	}
 }
 
@@ -1392,6 +1495,9 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::Receive_CLIENT_CHAT(Packet *p)
 	p->Recv_string(msg, NETWORK_CHAT_LENGTH);
 	int64 data = p->Recv_uint64();
 
+	/* The clients of a relay cannot reach the clients of the relayed server. */
+	if (_network_relay) return NETWORK_RECV_STATUS_OKAY;
+
 	NetworkClientInfo *ci = this->GetInfo();
 	switch (action) {
 		case NETWORK_ACTION_GIVE_MONEY:
@@ -1422,6 +1528,9 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::Receive_CLIENT_SET_PASSWORD(Pa
 	p->Recv_string(password, sizeof(password));
 	ci = this->GetInfo();
 
+	/* The companies of a relay belong to the relayed server. */
+	if (_network_relay) return NETWORK_RECV_STATUS_OKAY;
+
 	NetworkServerSetCompanyPassword(ci->client_playas, password);
 	return NETWORK_RECV_STATUS_OKAY;
 }
@@ -1483,6 +1592,9 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::Receive_CLIENT_MOVE(Packet *p)
 
 	CompanyID company_id = (Owner)p->Recv_uint8();
 
+	/* The clients of a relay remain spectators. */
+	if (_network_relay) return NETWORK_RECV_STATUS_OKAY;
+
 	/* Check if the company is valid, we don't allow moving to AI companies */
 	if (company_id != COMPANY_SPECTATOR && !Company::IsValidHumanID(company_id)) return NETWORK_RECV_STATUS_OKAY;
 
@@ -1815,6 +1927,13 @@ void NetworkServer_Tick(bool send_frame)
 	}
 #endif
 
+	/* The frame and sync packets are the same for all clients, so only
+	 * create them once and share their buffers. */
+	Packet *frame = send_frame ? NewFramePacket() : NULL;
+#ifndef ENABLE_NETWORK_SYNC_EVERY_FRAME
+	Packet *sync = send_sync ? NewSyncPacket() : NULL;
+#endif
+
 	/* Now we are done with the frame, inform the clients that they can
 	 *  do their frame! */
 	FOR_ALL_CLIENT_SOCKETS(cs) {
@@ -1822,6 +1941,9 @@ void NetworkServer_Tick(bool send_frame)
 		 * to be available for packet receiving at any particular time. */
 		cs->receive_limit = min(cs->receive_limit + _settings_client.network.bytes_per_frame,
 				_settings_client.network.bytes_per_frame_burst);
+		/* The same goes for the cost of the commands we execute for the client. */
+		cs->command_limit = min(cs->command_limit + _settings_client.network.command_cost_per_frame,
+				_settings_client.network.command_cost_burst);
 
 		/* Check if the speed of the client is what we can expect from a client */
 		uint lag = NetworkCalculateLag(cs);
@@ -1898,11 +2020,6 @@ void NetworkServer_Tick(bool send_frame)
 				}
 				break;
 
-			case NetworkClientSocket::STATUS_MAP_WAIT:
-				/* This is an internal state where we do not wait
-				 * on the client to move to a different state. */
-				break;
-
 			case NetworkClientSocket::STATUS_END:
 				/* Bad server/code. */
 				NOT_REACHED();
@@ -1913,19 +2030,75 @@ void NetworkServer_Tick(bool send_frame)
 			NetworkHandleCommandQueue(cs);
 
 			/* Send an updated _frame_counter_max to the client */
-			if (send_frame) cs->SendFrame();
+			if (send_frame) cs->SendFrame(frame);
 
 #ifndef ENABLE_NETWORK_SYNC_EVERY_FRAME
 			/* Send a sync-check packet */
-			if (send_sync) cs->SendSync();
+			if (send_sync) cs->SendSync(sync);
 #endif
 		}
 	}
 
+	delete frame;
+#ifndef ENABLE_NETWORK_SYNC_EVERY_FRAME
+	delete sync;
+#endif
+
 	/* See if we need to advertise */
 	NetworkUDPAdvertise();
 }
 
+/** The highest frame of the relayed server that has been passed on to the clients of the relay. */
+static uint32 _relayed_frame_counter_max;
+
+/**
+ * Start accepting clients on a relay, once the map of the relayed server has been loaded.
+ * @return true if listening succeeded.
+ */
+bool NetworkRelayStart()
+{
+	DEBUG(net, 1, "starting listeners for relayed clients");
+	if (!ServerNetworkGameSocketHandler::Listen(_settings_client.network.server_port)) return false;
+
+	_network_client_id = CLIENT_ID_FIRST_RELAY;
+	_network_game_info.clients_on = 0;
+	_last_sync_frame = _frame_counter;
+	_relayed_frame_counter_max = _frame_counter_max;
+	return true;
+}
+
+/**
+ * This is called every tick if this is a relay, after the frames of the
+ * relayed server have been run. The clients get the same frames and the
+ * commands that were passed on while receiving them.
+ */
+void NetworkRelay_Tick()
+{
+	bool send_frame = _frame_counter_max != _relayed_frame_counter_max;
+	_relayed_frame_counter_max = _frame_counter_max;
+
+	NetworkServer_Tick(send_frame);
+}
+
+/**
+ * Pass a packet of the relayed server on to the clients of the relay, without copying it.
+ * @param p The received packet.
+ */
+void NetworkRelayPacket(const Packet *p)
+{
+	/* Chat and updates are only expected once the client has loaded the map. */
+	PacketGameType type = (PacketGameType)p->buffer[sizeof(PacketSize)];
+	ServerNetworkGameSocketHandler::ClientStatus min_status = ServerNetworkGameSocketHandler::STATUS_MAP;
+	if (type == PACKET_SERVER_CHAT || type == PACKET_SERVER_COMPANY_UPDATE || type == PACKET_SERVER_CONFIG_UPDATE) {
+		min_status = ServerNetworkGameSocketHandler::STATUS_PRE_ACTIVE;
+	}
+
+	NetworkClientSocket *cs;
+	FOR_ALL_CLIENT_SOCKETS(cs) {
+		if (cs->status >= min_status) cs->SendPacket(new Packet(p));
+	}
+}
+
 /** Yearly "callback". Called whenever the year changes. */
 void NetworkServerYearlyLoop()
 {
@@ -1966,7 +2139,6 @@ void NetworkServerShowStatusToConsole()
 		"authorizing (server password)",
 		"authorizing (company password)",
 		"authorized",
-		"waiting",
 		"loading map",
 		"map done",
 		"ready",
@@ -48,7 +48,6 @@ protected:
 	NetworkRecvStatus SendCompanyInfo();
 	NetworkRecvStatus SendNewGRFCheck();
 	NetworkRecvStatus SendWelcome();
-	NetworkRecvStatus SendWait();
 	NetworkRecvStatus SendNeedGamePassword();
 	NetworkRecvStatus SendNeedCompanyPassword();
 
@@ -60,7 +59,6 @@ public:
 		STATUS_AUTH_GAME,     ///< The client is authorizing with game (server) password.
 		STATUS_AUTH_COMPANY,  ///< The client is authorizing with company password.
 		STATUS_AUTHORIZED,    ///< The client is authorized.
-		STATUS_MAP_WAIT,      ///< The client is waiting as someone else is downloading the map.
 		STATUS_MAP,           ///< The client is downloading the map.
 		STATUS_DONE_MAP,      ///< The client has downloaded the map.
 		STATUS_PRE_ACTIVE,    ///< The client is catching up the delayed frames.
@@ -74,8 +72,14 @@ public:
 	ClientStatus status;         ///< Status of this client
 	CommandQueue outgoing_queue; ///< The command-queue awaiting delivery
 	int receive_limit;           ///< Amount of bytes that we can receive at this moment
-
-	struct PacketWriter *savegame; ///< Writer used to write the savegame.
+	int command_limit;           ///< Amount of command cost that we can execute at this moment
+
+	struct MapSnapshot *savegame;  ///< Savegame the client is downloading.
+	uint savegame_pos;             ///< Index of the next packet of the savegame to send.
+	uint savegame_packets;         ///< Number of savegame packets to try to send at once.
+	bool savegame_size_sent;       ///< Whether the size of the savegame has been sent.
+	uint32 map_start_time;         ///< Realtime tick the client started downloading the map.
+	uint32 map_done_time;          ///< Realtime tick the whole map has been sent to the client.
 	NetworkAddress client_address; ///< IP-address of the client (so he can be banned)
 
 	ServerNetworkGameSocketHandler(SOCKET s);
@@ -97,14 +101,14 @@ public:
 	NetworkRecvStatus SendError(NetworkErrorCode error);
 	NetworkRecvStatus SendChat(NetworkAction action, ClientID client_id, bool self_send, const char *msg, int64 data);
 	NetworkRecvStatus SendJoin(ClientID client_id);
-	NetworkRecvStatus SendFrame();
-	NetworkRecvStatus SendSync();
+	NetworkRecvStatus SendFrame(const Packet *shared = NULL);
+	NetworkRecvStatus SendSync(const Packet *shared = NULL);
 	NetworkRecvStatus SendCommand(const CommandPacket *cp);
 	NetworkRecvStatus SendCompanyUpdate();
 	NetworkRecvStatus SendConfigUpdate();
 
 	static void Send();
-	static void AcceptConnection(SOCKET s, const NetworkAddress &address);
+	static ServerNetworkGameSocketHandler *AcceptConnection(SOCKET s, const NetworkAddress &address);
 	static bool AllowConnection();
 
 	/**
@@ -122,6 +126,9 @@ public:
 };
 
 void NetworkServer_Tick(bool send_frame);
+bool NetworkRelayStart();
+void NetworkRelay_Tick();
+void NetworkRelayPacket(const Packet *p);
 void NetworkServerSetCompanyPassword(CompanyID company_id, const char *password, bool already_hashed = true);
 void NetworkServerUpdateCompanyPassworded(CompanyID company_id, bool passworded);
 
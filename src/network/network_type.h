@@ -41,9 +41,10 @@ enum NetworkVehicleType {
 
 /** 'Unique' identifier to be given to clients */
 enum ClientID {
-	INVALID_CLIENT_ID = 0, ///< Client is not part of anything
-	CLIENT_ID_SERVER  = 1, ///< Servers always have this ID
-	CLIENT_ID_FIRST   = 2, ///< The first client ID
+	INVALID_CLIENT_ID     = 0,          ///< Client is not part of anything
+	CLIENT_ID_SERVER      = 1,          ///< Servers always have this ID
+	CLIENT_ID_FIRST       = 2,          ///< The first client ID
+	CLIENT_ID_FIRST_RELAY = 0x40000000, ///< The first client ID of a relay, far away from those of the relayed server
 };
 
 /** Indices into the client tables */
@@ -24,6 +24,12 @@
 
 #include "fileio_func.h"
 #include "fios.h"
+#include "thread/thread.h"
+
+#include <map>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
 
 #include "safeguards.h"
 
@@ -364,21 +370,17 @@ size_t GRFGetSizeOfDataSection(FILE *f)
 }
 
 /**
- * Calculate the MD5 sum for a GRF, and store it in the config.
+ * Calculate the MD5 sum for a GRF from an opened file, and store it in the config.
  * @param config GRF to compute.
- * @param subdir The subdirectory to look in.
+ * @param f The opened GRF file; it is closed afterwards.
+ * @param size The size of the file.
  * @return MD5 sum was successfully computed
  */
-static bool CalcGRFMD5Sum(GRFConfig *config, Subdirectory subdir)
+static bool CalcGRFMD5Sum(GRFConfig *config, FILE *f, size_t size)
 {
-	FILE *f;
 	Md5 checksum;
 	uint8 buffer[1024];
-	size_t len, size;
-
-	/* open the file */
-	f = FioFOpenFile(config->filename, "rb", subdir, &size);
-	if (f == NULL) return false;
+	size_t len;
 
 	long start = ftell(f);
 	size = min(size, GRFGetSizeOfDataSection(f));
@@ -400,15 +402,32 @@ static bool CalcGRFMD5Sum(GRFConfig *config, Subdirectory subdir)
 	return true;
 }
 
+/**
+ * Calculate the MD5 sum for a GRF, and store it in the config.
+ * @param config GRF to compute.
+ * @param subdir The subdirectory to look in.
+ * @return MD5 sum was successfully computed
+ */
+static bool CalcGRFMD5Sum(GRFConfig *config, Subdirectory subdir)
+{
+	size_t size;
+
+	/* open the file */
+	FILE *f = FioFOpenFile(config->filename, "rb", subdir, &size);
+	if (f == NULL) return false;
+
+	return CalcGRFMD5Sum(config, f, size);
+}
+
 
 /**
- * Find the GRFID of a given grf, and calculate its md5sum.
+ * Find the GRFID and the other Action 8 and 14 details of a given grf, without calculating its md5sum.
  * @param config    grf to fill.
  * @param is_static grf is static.
  * @param subdir    the subdirectory to search in.
  * @return Operation was successfully completed.
  */
-bool FillGRFDetails(GRFConfig *config, bool is_static, Subdirectory subdir)
+static bool FillGRFDetailsWithoutMD5Sum(GRFConfig *config, bool is_static, Subdirectory subdir)
 {
 	if (!FioCheckFileExists(config->filename, subdir)) {
 		config->status = GCS_NOT_FOUND;
@@ -431,7 +450,19 @@ bool FillGRFDetails(GRFConfig *config, bool is_static, Subdirectory subdir)
 		if (HasBit(config->flags, GCF_UNSAFE)) return false;
 	}
 
-	return CalcGRFMD5Sum(config, subdir);
+	return true;
+}
+
+/**
+ * Find the GRFID of a given grf, and calculate its md5sum.
+ * @param config    grf to fill.
+ * @param is_static grf is static.
+ * @param subdir    the subdirectory to search in.
+ * @return Operation was successfully completed.
+ */
+bool FillGRFDetails(GRFConfig *config, bool is_static, Subdirectory subdir)
+{
+	return FillGRFDetailsWithoutMD5Sum(config, is_static, subdir) && CalcGRFMD5Sum(config, subdir);
 }
 
 
@@ -622,13 +653,288 @@ compatible_grf:
 	return res;
 }
 
+/** Magic at the start of the NewGRF scan cache. */
+static const uint32 GRF_SCAN_CACHE_MAGIC = 'O' << 24 | 'G' << 16 | 'S' << 8 | 'C';
+/** Version of the layout of the NewGRF scan cache; increase when it changes. */
+static const uint32 GRF_SCAN_CACHE_VERSION = 1;
+
+char *_newgrf_scan_cache_file; ///< The file to store the NewGRF scan cache in.
+
+/** What is remembered about a scanned .grf file. */
+struct GRFScanCacheItem {
+	uint64 size;       ///< Size of the file, or of the tar it is in.
+	uint64 mtime;      ///< Modification time of the file, or of the tar it is in.
+	GRFConfig *config; ///< Details of the NewGRF, or \c NULL when the file is not a usable NewGRF.
+};
+
+/** Scan results by the full path of the file. */
+typedef std::map<std::string, GRFScanCacheItem> GRFScanCache;
+
+static GRFScanCache _grf_scan_cache;      ///< Results of the previous scan.
+static bool _grf_scan_cache_loaded = false; ///< Whether the scan cache has been read from disk.
+
+/**
+ * Write a value to the NewGRF scan cache.
+ * @param f     The cache file.
+ * @param value The value to write.
+ * @return Whether the value has been written.
+ */
+template <typename T>
+static inline bool WriteGRFScanCacheValue(FILE *f, const T &value)
+{
+	return fwrite(&value, sizeof(value), 1, f) == 1;
+}
+
+/**
+ * Read a value from the NewGRF scan cache.
+ * @param f     The cache file.
+ * @param value The place to store the value.
+ * @return Whether the value has been read.
+ */
+template <typename T>
+static inline bool ReadGRFScanCacheValue(FILE *f, T &value)
+{
+	return fread(&value, sizeof(value), 1, f) == 1;
+}
+
+/**
+ * Write the details of a scanned NewGRF to the NewGRF scan cache.
+ * @param f The cache file.
+ * @param c The NewGRF to write.
+ * @return Whether all details have been written.
+ */
+static bool WriteGRFScanCacheConfig(FILE *f, const GRFConfig *c)
+{
+	if (!WriteGRFScanCacheValue(f, c->ident) ||
+			!WriteGRFScanCacheValue(f, c->version) ||
+			!WriteGRFScanCacheValue(f, c->min_loadable_version) ||
+			!WriteGRFScanCacheValue(f, c->flags) ||
+			!WriteGRFScanCacheValue(f, (byte)c->status) ||
+			!WriteGRFScanCacheValue(f, c->palette) ||
+			!WriteGRFScanCacheValue(f, c->num_valid_params) ||
+			!WriteGRFScanCacheValue(f, c->has_param_defaults) ||
+			!WriteGRFTextList(f, c->name->text) ||
+			!WriteGRFTextList(f, c->info->text) ||
+			!WriteGRFTextList(f, c->url->text) ||
+			!WriteGRFScanCacheValue(f, (uint16)c->param_info.Length())) {
+		return false;
+	}
+
+	for (const GRFParameterInfo * const *it = c->param_info.Begin(); it != c->param_info.End(); it++) {
+		const GRFParameterInfo *info = *it;
+		if (!WriteGRFScanCacheValue(f, info != NULL)) return false;
+		if (info == NULL) continue;
+
+		if (!WriteGRFTextList(f, info->name) ||
+				!WriteGRFTextList(f, info->desc) ||
+				!WriteGRFScanCacheValue(f, (byte)info->type) ||
+				!WriteGRFScanCacheValue(f, info->min_value) ||
+				!WriteGRFScanCacheValue(f, info->max_value) ||
+				!WriteGRFScanCacheValue(f, info->def_value) ||
+				!WriteGRFScanCacheValue(f, info->param_nr) ||
+				!WriteGRFScanCacheValue(f, info->first_bit) ||
+				!WriteGRFScanCacheValue(f, info->num_bit) ||
+				!WriteGRFScanCacheValue(f, info->complete_labels) ||
+				!WriteGRFScanCacheValue(f, (uint16)info->value_names.Length())) {
+			return false;
+		}
+		for (const SmallPair<uint32, GRFText *> *name = info->value_names.Begin(); name != info->value_names.End(); name++) {
+			if (!WriteGRFScanCacheValue(f, name->first) || !WriteGRFTextList(f, name->second)) return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Read the information about a NewGRF parameter from the NewGRF scan cache.
+ * @param f    The cache file.
+ * @param info The parameter information to fill.
+ * @return Whether all information has been read.
+ */
+static bool ReadGRFScanCacheParameterInfo(FILE *f, GRFParameterInfo *info)
+{
+	byte type;
+	uint16 num_names;
+	if (!ReadGRFTextList(f, &info->name) ||
+			!ReadGRFTextList(f, &info->desc) ||
+			!ReadGRFScanCacheValue(f, type) ||
+			!ReadGRFScanCacheValue(f, info->min_value) ||
+			!ReadGRFScanCacheValue(f, info->max_value) ||
+			!ReadGRFScanCacheValue(f, info->def_value) ||
+			!ReadGRFScanCacheValue(f, info->param_nr) ||
+			!ReadGRFScanCacheValue(f, info->first_bit) ||
+			!ReadGRFScanCacheValue(f, info->num_bit) ||
+			!ReadGRFScanCacheValue(f, info->complete_labels) ||
+			!ReadGRFScanCacheValue(f, num_names) ||
+			type >= PTYPE_END) {
+		return false;
+	}
+	info->type = (GRFParameterType)type;
+
+	for (uint i = 0; i < num_names; i++) {
+		uint32 value;
+		GRFText *name;
+		if (!ReadGRFScanCacheValue(f, value) || !ReadGRFTextList(f, &name)) return false;
+		info->value_names.Insert(value, name);
+	}
+	return true;
+}
+
+/**
+ * Read the details of a scanned NewGRF from the NewGRF scan cache.
+ * @param f The cache file.
+ * @return The NewGRF, or \c NULL when the cache is damaged.
+ */
+static GRFConfig *ReadGRFScanCacheConfig(FILE *f)
+{
+	GRFConfig *c = new GRFConfig();
+	byte status;
+	uint16 num_param_info;
+	if (!ReadGRFScanCacheValue(f, c->ident) ||
+			!ReadGRFScanCacheValue(f, c->version) ||
+			!ReadGRFScanCacheValue(f, c->min_loadable_version) ||
+			!ReadGRFScanCacheValue(f, c->flags) ||
+			!ReadGRFScanCacheValue(f, status) ||
+			!ReadGRFScanCacheValue(f, c->palette) ||
+			!ReadGRFScanCacheValue(f, c->num_valid_params) ||
+			!ReadGRFScanCacheValue(f, c->has_param_defaults) ||
+			!ReadGRFTextList(f, &c->name->text) ||
+			!ReadGRFTextList(f, &c->info->text) ||
+			!ReadGRFTextList(f, &c->url->text) ||
+			!ReadGRFScanCacheValue(f, num_param_info)) {
+		delete c;
+		return NULL;
+	}
+	c->status = (GRFStatus)status;
+
+	for (uint i = 0; i < num_param_info; i++) {
+		bool present;
+		if (!ReadGRFScanCacheValue(f, present)) {
+			delete c;
+			return NULL;
+		}
+
+		GRFParameterInfo *info = present ? new GRFParameterInfo(i) : NULL;
+		*c->param_info.Append() = info;
+		if (info != NULL && !ReadGRFScanCacheParameterInfo(f, info)) {
+			delete c;
+			return NULL;
+		}
+	}
+
+	return c;
+}
+
+/** Read the NewGRF scan cache from disk, unless that happened before. */
+static void LoadGRFScanCache()
+{
+	if (_grf_scan_cache_loaded) return;
+	_grf_scan_cache_loaded = true;
+
+	if (_newgrf_scan_cache_file == NULL) return;
+	FILE *f = fopen(_newgrf_scan_cache_file, "rb");
+	if (f == NULL) return;
+
+	uint32 magic, version, count;
+	if (!ReadGRFScanCacheValue(f, magic) || magic != GRF_SCAN_CACHE_MAGIC ||
+			!ReadGRFScanCacheValue(f, version) || version != GRF_SCAN_CACHE_VERSION ||
+			!ReadGRFScanCacheValue(f, count)) {
+		DEBUG(grf, 1, "Ignoring NewGRF scan cache of an unknown format");
+		fclose(f);
+		return;
+	}
+
+	for (uint i = 0; i < count; i++) {
+		uint16 len;
+		bool valid;
+		GRFScanCacheItem item;
+		if (!ReadGRFScanCacheValue(f, len) || len == 0) break;
+
+		std::string key(len, '\0');
+		if (fread(&key[0], len, 1, f) != 1 ||
+				!ReadGRFScanCacheValue(f, item.size) ||
+				!ReadGRFScanCacheValue(f, item.mtime) ||
+				!ReadGRFScanCacheValue(f, valid)) {
+			break;
+		}
+
+		item.config = valid ? ReadGRFScanCacheConfig(f) : NULL;
+		if (valid && item.config == NULL) break;
+
+		GRFScanCache::iterator it = _grf_scan_cache.find(key);
+		if (it != _grf_scan_cache.end()) delete it->second.config;
+		_grf_scan_cache[key] = item;
+	}
+
+	if (_grf_scan_cache.size() != count) DEBUG(grf, 0, "NewGRF scan cache is damaged; only %d of %d entries are used", (int)_grf_scan_cache.size(), count);
+	DEBUG(grf, 1, "Read %d entries from the NewGRF scan cache", (int)_grf_scan_cache.size());
+	fclose(f);
+}
+
+/** Write the NewGRF scan cache to disk. */
+static void SaveGRFScanCache()
+{
+	if (_newgrf_scan_cache_file == NULL) return;
+	FILE *f = fopen(_newgrf_scan_cache_file, "wb");
+
+	bool ok = f != NULL &&
+			WriteGRFScanCacheValue(f, GRF_SCAN_CACHE_MAGIC) &&
+			WriteGRFScanCacheValue(f, GRF_SCAN_CACHE_VERSION) &&
+			WriteGRFScanCacheValue(f, (uint32)_grf_scan_cache.size());
+
+	for (GRFScanCache::const_iterator it = _grf_scan_cache.begin(); ok && it != _grf_scan_cache.end(); ++it) {
+		const GRFConfig *c = it->second.config;
+		ok = WriteGRFScanCacheValue(f, (uint16)it->first.size()) &&
+				fwrite(it->first.c_str(), it->first.size(), 1, f) == 1 &&
+				WriteGRFScanCacheValue(f, it->second.size) &&
+				WriteGRFScanCacheValue(f, it->second.mtime) &&
+				WriteGRFScanCacheValue(f, c != NULL) &&
+				(c == NULL || WriteGRFScanCacheConfig(f, c));
+	}
+
+	if (f != NULL) fclose(f);
+	if (!ok) DEBUG(grf, 0, "Could not write the NewGRF scan cache to %s", _newgrf_scan_cache_file);
+}
+
+/** A .grf file found by the #GRFFileScanner, waiting to be added to the list of all NewGRFs. */
+struct ScannedGRF {
+	GRFConfig *config; ///< Details of the NewGRF.
+	std::string key;   ///< Key of the file in the scan cache, or empty when the file is not to be cached.
+	uint64 size;       ///< Size of the file, or of the tar it is in.
+	uint64 mtime;      ///< Modification time of the file, or of the tar it is in.
+	bool calc_md5sum;  ///< Whether the md5sum still has to be calculated.
+	bool md5sum_ok;    ///< Whether calculating the md5sum succeeded.
+};
+
 /** Helper for scanning for files with GRF as extension */
 class GRFFileScanner : FileScanner {
 	uint next_update; ///< The next (realtime tick) we do update the screen.
 	uint num_scanned; ///< The number of GRFs we have scanned.
+	std::vector<ScannedGRF> scanned; ///< The usable NewGRFs found, in order of scanning.
+	GRFScanCache cache;   ///< Scan cache of the files found during this scan.
+	bool cache_changed;   ///< Whether the scan cache of this scan differs from the previous one.
+	ThreadMutex *mutex;   ///< Mutex for picking the next NewGRF to calculate the md5sum of.
+	uint next_md5sum;     ///< Index in #scanned of the next NewGRF to calculate the md5sum of.
+
+	void UpdateStatus(const char *name);
+	void RememberScan(const ScannedGRF &grf, GRFConfig *config);
+	void CalcMD5Sums(bool main_thread);
+	void CalcAllMD5Sums();
+	bool AddScannedGRF(ScannedGRF &grf);
+	void UpdateCache();
+
+	/**
+	 * Thread entry for calculating the md5sums of the scanned NewGRFs.
+	 * @param scanner The scanner the NewGRFs belong to.
+	 */
+	static void CalcMD5SumsThread(void *scanner)
+	{
+		((GRFFileScanner *)scanner)->CalcMD5Sums(false);
+	}
 
 public:
-	GRFFileScanner() : next_update(_realtime_tick), num_scanned(0)
+	GRFFileScanner() : next_update(_realtime_tick), num_scanned(0), cache_changed(false), mutex(NULL), next_md5sum(0)
 	{
 	}
 
@@ -637,73 +943,244 @@ public:
 	/** Do the scan for GRFs. */
 	static uint DoScan()
 	{
+		LoadGRFScanCache();
+
 		GRFFileScanner fs;
-		int ret = fs.Scan(".grf", NEWGRF_DIR);
+		fs.Scan(".grf", NEWGRF_DIR);
+		fs.CalcAllMD5Sums();
+
 		/* The number scanned and the number returned may not be the same;
 		 * duplicate NewGRFs and base sets are ignored in the return value. */
+		uint ret = 0;
+		for (std::vector<ScannedGRF>::iterator it = fs.scanned.begin(); it != fs.scanned.end(); ++it) {
+			if (fs.AddScannedGRF(*it)) ret++;
+		}
+		fs.UpdateCache();
+
 		_settings_client.gui.last_newgrf_count = fs.num_scanned;
 		return ret;
 	}
 };
 
+/**
+ * Update the status of the scan in the modal progress window, if it is time to.
+ * @param name Name of the NewGRF that is being scanned.
+ */
+void GRFFileScanner::UpdateStatus(const char *name)
+{
+	if (this->next_update > _realtime_tick) return;
+
+	_modal_progress_work_mutex->EndCritical();
+	_modal_progress_paint_mutex->BeginCritical();
+
+	UpdateNewGRFScanStatus(this->num_scanned, name);
+
+	_modal_progress_work_mutex->BeginCritical();
+	_modal_progress_paint_mutex->EndCritical();
+
+	this->next_update = _realtime_tick + 200;
+}
+
+/**
+ * Remember the result of scanning a file in the scan cache of this scan.
+ * @param grf    The scanned file.
+ * @param config The details of the NewGRF, or \c NULL when it is not usable; the cache takes ownership.
+ */
+void GRFFileScanner::RememberScan(const ScannedGRF &grf, GRFConfig *config)
+{
+	GRFScanCacheItem &item = this->cache[grf.key];
+	if (item.config != config) delete item.config;
+	item.size = grf.size;
+	item.mtime = grf.mtime;
+	item.config = config;
+}
+
 bool GRFFileScanner::AddFile(const char *filename, size_t basepath_length, const char *tar_filename)
 {
-	GRFConfig *c = new GRFConfig(filename + basepath_length);
+	ScannedGRF grf;
+	grf.config = NULL;
+	grf.size = 0;
+	grf.mtime = 0;
+	grf.calc_md5sum = false;
+	grf.md5sum_ok = false;
+
+	/* A file in a tar only changes when the tar changes. */
+	const char *path = tar_filename != NULL ? tar_filename : filename;
+#ifdef WIN32
+	struct _stat sb;
+	if (_tstat(OTTD2FS(path), &sb) == 0) {
+#else
+	struct stat sb;
+	if (stat(path, &sb) == 0) {
+#endif
+		grf.key = filename;
+		grf.size = sb.st_size;
+		grf.mtime = sb.st_mtime;
+	}
 
-	bool added = true;
-	if (FillGRFDetails(c, false)) {
-		if (_all_grfs == NULL) {
-			_all_grfs = c;
-		} else {
-			/* Insert file into list at a position determined by its
-			 * name, so the list is sorted as we go along */
-			GRFConfig **pd, *d;
-			bool stop = false;
-			for (pd = &_all_grfs; (d = *pd) != NULL; pd = &d->next) {
-				if (c->ident.grfid == d->ident.grfid && memcmp(c->ident.md5sum, d->ident.md5sum, sizeof(c->ident.md5sum)) == 0) added = false;
-				/* Because there can be multiple grfs with the same name, make sure we checked all grfs with the same name,
-				 *  before inserting the entry. So insert a new grf at the end of all grfs with the same name, instead of
-				 *  just after the first with the same name. Avoids doubles in the list. */
-				if (strcasecmp(c->GetName(), d->GetName()) <= 0) {
-					stop = true;
-				} else if (stop) {
-					break;
-				}
-			}
-			if (added) {
-				c->next = d;
-				*pd = c;
-			}
+	GRFScanCache::iterator it = grf.key.empty() ? _grf_scan_cache.end() : _grf_scan_cache.find(grf.key);
+	if (it != _grf_scan_cache.end() && it->second.size == grf.size && it->second.mtime == grf.mtime) {
+		/* The file did not change since it was scanned before. */
+		GRFConfig *cached = it->second.config;
+		_grf_scan_cache.erase(it);
+		this->RememberScan(grf, cached);
+
+		if (cached != NULL) {
+			grf.config = new GRFConfig(*cached);
+			free(grf.config->filename);
+			grf.config->filename = stredup(filename + basepath_length);
+			/* The palette to use may depend on the default palette setting, which might have changed since. */
+			grf.config->SetSuitablePalette();
 		}
 	} else {
-		added = false;
+		this->cache_changed = true;
+
+		GRFConfig *c = new GRFConfig(filename + basepath_length);
+		if (FillGRFDetailsWithoutMD5Sum(c, false, NEWGRF_DIR)) {
+			grf.config = c;
+			grf.calc_md5sum = true;
+		} else {
+			/* Remember files that are not usable NewGRFs, unless they could not be opened at all. */
+			if (!grf.key.empty() && c->status != GCS_NOT_FOUND) this->RememberScan(grf, NULL);
+			delete c;
+		}
 	}
 
+	if (grf.config != NULL) this->scanned.push_back(grf);
+
 	this->num_scanned++;
-	if (this->next_update <= _realtime_tick) {
-		_modal_progress_work_mutex->EndCritical();
-		_modal_progress_paint_mutex->BeginCritical();
+	const char *name = NULL;
+	if (grf.config != NULL) name = GetGRFStringFromGRFText(grf.config->name->text);
+	this->UpdateStatus(name != NULL ? name : filename + basepath_length);
 
-		const char *name = NULL;
-		if (c->name != NULL) name = GetGRFStringFromGRFText(c->name->text);
-		if (name == NULL) name = c->filename;
-		UpdateNewGRFScanStatus(this->num_scanned, name);
+	return grf.config != NULL;
+}
 
-		_modal_progress_work_mutex->BeginCritical();
-		_modal_progress_paint_mutex->EndCritical();
+/**
+ * Calculate the md5sums of scanned NewGRFs until there are none left.
+ * @param main_thread Whether this is the scanning thread, which also updates the modal progress window.
+ */
+void GRFFileScanner::CalcMD5Sums(bool main_thread)
+{
+	for (;;) {
+		/* Opening files uses shared buffers on some platforms, so only pick and open a file while holding the mutex. */
+		this->mutex->BeginCritical();
+		while (this->next_md5sum < this->scanned.size() && !this->scanned[this->next_md5sum].calc_md5sum) this->next_md5sum++;
+		if (this->next_md5sum == this->scanned.size()) {
+			this->mutex->EndCritical();
+			return;
+		}
+		ScannedGRF &grf = this->scanned[this->next_md5sum++];
+		size_t size;
+		FILE *f = FioFOpenFile(grf.config->filename, "rb", NEWGRF_DIR, &size);
+		this->mutex->EndCritical();
 
-		this->next_update = _realtime_tick + 200;
+		grf.md5sum_ok = f != NULL && CalcGRFMD5Sum(grf.config, f, size);
+
+		if (main_thread) {
+			const char *name = GetGRFStringFromGRFText(grf.config->name->text);
+			this->UpdateStatus(name != NULL ? name : grf.config->filename);
+		}
+	}
+}
+
+/** Calculate the md5sums of all new and changed NewGRFs, spread over the processor cores. */
+void GRFFileScanner::CalcAllMD5Sums()
+{
+	uint num = 0;
+	for (std::vector<ScannedGRF>::const_iterator it = this->scanned.begin(); it != this->scanned.end(); ++it) {
+		if (it->calc_md5sum) num++;
+	}
+	if (num == 0) return;
+
+	this->mutex = ThreadMutex::New();
+	this->next_md5sum = 0;
+
+	SmallVector<ThreadObject *, 8> threads;
+	uint num_threads = Clamp<uint>(GetCPUCoreCount(), 1, num);
+	for (uint i = 1; i < num_threads; i++) {
+		ThreadObject *thread;
+		if (!ThreadObject::New(&GRFFileScanner::CalcMD5SumsThread, this, &thread)) break;
+		*threads.Append() = thread;
+	}
+
+	DEBUG(grf, 1, "Calculating md5sums of %d new or changed NewGRFs using %d threads", num, threads.Length() + 1);
+	this->CalcMD5Sums(true);
+
+	for (ThreadObject **thread = threads.Begin(); thread != threads.End(); thread++) {
+		(*thread)->Join();
+		delete *thread;
+	}
+
+	delete this->mutex;
+	this->mutex = NULL;
+}
+
+/**
+ * Add a scanned NewGRF to the list of all NewGRFs.
+ * @param grf The scanned NewGRF; its config is consumed.
+ * @return Whether the NewGRF has been added to the list.
+ */
+bool GRFFileScanner::AddScannedGRF(ScannedGRF &grf)
+{
+	GRFConfig *c = grf.config;
+	grf.config = NULL;
+
+	if (grf.calc_md5sum) {
+		if (!grf.md5sum_ok) {
+			delete c;
+			return false;
+		}
+		if (!grf.key.empty() && c->error == NULL) this->RememberScan(grf, new GRFConfig(*c));
+	}
+
+	bool added = true;
+	if (_all_grfs == NULL) {
+		_all_grfs = c;
+	} else {
+		/* Insert file into list at a position determined by its
+		 * name, so the list is sorted as we go along */
+		GRFConfig **pd, *d;
+		bool stop = false;
+		for (pd = &_all_grfs; (d = *pd) != NULL; pd = &d->next) {
+			if (c->ident.grfid == d->ident.grfid && memcmp(c->ident.md5sum, d->ident.md5sum, sizeof(c->ident.md5sum)) == 0) added = false;
+			/* Because there can be multiple grfs with the same name, make sure we checked all grfs with the same name,
+			 *  before inserting the entry. So insert a new grf at the end of all grfs with the same name, instead of
+			 *  just after the first with the same name. Avoids doubles in the list. */
+			if (strcasecmp(c->GetName(), d->GetName()) <= 0) {
+				stop = true;
+			} else if (stop) {
+				break;
+			}
+		}
+		if (added) {
+			c->next = d;
+			*pd = c;
+		}
 	}
 
 	if (!added) {
-		/* File couldn't be opened, or is either not a NewGRF or is a
-		 * 'system' NewGRF or it's already known, so forget about it. */
+		/* The NewGRF is already known, so forget about it. */
 		delete c;
 	}
 
 	return added;
 }
 
+/** Replace the NewGRF scan cache by the results of this scan, and write it when anything changed. */
+void GRFFileScanner::UpdateCache()
+{
+	/* Whatever is left of the previous scan belongs to files that are gone. */
+	if (!_grf_scan_cache.empty()) this->cache_changed = true;
+	for (GRFScanCache::iterator it = _grf_scan_cache.begin(); it != _grf_scan_cache.end(); ++it) {
+		delete it->second.config;
+	}
+	_grf_scan_cache.clear();
+	_grf_scan_cache.swap(this->cache);
+
+	if (this->cache_changed) SaveGRFScanCache();
+}
+
 /**
  * Simple sorter for GRFS
  * @param p1 the first GRFConfig *
@@ -792,6 +792,61 @@ void CleanUpGRFText(GRFText *grftext)
 	}
 }
 
+/**
+ * Write a linked GRFText list to a file.
+ * @param f       the file to write to
+ * @param grftext the head of the list to write
+ * @return whether the whole list has been written
+ */
+bool WriteGRFTextList(FILE *f, const GRFText *grftext)
+{
+	uint16 count = 0;
+	for (const GRFText *t = grftext; t != NULL; t = t->next) count++;
+	if (fwrite(&count, sizeof(count), 1, f) != 1) return false;
+
+	for (; grftext != NULL; grftext = grftext->next) {
+		uint32 len = (uint32)grftext->len;
+		if (fwrite(&grftext->langid, sizeof(grftext->langid), 1, f) != 1 ||
+				fwrite(&len, sizeof(len), 1, f) != 1 ||
+				fwrite(grftext->text, len, 1, f) != 1) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Read a linked GRFText list that was written by #WriteGRFTextList.
+ * @param f       the file to read from
+ * @param grftext the place to store the head of the read list
+ * @return whether the whole list has been read; if not,  grftext is \c NULL
+ */
+bool ReadGRFTextList(FILE *f, GRFText **grftext)
+{
+	*grftext = NULL;
+
+	uint16 count;
+	if (fread(&count, sizeof(count), 1, f) != 1) return false;
+
+	GRFText **ptext = grftext;
+	for (uint i = 0; i < count; i++) {
+		byte langid;
+		uint32 len;
+		char *text = NULL;
+		if (fread(&langid, sizeof(langid), 1, f) != 1 || fread(&len, sizeof(len), 1, f) != 1 || len == 0 || len > UINT16_MAX ||
+				fread(text = MallocT<char>(len), len, 1, f) != 1) {
+			free(text);
+			CleanUpGRFText(*grftext);
+			*grftext = NULL;
+			return false;
+		}
+		*ptext = GRFText::New(langid, text, len);
+		ptext = &(*ptext)->next;
+		free(text);
+	}
+	return true;
+}
+
 /**
  * House cleaning.
  * Remove all strings and reset the text counter.
@@ -34,6 +34,7 @@
 #include "date_func.h"
 #include "newgrf_debug.h"
 #include "vehicle_func.h"
+#include "pathfinder/yapf/yapf_cache.h"
 
 #include "table/strings.h"
 #include "table/object_land.h"
@@ -124,6 +125,8 @@ void BuildObject(ObjectType type, TileIndex tile, CompanyID owner, Town *town, u
 			DirtyCompanyInfrastructureWindows(owner);
 		}
 		MakeObject(t, owner, o->index, wc, Random());
+		/* Water tiles are not cleared first, so tell the ship pathfinder they are blocked now. */
+		if (wc != WATER_CLASS_INVALID) YapfNotifyWaterLayoutChange(t);
 		MarkTileDirtyByTile(t);
 	}
 
@@ -63,6 +63,8 @@
 #include "subsidy_func.h"
 #include "gfx_layout.h"
 #include "viewport_sprite_sorter.h"
+#include "replay.h"
+#include "spritecache.h"
 
 #include "linkgraph/linkgraphschedule.h"
 
@@ -165,7 +167,7 @@ static void ShowHelp()
 		"  -n [ip:port#company]= Join network game\n"
 		"  -p password         = Password to join server\n"
 		"  -P password         = Password to join company\n"
-		"  -D [ip][:port]      = Start dedicated server\n"
+		"  -D [ip][:port]      = Start dedicated server (relaying the game of -n)\n"
 		"  -l ip[:port]        = Redirect DEBUG()\n"
 #if !defined(__MORPHOS__) && !defined(__AMIGA__) && !defined(WIN32)
 		"  -f                  = Fork into the background (dedicated only)\n"
@@ -177,6 +179,8 @@ static void ShowHelp()
 		"  -c config_file      = Use 'config_file' instead of 'openttd.cfg'\n"
 		"  -x                  = Do not automatically save to config file on exit\n"
 		"  -q savegame         = Write some information about the savegame and exit\n"
+		"  -B save,log,ticks   = Benchmark ticks of savegame, replaying a command log\n"
+		"  -W maps             = Benchmark generating maps one after another\n"
 		"\n",
 		lastof(buf)
 	);
@@ -307,6 +311,9 @@ static void ShutdownGame()
 	/* No NewGRFs were loaded when it was still bootstrapping. */
 	if (_game_mode != GM_BOOTSTRAP) ResetNewGRFData();
 
+	/* Stop reading sprites from the files before closing them. */
+	GfxStopSpritePrefetch();
+
 	/* Close all and any open filehandles */
 	FioCloseAll();
 
@@ -479,6 +486,9 @@ struct AfterNewGRFScan : NewGRFScanCallback {
 			}
 			if (port != NULL) rport = atoi(port);
 
+			/* A relay only watches the game it passes on. */
+			if (_network_relay) join_as = COMPANY_SPECTATOR;
+
 			LoadIntroGame();
 			_switch_mode = SM_NONE;
 			NetworkClientConnectGame(NetworkAddress(network_conn, rport), join_as, join_server_password, join_company_password);
@@ -522,6 +532,8 @@ static const OptionData _options[] = {
 	 GETOPT_SHORT_VALUE('c'),
 	 GETOPT_SHORT_NOVAL('x'),
 	 GETOPT_SHORT_VALUE('q'),
+	 GETOPT_SHORT_VALUE('B'),
+	 GETOPT_SHORT_VALUE('W'),
 	 GETOPT_SHORT_NOVAL('h'),
 	GETOPT_END()
 };
@@ -666,6 +678,55 @@ int openttd_main(int argc, char *argv[])
 
 			goto exit_noshutdown;
 		}
+		case 'B': {
+			if (!ParseReplayBenchmark(mgo.opt, _file_to_saveload.name, lastof(_file_to_saveload.name))) {
+				i = -2; // Force printing of help.
+				break;
+			}
+			_switch_mode = SM_LOAD_GAME;
+			_file_to_saveload.mode = SL_LOAD;
+
+			const char *t = strrchr(_file_to_saveload.name, '.');
+			if (t != NULL) {
+				FiosType ft = FiosGetSavegameListCallback(SLD_LOAD_GAME, _file_to_saveload.name, t, NULL, NULL);
+				if (ft != FIOS_TYPE_INVALID) SetFiosType(ft);
+			}
+
+			/* The benchmark runs headless, without any output. */
+			free(musicdriver);
+			free(sounddriver);
+			free(videodriver);
+			free(blitter);
+			musicdriver = stredup("null");
+			sounddriver = stredup("null");
+			videodriver = stredup("null");
+			blitter = stredup("null");
+			break;
+		}
+		case 'W': {
+			int maps = atoi(mgo.opt);
+			if (maps <= 0) {
+				i = -2; // Force printing of help.
+				break;
+			}
+			_genworld_benchmark_maps = maps;
+			_switch_mode = SM_NEWGAME;
+			/* Start at a random map if no seed has been given */
+			if (scanner->generation_seed == GENERATE_NEW_SEED) {
+				scanner->generation_seed = InteractiveRandom();
+			}
+
+			/* The benchmark runs headless, without any output. */
+			free(musicdriver);
+			free(sounddriver);
+			free(videodriver);
+			free(blitter);
+			musicdriver = stredup("null");
+			sounddriver = stredup("null");
+			videodriver = stredup("null");
+			blitter = stredup("null");
+			break;
+		}
 		case 'G': scanner->generation_seed = atoi(mgo.opt); break;
 		case 'c': free(_config_file); _config_file = stredup(mgo.opt); break;
 		case 'x': scanner->save_config = false; break;
@@ -702,6 +763,8 @@ int openttd_main(int argc, char *argv[])
 
 #if defined(ENABLE_NETWORK)
 	if (dedicated) DEBUG(net, 0, "Starting dedicated version %s", _openttd_revision);
+	/* A dedicated server that joins another server relays that game to its own clients. */
+	if (dedicated && scanner->network_conn != NULL) _network_relay = true;
 	if (_dedicated_forks && !dedicated) _dedicated_forks = false;
 
 #if defined(UNIX) && !defined(__MORPHOS__)
@@ -1181,6 +1244,205 @@ void SwitchToMode(SwitchMode new_mode)
 }
 
 
+/**
+ * Get the size of the object of a vehicle, so it can be backed up bytewise.
+ * @param v The vehicle.
+ * @return The size of the object.
+ */
+static size_t GetVehicleObjectSize(const Vehicle *v)
+{
+	switch (v->type) {
+		case VEH_TRAIN:    return sizeof(Train);
+		case VEH_ROAD:     return sizeof(RoadVehicle);
+		case VEH_SHIP:     return sizeof(Ship);
+		case VEH_AIRCRAFT: return sizeof(Aircraft);
+		default: NOT_REACHED();
+	}
+}
+
+/**
+ * Check the caches of a vehicle consist against the values they would have
+ * when calculated from the 'base' data. This recalculates the caches.
+ * @param v The vehicle; only the first vehicle of a primary consist is checked.
+ * @param restore Whether to restore the vehicles afterwards, so the check does not change the game state.
+ */
+static void CheckVehicleCaches(Vehicle *v, bool restore)
+{
+	extern void FillNewGRFVehicleCache(const Vehicle *v);
+	if (v != v->First() || v->vehstatus & VS_CRASHED || !v->IsPrimaryVehicle()) return;
+
+	uint length = 0;
+	for (const Vehicle *u = v; u != NULL; u = u->Next()) length++;
+
+	NewGRFCache        *grf_cache = CallocT<NewGRFCache>(length);
+	VehicleCache       *veh_cache = CallocT<VehicleCache>(length);
+	GroundVehicleCache *gro_cache = CallocT<GroundVehicleCache>(length);
+	TrainCache         *tra_cache = CallocT<TrainCache>(length);
+	byte              **backup    = CallocT<byte *>(length);
+
+	length = 0;
+	for (const Vehicle *u = v; u != NULL; u = u->Next()) {
+		/* Recalculating the caches also changes other properties of the vehicles, so back up the whole objects. */
+		if (restore) {
+			backup[length] = MallocT<byte>(GetVehicleObjectSize(u));
+			memcpy(backup[length], u, GetVehicleObjectSize(u));
+		}
+		FillNewGRFVehicleCache(u);
+		grf_cache[length] = u->grf_cache;
+		veh_cache[length] = u->vcache;
+		switch (u->type) {
+			case VEH_TRAIN:
+				gro_cache[length] = Train::From(u)->gcache;
+				tra_cache[length] = Train::From(u)->tcache;
+				break;
+			case VEH_ROAD:
+				gro_cache[length] = RoadVehicle::From(u)->gcache;
+				break;
+			default:
+				break;
+		}
+		length++;
+	}
+
+	switch (v->type) {
+		case VEH_TRAIN:    Train::From(v)->ConsistChanged(CCF_TRACK); break;
+		case VEH_ROAD:     RoadVehUpdateCache(RoadVehicle::From(v)); break;
+		case VEH_AIRCRAFT: UpdateAircraftCache(Aircraft::From(v));   break;
+		case VEH_SHIP:     Ship::From(v)->UpdateCache();             break;
+		default: break;
+	}
+
+	length = 0;
+	for (const Vehicle *u = v; u != NULL; u = u->Next()) {
+		FillNewGRFVehicleCache(u);
+		if (memcmp(&grf_cache[length], &u->grf_cache, sizeof(NewGRFCache)) != 0) {
+			DEBUG(desync, 0, "newgrf cache mismatch: type %i, vehicle %i, company %i, unit number %i, wagon %i", (int)v->type, v->index, (int)v->owner, v->unitnumber, length);
+		}
+		if (memcmp(&veh_cache[length], &u->vcache, sizeof(VehicleCache)) != 0) {
+			DEBUG(desync, 0, "vehicle cache mismatch: type %i, vehicle %i, company %i, unit number %i, wagon %i", (int)v->type, v->index, (int)v->owner, v->unitnumber, length);
+		}
+		switch (u->type) {
+			case VEH_TRAIN:
+				if (memcmp(&gro_cache[length], &Train::From(u)->gcache, sizeof(GroundVehicleCache)) != 0) {
+					DEBUG(desync, 0, "train ground vehicle cache mismatch: vehicle %i, company %i, unit number %i, wagon %i", v->index, (int)v->owner, v->unitnumber, length);
+				}
+				if (memcmp(&tra_cache[length], &Train::From(u)->tcache, sizeof(TrainCache)) != 0) {
+					DEBUG(desync, 0, "train cache mismatch: vehicle %i, company %i, unit number %i, wagon %i", v->index, (int)v->owner, v->unitnumber, length);
+				}
+				break;
+			case VEH_ROAD:
+				if (memcmp(&gro_cache[length], &RoadVehicle::From(u)->gcache, sizeof(GroundVehicleCache)) != 0) {
+					DEBUG(desync, 0, "road vehicle ground vehicle cache mismatch: vehicle %i, company %i, unit number %i, wagon %i", v->index, (int)v->owner, v->unitnumber, length);
+				}
+				break;
+			default:
+				break;
+		}
+		length++;
+	}
+
+	length = 0;
+	for (Vehicle *u = v; u != NULL; length++) {
+		Vehicle *next = u->Next();
+		if (restore) {
+			memcpy((void *)u, backup[length], GetVehicleObjectSize(u));
+			free(backup[length]);
+		}
+		u = next;
+	}
+
+	free(grf_cache);
+	free(veh_cache);
+	free(gro_cache);
+	free(tra_cache);
+	free(backup);
+}
+
+/**
+ * Check whether the cached amounts of a cargo list match its packets.
+ * @param list The cargo list.
+ * @param restore Whether to restore the cache afterwards, so the check does not change the game state.
+ * @return True iff the cache is valid.
+ */
+template <class Tlist>
+static bool IsCargoListCacheValid(Tlist *list, bool restore)
+{
+	byte buff[sizeof(Tlist)];
+	memcpy(buff, list, sizeof(Tlist));
+	list->InvalidateCache();
+	bool valid = memcmp(list, buff, sizeof(Tlist)) == 0;
+	if (restore) memcpy((void *)list, buff, sizeof(Tlist));
+	return valid;
+}
+
+/**
+ * Check whether the cargo caches of the goods at a station are valid.
+ * @param st The station.
+ * @param restore Whether to restore the caches afterwards, so the check does not change the game state.
+ * @return The first cargo with an invalid cache, or #CT_INVALID when they are all valid.
+ */
+static CargoID FindInvalidStationCargoCache(Station *st, bool restore)
+{
+	for (CargoID c = 0; c < NUM_CARGO; c++) {
+		if (!IsCargoListCacheValid(&st->goods[c].cargo, restore)) return c;
+	}
+	return CT_INVALID;
+}
+
+/**
+ * Check whether the entries of a drive through road stop are valid.
+ * @param rs The road stop.
+ * @return True iff the entries are valid, or it is not a drive through road stop.
+ */
+static bool IsRoadStopCacheValid(const RoadStop *rs)
+{
+	if (IsStandardRoadStopTile(rs->xy)) return true;
+
+	assert(rs->GetEntry(DIAGDIR_NE) != rs->GetEntry(DIAGDIR_NW));
+	return rs->GetEntry(DIAGDIR_NE)->CheckIntegrity(rs) && rs->GetEntry(DIAGDIR_NW)->CheckIntegrity(rs);
+}
+
+/** Vehicle index the sampled cache validation continues with. */
+static uint _cache_check_vehicle = 0;
+/** Station index the sampled cache validation continues with. */
+static uint _cache_check_station = 0;
+/** Road stop index the sampled cache validation continues with. */
+static uint _cache_check_roadstop = 0;
+
+/**
+ * Check the caches of a slice of the vehicles, stations and road stops,
+ * continuing where the previous tick stopped. This goes on until the
+ * time budget of this tick has been used up, or until everything has been
+ * checked once. Unlike #CheckCaches mismatches are only reported and the
+ * recalculated caches are thrown away again, so the checked objects do not
+ * change and it can be enabled on a live server.
+ */
+static void CheckCachesSampled()
+{
+	uint64 end = GetPerformanceTimer() + _settings_client.gui.cache_check_budget;
+	size_t steps = max(Vehicle::GetPoolSize(), max(Station::GetPoolSize(), RoadStop::GetPoolSize()));
+
+	for (size_t i = 0; i < steps && GetPerformanceTimer() < end; i++) {
+		if (_cache_check_vehicle >= Vehicle::GetPoolSize()) _cache_check_vehicle = 0;
+		Vehicle *v = Vehicle::GetIfValid(_cache_check_vehicle++);
+		if (v != NULL) {
+			CheckVehicleCaches(v, true);
+			if (!IsCargoListCacheValid(&v->cargo, true)) DEBUG(desync, 0, "vehicle cargo cache mismatch: vehicle %i", v->index);
+		}
+
+		if (_cache_check_station >= Station::GetPoolSize()) _cache_check_station = 0;
+		Station *st = Station::GetIfValid(_cache_check_station++);
+		if (st != NULL) {
+			CargoID c = FindInvalidStationCargoCache(st, true);
+			if (c != CT_INVALID) DEBUG(desync, 0, "station cargo cache mismatch: station %i, cargo %i", st->index, c);
+		}
+
+		if (_cache_check_roadstop >= RoadStop::GetPoolSize()) _cache_check_roadstop = 0;
+		const RoadStop *rs = RoadStop::GetIfValid(_cache_check_roadstop++);
+		if (rs != NULL && !IsRoadStopCacheValid(rs)) DEBUG(desync, 0, "road stop cache mismatch: road stop %i, tile 0x%x", rs->index, rs->xy);
+	}
+}
+
 /**
  * Check the validity of some of the caches.
  * Especially in the sense of desyncs between
@@ -1189,6 +1451,9 @@ void SwitchToMode(SwitchMode new_mode)
  */
 static void CheckCaches()
 {
+	/* With a time budget only a slice of the caches is checked every tick. */
+	if (_debug_desync_level <= 1 && _settings_client.gui.cache_check_budget != 0) CheckCachesSampled();
+
 	/* Return here so it is easy to add checks that are run
 	 * always to aid testing of caches. */
 	if (_debug_desync_level <= 1) return;
@@ -1231,104 +1496,22 @@ static void CheckCaches()
 	/* Strict checking of the road stop cache entries */
 	const RoadStop *rs;
 	FOR_ALL_ROADSTOPS(rs) {
-		if (IsStandardRoadStopTile(rs->xy)) continue;
-
-		assert(rs->GetEntry(DIAGDIR_NE) != rs->GetEntry(DIAGDIR_NW));
-		rs->GetEntry(DIAGDIR_NE)->CheckIntegrity(rs);
-		rs->GetEntry(DIAGDIR_NW)->CheckIntegrity(rs);
+		if (!IsRoadStopCacheValid(rs)) NOT_REACHED();
 	}
 
 	Vehicle *v;
-	FOR_ALL_VEHICLES(v) {
-		extern void FillNewGRFVehicleCache(const Vehicle *v);
-		if (v != v->First() || v->vehstatus & VS_CRASHED || !v->IsPrimaryVehicle()) continue;
-
-		uint length = 0;
-		for (const Vehicle *u = v; u != NULL; u = u->Next()) length++;
-
-		NewGRFCache        *grf_cache = CallocT<NewGRFCache>(length);
-		VehicleCache       *veh_cache = CallocT<VehicleCache>(length);
-		GroundVehicleCache *gro_cache = CallocT<GroundVehicleCache>(length);
-		TrainCache         *tra_cache = CallocT<TrainCache>(length);
-
-		length = 0;
-		for (const Vehicle *u = v; u != NULL; u = u->Next()) {
-			FillNewGRFVehicleCache(u);
-			grf_cache[length] = u->grf_cache;
-			veh_cache[length] = u->vcache;
-			switch (u->type) {
-				case VEH_TRAIN:
-					gro_cache[length] = Train::From(u)->gcache;
-					tra_cache[length] = Train::From(u)->tcache;
-					break;
-				case VEH_ROAD:
-					gro_cache[length] = RoadVehicle::From(u)->gcache;
-					break;
-				default:
-					break;
-			}
-			length++;
-		}
-
-		switch (v->type) {
-			case VEH_TRAIN:    Train::From(v)->ConsistChanged(CCF_TRACK); break;
-			case VEH_ROAD:     RoadVehUpdateCache(RoadVehicle::From(v)); break;
-			case VEH_AIRCRAFT: UpdateAircraftCache(Aircraft::From(v));   break;
-			case VEH_SHIP:     Ship::From(v)->UpdateCache();             break;
-			default: break;
-		}
-
-		length = 0;
-		for (const Vehicle *u = v; u != NULL; u = u->Next()) {
-			FillNewGRFVehicleCache(u);
-			if (memcmp(&grf_cache[length], &u->grf_cache, sizeof(NewGRFCache)) != 0) {
-				DEBUG(desync, 2, "newgrf cache mismatch: type %i, vehicle %i, company %i, unit number %i, wagon %i", (int)v->type, v->index, (int)v->owner, v->unitnumber, length);
-			}
-			if (memcmp(&veh_cache[length], &u->vcache, sizeof(VehicleCache)) != 0) {
-				DEBUG(desync, 2, "vehicle cache mismatch: type %i, vehicle %i, company %i, unit number %i, wagon %i", (int)v->type, v->index, (int)v->owner, v->unitnumber, length);
-			}
-			switch (u->type) {
-				case VEH_TRAIN:
-					if (memcmp(&gro_cache[length], &Train::From(u)->gcache, sizeof(GroundVehicleCache)) != 0) {
-						DEBUG(desync, 2, "train ground vehicle cache mismatch: vehicle %i, company %i, unit number %i, wagon %i", v->index, (int)v->owner, v->unitnumber, length);
-					}
-					if (memcmp(&tra_cache[length], &Train::From(u)->tcache, sizeof(TrainCache)) != 0) {
-						DEBUG(desync, 2, "train cache mismatch: vehicle %i, company %i, unit number %i, wagon %i", v->index, (int)v->owner, v->unitnumber, length);
-					}
-					break;
-				case VEH_ROAD:
-					if (memcmp(&gro_cache[length], &RoadVehicle::From(u)->gcache, sizeof(GroundVehicleCache)) != 0) {
-						DEBUG(desync, 2, "road vehicle ground vehicle cache mismatch: vehicle %i, company %i, unit number %i, wagon %i", v->index, (int)v->owner, v->unitnumber, length);
-					}
-					break;
-				default:
-					break;
-			}
-			length++;
-		}
-
-		free(grf_cache);
-		free(veh_cache);
-		free(gro_cache);
-		free(tra_cache);
-	}
+	FOR_ALL_VEHICLES(v) CheckVehicleCaches(v, false);
 
 	/* Check whether the caches are still valid */
 	FOR_ALL_VEHICLES(v) {
-		byte buff[sizeof(VehicleCargoList)];
-		memcpy(buff, &v->cargo, sizeof(VehicleCargoList));
-		v->cargo.InvalidateCache();
-		assert(memcmp(&v->cargo, buff, sizeof(VehicleCargoList)) == 0);
+		bool valid = IsCargoListCacheValid(&v->cargo, false);
+		assert(valid);
 	}
 
 	Station *st;
 	FOR_ALL_STATIONS(st) {
-		for (CargoID c = 0; c < NUM_CARGO; c++) {
-			byte buff[sizeof(StationCargoList)];
-			memcpy(buff, &st->goods[c].cargo, sizeof(StationCargoList));
-			st->goods[c].cargo.InvalidateCache();
-			assert(memcmp(&st->goods[c].cargo, buff, sizeof(StationCargoList)) == 0);
-		}
+		CargoID invalid = FindInvalidStationCargoCache(st, false);
+		assert(invalid == CT_INVALID);
 	}
 }
 
@@ -1370,7 +1553,9 @@ void StateGameLoop()
 			SaveOrLoad(name, SL_SAVE, AUTOSAVE_DIR, false);
 		}
 
+		StartGameLoopPhases();
 		CheckCaches();
+		EndGameLoopPhase(GLP_CHECK_CACHES);
 
 		/* All these actions has to be done from OWNER_NONE
 		 *  for multiplayer compatibility */
@@ -1378,20 +1563,31 @@ void StateGameLoop()
 
 		BasePersistentStorageArray::SwitchMode(PSM_ENTER_GAMELOOP);
 		AnimateAnimatedTiles();
+		EndGameLoopPhase(GLP_ANIMATION);
 		IncreaseDate();
+		EndGameLoopPhase(GLP_DATE);
 		RunTileLoop();
+		EndGameLoopPhase(GLP_TILE_LOOP);
 		CallVehicleTicks();
+		EndGameLoopPhase(GLP_VEHICLES);
 		CallLandscapeTick();
 		BasePersistentStorageArray::SwitchMode(PSM_LEAVE_GAMELOOP);
+		EndGameLoopPhase(GLP_LANDSCAPE);
 
 #ifndef DEBUG_DUMP_COMMANDS
-		AI::GameLoop();
-		Game::GameLoop();
+		/* When replaying a command log, the commands of the scripts are part of the log. */
+		if (!_replay.replay_commands) {
+			AI::GameLoop();
+			Game::GameLoop();
+		}
 #endif
 		UpdateLandscapingLimits();
+		EndGameLoopPhase(GLP_SCRIPTS);
 
 		CallWindowTickEvent();
 		NewsLoop();
+		EndGameLoopPhase(GLP_WINDOWS);
+		EndGameLoopPhases();
 		cur_company.Restore();
 	}
 
@@ -1455,7 +1651,7 @@ void GameLoop()
 		_switch_mode = SM_NONE;
 	}
 
-	IncreaseSpriteLRU();
+	ReleaseEvictedSprites();
 	InteractiveRandom();
 
 	extern int _caret_timer;
@@ -21,4 +21,18 @@
  */
 void YapfNotifyTrackLayoutChange(TileIndex tile, Track track);
 
+/**
+ * Use this function to notify YAPF that the road layout has changed; that is road
+ * pieces, road stops, depots, level crossings, tunnels, bridges or the slope of a tile.
+ * @param tile the tile that is changed, or INVALID_TILE to forget everything cached
+ */
+void YapfNotifyRoadLayoutChange(TileIndex tile);
+
+/**
+ * Use this function to notify YAPF that the ship waterways have changed; that is
+ * water, coasts, locks, docks, buoys, ship depots or aqueducts are built or removed.
+ * @param tile the tile that is changed, or INVALID_TILE to forget everything cached
+ */
+void YapfNotifyWaterLayoutChange(TileIndex tile);
+
 #endif /* YAPF_CACHE_H */
@@ -12,6 +12,113 @@
 #ifndef YAPF_NODE_ROAD_HPP
 #define YAPF_NODE_ROAD_HPP
 
+#include "../../tilearea_type.h"
+
+/** Key of a cached road segment: its first tile and trackdir, and whether it is followed by a tram. */
+struct CYapfRoadSegmentKey
+{
+	uint32    m_value;
+
+	inline CYapfRoadSegmentKey(TileIndex tile, Trackdir td, bool tram) : m_value((tile << 5) | (tram ? 1 << 4 : 0) | td) {}
+
+	inline int32 CalcHash() const
+	{
+		return m_value;
+	}
+
+	inline TileIndex GetTile() const
+	{
+		return (TileIndex)(m_value >> 5);
+	}
+
+	inline Trackdir GetTrackdir() const
+	{
+		return (Trackdir)(m_value & 0x0F);
+	}
+
+	inline bool operator == (const CYapfRoadSegmentKey& other) const
+	{
+		return m_value == other.m_value;
+	}
+
+	void Dump(DumpTarget &dmp) const
+	{
+		dmp.WriteTile("tile", GetTile());
+		dmp.WriteEnumT("td", GetTrackdir());
+		dmp.WriteLine("tram = %d", HasBit(m_value, 4));
+	}
+};
+
+/**
+ * Cached road segment, i.e. the road between two junctions.
+ * Only the static properties of the segment are stored, the cost is
+ * calculated from those with the current penalty settings. Segments
+ * containing road stops, depots or bridges are never cached as their
+ * cost depends on the vehicle or the occupancy of the stops.
+ */
+struct CYapfRoadSegment
+{
+	typedef CYapfRoadSegmentKey Key;
+
+	CYapfRoadSegmentKey    m_key;
+	TileIndex              m_last_tile;      ///< Last tile of the segment.
+	Trackdir               m_last_td;        ///< Last trackdir of the segment.
+	uint32                 m_stamp;          ///< Road layout stamp at the moment the segment was cached, or 0 when it is not cached.
+	TileArea               m_area;           ///< Tiles the segment depends on; the tiles of the segment and their neighbours.
+	uint16                 m_tiles_diagonal; ///< Number of tiles passed along a diagonal trackdir.
+	uint16                 m_tiles_corner;   ///< Number of tiles passed along a curve.
+	uint16                 m_tiles_skipped;  ///< Number of tunnel tiles skipped.
+	uint16                 m_crossings;      ///< Number of level crossings passed.
+	uint16                 m_slopes_up;      ///< Number of times the segment goes uphill.
+	CYapfRoadSegment      *m_hash_next;
+
+	inline CYapfRoadSegment(const CYapfRoadSegmentKey& key)
+		: m_key(key)
+		, m_last_tile(INVALID_TILE)
+		, m_last_td(INVALID_TRACKDIR)
+		, m_stamp(0)
+		, m_tiles_diagonal(0)
+		, m_tiles_corner(0)
+		, m_tiles_skipped(0)
+		, m_crossings(0)
+		, m_slopes_up(0)
+		, m_hash_next(NULL)
+	{}
+
+	inline const Key& GetKey() const
+	{
+		return m_key;
+	}
+
+	inline TileIndex GetTile() const
+	{
+		return m_key.GetTile();
+	}
+
+	inline CYapfRoadSegment *GetHashNext()
+	{
+		return m_hash_next;
+	}
+
+	inline void SetHashNext(CYapfRoadSegment *next)
+	{
+		m_hash_next = next;
+	}
+
+	void Dump(DumpTarget &dmp) const
+	{
+		dmp.WriteStructT("m_key", &m_key);
+		dmp.WriteTile("m_last_tile", m_last_tile);
+		dmp.WriteEnumT("m_last_td", m_last_td);
+		dmp.WriteLine("m_stamp = %d", m_stamp);
+		dmp.WriteLine("m_tiles_diagonal = %d", m_tiles_diagonal);
+		dmp.WriteLine("m_tiles_corner = %d", m_tiles_corner);
+		dmp.WriteLine("m_tiles_skipped = %d", m_tiles_skipped);
+		dmp.WriteLine("m_crossings = %d", m_crossings);
+		dmp.WriteLine("m_slopes_up = %d", m_slopes_up);
+	}
+};
+
 /** Yapf Node for road YAPF */
 template <class Tkey_>
 struct CYapfRoadNodeT
@@ -19,14 +126,16 @@ struct CYapfRoadNodeT
 {
 	typedef CYapfNodeT<Tkey_, CYapfRoadNodeT<Tkey_> > base;
 
-	TileIndex       m_segment_last_tile;
-	Trackdir        m_segment_last_td;
+	TileIndex         m_segment_last_tile;
+	Trackdir          m_segment_last_td;
+	CYapfRoadSegment *m_segment;
 
 	void Set(CYapfRoadNodeT *parent, TileIndex tile, Trackdir td, bool is_choice)
 	{
 		base::Set(parent, tile, td, is_choice);
 		m_segment_last_tile = tile;
 		m_segment_last_td = td;
+		m_segment = NULL;
 	}
 };
 
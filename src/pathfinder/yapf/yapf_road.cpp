@@ -13,9 +13,113 @@
 #include "yapf.hpp"
 #include "yapf_node_road.hpp"
 #include "../../roadstop_base.h"
+#include "../../core/alloc_func.hpp"
 
 #include "../../safeguards.h"
 
+/** Log2 of the size of the square map regions for which road layout changes are tracked. */
+static const uint ROAD_LAYOUT_REGION_BITS = 4;
+
+static uint32  _road_layout_stamp = 1;         ///< Stamp of the last change to the road layout; cached segments younger than the changes around them are valid.
+static uint32 *_road_layout_region_stamps;     ///< Stamp of the last change to the road layout within each map region.
+static uint    _road_layout_regions_map_size;  ///< Map size #_road_layout_region_stamps has been allocated for.
+
+/** Global cache of road segments, shared by all road pathfinder types. */
+static CSegmentCostCacheT<CYapfRoadSegment> &GetRoadSegmentCache()
+{
+	static CSegmentCostCacheT<CYapfRoadSegment> cache;
+	return cache;
+}
+
+/** Drop all cached road segments, and make sure there are region stamps for the current map. */
+static void FlushRoadSegmentCache()
+{
+	GetRoadSegmentCache().Flush();
+
+	_road_layout_regions_map_size = MapSize();
+	free(_road_layout_region_stamps);
+	_road_layout_region_stamps = CallocT<uint32>(MapSize() >> (2 * ROAD_LAYOUT_REGION_BITS));
+	_road_layout_stamp = 1;
+}
+
+/**
+ * Get the stamp to give to a road segment that is cached now.
+ * @return The stamp.
+ */
+static inline uint32 GetRoadLayoutStamp()
+{
+	return _road_layout_stamp + 1;
+}
+
+/**
+ * Check whether the road layout changed somewhere in the area a cached segment depends on.
+ * @param segment The cached segment.
+ * @return True iff the segment is still valid.
+ */
+static bool IsRoadSegmentUpToDate(const CYapfRoadSegment &segment)
+{
+	uint regions_x = MapSizeX() >> ROAD_LAYOUT_REGION_BITS;
+	uint x1 = TileX(segment.m_area.tile) >> ROAD_LAYOUT_REGION_BITS;
+	uint y1 = TileY(segment.m_area.tile) >> ROAD_LAYOUT_REGION_BITS;
+	uint x2 = (TileX(segment.m_area.tile) + segment.m_area.w - 1) >> ROAD_LAYOUT_REGION_BITS;
+	uint y2 = (TileY(segment.m_area.tile) + segment.m_area.h - 1) >> ROAD_LAYOUT_REGION_BITS;
+	for (uint y = y1; y <= y2; y++) {
+		for (uint x = x1; x <= x2; x++) {
+			if (_road_layout_region_stamps[y * regions_x + x] >= segment.m_stamp) return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * CYapfRoadSegmentCacheT - the yapf cost cache provider that attaches the
+ *  globally cached road segment to the nodes. Entries that are outdated by
+ *  changes to the road layout around them are invalidated here, so the
+ *  cost calculation only has to check whether a segment is cached.
+ */
+template <class Types>
+class CYapfRoadSegmentCacheT
+{
+public:
+	typedef typename Types::Tpf Tpf;              ///< the pathfinder class (derived from THIS class)
+	typedef typename Types::NodeList::Titem Node; ///< this will be our node type
+
+protected:
+	inline CYapfRoadSegmentCacheT()
+	{
+		/* the cache is only flushed here, as nodes point into it during the search */
+		if (_road_layout_regions_map_size != MapSize()) FlushRoadSegmentCache();
+	}
+
+	/** to access inherited path finder */
+	inline Tpf& Yapf()
+	{
+		return *static_cast<Tpf*>(this);
+	}
+
+public:
+	/**
+	 * Called by YAPF to attach cached or local segment cost data to the given node.
+	 *  @return true if globally cached data were used or false if local data was used
+	 */
+	inline bool PfNodeCacheFetch(Node& n)
+	{
+		CYapfRoadSegmentKey key(n.GetTile(), n.GetTrackdir(), HasBit(Yapf().GetVehicle()->compatible_roadtypes, ROADTYPE_TRAM));
+		bool found;
+		n.m_segment = &GetRoadSegmentCache().Get(key, &found);
+		if (n.m_segment->m_stamp != 0 && !IsRoadSegmentUpToDate(*n.m_segment)) n.m_segment->m_stamp = 0;
+		return found && n.m_segment->m_stamp != 0;
+	}
+
+	/**
+	 * Called by YAPF to flush the cached segment cost data back into cache storage.
+	 *  Current cache implementation doesn't use that.
+	 */
+	inline void PfNodeCacheFlush(Node& n)
+	{
+	}
+};
+
 
 template <class Types>
 class CYapfCostRoadT
@@ -33,7 +137,14 @@ protected:
 		return *static_cast<Tpf*>(this);
 	}
 
-	int SlopeCost(TileIndex tile, TileIndex next_tile, Trackdir trackdir)
+	/**
+	 * Does the road go uphill from one tile to the next?
+	 * This only depends on the map, so it can be cached regardless of the penalty settings.
+	 * @param tile The current tile.
+	 * @param next_tile The next tile.
+	 * @return True iff the center of the next tile is higher.
+	 */
+	static bool IsSlopeUp(TileIndex tile, TileIndex next_tile)
 	{
 		/* height of the center of the current tile */
 		int x1 = TileX(tile) * TILE_SIZE;
@@ -45,55 +156,38 @@ protected:
 		int y2 = TileY(next_tile) * TILE_SIZE;
 		int z2 = GetSlopePixelZ(x2 + TILE_SIZE / 2, y2 + TILE_SIZE / 2);
 
-		if (z2 - z1 > 1) {
-			/* Slope up */
-			return Yapf().PfGetSettings().road_slope_penalty;
-		}
-		return 0;
+		return z2 - z1 > 1;
 	}
 
-	/** return one tile cost */
-	inline int OneTileCost(TileIndex tile, Trackdir trackdir)
+	/** Cost of the static properties of a (cached) road segment, with the current penalty settings. */
+	inline int SegmentCost(const CYapfRoadSegment &segment)
 	{
-		int cost = 0;
-		/* set base cost */
-		if (IsDiagonalTrackdir(trackdir)) {
-			cost += YAPF_TILE_LENGTH;
-			switch (GetTileType(tile)) {
-				case MP_ROAD:
-					/* Increase the cost for level crossings */
-					if (IsLevelCrossing(tile)) {
-						cost += Yapf().PfGetSettings().road_crossing_penalty;
-					}
-					break;
-
-				case MP_STATION: {
-					const RoadStop *rs = RoadStop::GetByTile(tile, GetRoadStopType(tile));
-					if (IsDriveThroughStopTile(tile)) {
-						/* Increase the cost for drive-through road stops */
-						cost += Yapf().PfGetSettings().road_stop_penalty;
-						DiagDirection dir = TrackdirToExitdir(trackdir);
-						if (!RoadStop::IsDriveThroughRoadStopContinuation(tile, tile - TileOffsByDiagDir(dir))) {
-							/* When we're the first road stop in a 'queue' of them we increase
-							 * cost based on the fill percentage of the whole queue. */
-							const RoadStop::Entry *entry = rs->GetEntry(dir);
-							cost += entry->GetOccupied() * Yapf().PfGetSettings().road_stop_occupied_penalty / entry->GetLength();
-						}
-					} else {
-						/* Increase cost for filled road stops */
-						cost += Yapf().PfGetSettings().road_stop_bay_occupied_penalty * (!rs->IsFreeBay(0) + !rs->IsFreeBay(1)) / 2;
-					}
-					break;
-				}
+		const YAPFSettings &settings = Yapf().PfGetSettings();
+		return (segment.m_tiles_diagonal + segment.m_tiles_skipped) * YAPF_TILE_LENGTH +
+				segment.m_tiles_corner * (YAPF_TILE_CORNER_LENGTH + settings.road_curve_penalty) +
+				segment.m_crossings * settings.road_crossing_penalty +
+				segment.m_slopes_up * settings.road_slope_penalty;
+	}
 
-				default:
-					break;
+	/** Extra cost of a road stop tile depending on how full the road stop is. */
+	inline int RoadStopCost(TileIndex tile, Trackdir trackdir)
+	{
+		const RoadStop *rs = RoadStop::GetByTile(tile, GetRoadStopType(tile));
+		if (IsDriveThroughStopTile(tile)) {
+			/* Increase the cost for drive-through road stops */
+			int cost = Yapf().PfGetSettings().road_stop_penalty;
+			DiagDirection dir = TrackdirToExitdir(trackdir);
+			if (!RoadStop::IsDriveThroughRoadStopContinuation(tile, tile - TileOffsByDiagDir(dir))) {
+				/* When we're the first road stop in a 'queue' of them we increase
+				 * cost based on the fill percentage of the whole queue. */
+				const RoadStop::Entry *entry = rs->GetEntry(dir);
+				cost += entry->GetOccupied() * Yapf().PfGetSettings().road_stop_occupied_penalty / entry->GetLength();
 			}
-		} else {
-			/* non-diagonal trackdir */
-			cost = YAPF_TILE_CORNER_LENGTH + Yapf().PfGetSettings().road_curve_penalty;
+			return cost;
 		}
-		return cost;
+
+		/* Increase cost for filled road stops */
+		return Yapf().PfGetSettings().road_stop_bay_occupied_penalty * (!rs->IsFreeBay(0) + !rs->IsFreeBay(1)) / 2;
 	}
 
 public:
@@ -104,28 +198,71 @@ public:
 	 */
 	inline bool PfCalcCost(Node& n, const TrackFollower *tf)
 	{
-		int segment_cost = 0;
+		int parent_cost = (n.m_parent != NULL) ? n.m_parent->m_cost : 0;
+
+		/* reuse the cached segment, unless our destination might be somewhere along it */
+		CYapfRoadSegment *cached = n.m_segment;
+		if (cached != NULL && cached->m_stamp != 0 && !Yapf().PfDetectDestinationInArea(cached->m_area)) {
+			n.m_segment_last_tile = cached->m_last_tile;
+			n.m_segment_last_td = cached->m_last_td;
+			n.m_cost = parent_cost + SegmentCost(*cached);
+			return true;
+		}
+
+		/* static properties of the segment, and the cost depending on the vehicle or on other vehicles */
+		CYapfRoadSegment segment(CYapfRoadSegmentKey(n.m_key.m_tile, n.m_key.m_td, false));
+		int dynamic_cost = 0;
+		bool cacheable = true;
 		uint tiles = 0;
+		uint min_x = TileX(n.m_key.m_tile), max_x = min_x;
+		uint min_y = TileY(n.m_key.m_tile), max_y = min_y;
 		/* start at n.m_key.m_tile / n.m_key.m_td and walk to the end of segment */
 		TileIndex tile = n.m_key.m_tile;
 		Trackdir trackdir = n.m_key.m_td;
 		for (;;) {
+			min_x = min(min_x, TileX(tile));
+			max_x = max(max_x, TileX(tile));
+			min_y = min(min_y, TileY(tile));
+			max_y = max(max_y, TileY(tile));
+
 			/* base tile cost depending on distance between edges */
-			segment_cost += Yapf().OneTileCost(tile, trackdir);
+			if (IsDiagonalTrackdir(trackdir)) {
+				segment.m_tiles_diagonal++;
+				if (IsLevelCrossingTile(tile)) {
+					/* Increase the cost for level crossings */
+					segment.m_crossings++;
+				} else if (IsTileType(tile, MP_STATION)) {
+					dynamic_cost += Yapf().RoadStopCost(tile, trackdir);
+				}
+			} else {
+				/* non-diagonal trackdir */
+				segment.m_tiles_corner++;
+			}
+			if (IsTileType(tile, MP_STATION)) cacheable = false;
 
 			const RoadVehicle *v = Yapf().GetVehicle();
 			/* we have reached the vehicle's destination - segment should end here to avoid target skipping */
-			if (Yapf().PfDetectDestinationTile(tile, trackdir)) break;
+			if (Yapf().PfDetectDestinationTile(tile, trackdir)) {
+				cacheable = false;
+				break;
+			}
 
 			/* stop if we have just entered the depot */
-			if (IsRoadDepotTile(tile) && trackdir == DiagDirToDiagTrackdir(ReverseDiagDir(GetRoadDepotDirection(tile)))) {
-				/* next time we will reverse and leave the depot */
-				break;
+			if (IsRoadDepotTile(tile)) {
+				cacheable = false;
+				if (trackdir == DiagDirToDiagTrackdir(ReverseDiagDir(GetRoadDepotDirection(tile)))) {
+					/* next time we will reverse and leave the depot */
+					break;
+				}
 			}
 
 			/* if there are no reachable trackdirs on new tile, we have end of road */
 			TrackFollower F(Yapf().GetVehicle());
-			if (!F.Follow(tile, trackdir)) break;
+			if (!F.Follow(tile, trackdir)) {
+				/* whether we may enter a depot depends on the owner of the vehicle */
+				if (F.m_err == TrackFollower::EC_OWNER) cacheable = false;
+				break;
+			}
 
 			/* if there are more trackdirs available & reachable, we are at the end of segment */
 			if (KillFirstBit(F.m_new_td_bits) != TRACKDIR_BIT_NONE) break;
@@ -136,18 +273,19 @@ public:
 			if (F.m_new_tile == n.m_key.m_tile && new_td == n.m_key.m_td) return false;
 
 			/* if we skipped some tunnel tiles, add their cost */
-			segment_cost += F.m_tiles_skipped * YAPF_TILE_LENGTH;
+			segment.m_tiles_skipped += F.m_tiles_skipped;
 			tiles += F.m_tiles_skipped + 1;
 
 			/* add hilly terrain penalty */
-			segment_cost += Yapf().SlopeCost(tile, F.m_new_tile, trackdir);
+			if (IsSlopeUp(tile, F.m_new_tile)) segment.m_slopes_up++;
 
 			/* add min/max speed penalties */
 			int min_speed = 0;
 			int max_veh_speed = v->GetDisplayMaxSpeed();
 			int max_speed = F.GetSpeedLimit(&min_speed);
-			if (max_speed < max_veh_speed) segment_cost += 1 * (max_veh_speed - max_speed);
-			if (min_speed > max_veh_speed) segment_cost += 10 * (min_speed - max_veh_speed);
+			if (max_speed < INT_MAX || min_speed > 0) cacheable = false;
+			if (max_speed < max_veh_speed) dynamic_cost += 1 * (max_veh_speed - max_speed);
+			if (min_speed > max_veh_speed) dynamic_cost += 10 * (min_speed - max_veh_speed);
 
 			/* move to the next tile */
 			tile = F.m_new_tile;
@@ -160,8 +298,19 @@ public:
 		n.m_segment_last_td = trackdir;
 
 		/* save also tile cost */
-		int parent_cost = (n.m_parent != NULL) ? n.m_parent->m_cost : 0;
-		n.m_cost = parent_cost + segment_cost;
+		n.m_cost = parent_cost + SegmentCost(segment) + dynamic_cost;
+
+		/* remember the segment for the next vehicles passing here; the area includes the
+		 * neighbouring tiles as those determine where the segment ends */
+		if (cacheable && cached != NULL) {
+			segment.m_key = cached->m_key;
+			segment.m_hash_next = cached->m_hash_next;
+			segment.m_last_tile = tile;
+			segment.m_last_td = trackdir;
+			segment.m_area = TileArea(TileXY(min_x > 0 ? min_x - 1 : 0, min_y > 0 ? min_y - 1 : 0), TileXY(min(max_x + 1, MapMaxX()), min(max_y + 1, MapMaxY())));
+			segment.m_stamp = GetRoadLayoutStamp();
+			*cached = segment;
+		}
 		return true;
 	}
 };
@@ -194,6 +343,13 @@ public:
 		return IsRoadDepotTile(tile);
 	}
 
+	/** Called by the road cost calculation to check whether a cached segment may pass the destination */
+	inline bool PfDetectDestinationInArea(const TileArea &area)
+	{
+		/* cached segments never contain depots */
+		return false;
+	}
+
 	/**
 	 * Called by YAPF to calculate cost estimate. Calculates distance to the destination
 	 *  adds it to the actual cost from origin and stores the sum to the Node::m_estimate
@@ -264,6 +420,15 @@ public:
 		return tile == m_destTile && ((m_destTrackdirs & TrackdirToTrackdirBits(trackdir)) != TRACKDIR_BIT_NONE);
 	}
 
+	/** Called by the road cost calculation to check whether a cached segment may pass the destination */
+	inline bool PfDetectDestinationInArea(const TileArea &area)
+	{
+		/* cached segments never contain road stops */
+		if (m_dest_station != INVALID_STATION) return false;
+
+		return area.Contains(m_destTile);
+	}
+
 	/**
 	 * Called by YAPF to calculate cost estimate. Calculates distance to the destination
 	 *  adds it to the actual cost from origin and stores the sum to the Node::m_estimate
@@ -469,7 +634,7 @@ struct CYapfRoad_TypesT
 	typedef CYapfFollowRoadT<Types>           PfFollow;
 	typedef CYapfOriginTileT<Types>           PfOrigin;
 	typedef Tdestination<Types>               PfDestination;
-	typedef CYapfSegmentCostCacheNoneT<Types> PfCache;
+	typedef CYapfRoadSegmentCacheT<Types>     PfCache;
 	typedef CYapfCostRoadT<Types>             PfCost;
 };
 
@@ -517,3 +682,20 @@ FindDepotData YapfRoadVehicleFindNearestDepot(const RoadVehicle *v, int max_dist
 	fdd.best_length = ret ? max_distance / 2 : UINT_MAX; // some fake distance or NOT_FOUND
 	return fdd;
 }
+
+void YapfNotifyRoadLayoutChange(TileIndex tile)
+{
+	if (tile == INVALID_TILE || _road_layout_regions_map_size != MapSize()) {
+		FlushRoadSegmentCache();
+		return;
+	}
+
+	/* segments cached with the stamp handed out before this change become outdated */
+	_road_layout_stamp++;
+	if (_road_layout_stamp == UINT32_MAX) {
+		FlushRoadSegmentCache();
+		return;
+	}
+	uint regions_x = MapSizeX() >> ROAD_LAYOUT_REGION_BITS;
+	_road_layout_region_stamps[(TileY(tile) >> ROAD_LAYOUT_REGION_BITS) * regions_x + (TileX(tile) >> ROAD_LAYOUT_REGION_BITS)] = _road_layout_stamp;
+}
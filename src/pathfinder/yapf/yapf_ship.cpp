@@ -12,11 +12,293 @@
 #include "../../stdafx.h"
 #include "../../ship.h"
 
+#include "../../bridge_map.h"
+#include "../../tunnelbridge_map.h"
+#include "../../core/alloc_func.hpp"
+
 #include "yapf.hpp"
 #include "yapf_node_ship.hpp"
 
+#include <map>
+#include <set>
+#include <queue>
+
 #include "../../safeguards.h"
 
+static const uint WATER_REGION_BITS  = 4;                                     ///< Size of the square water regions, as a power of 2.
+static const uint WATER_REGION_SIZE  = 1 << WATER_REGION_BITS;                ///< Edge length of a water region.
+static const uint WATER_REGION_TILES = WATER_REGION_SIZE * WATER_REGION_SIZE; ///< Number of tiles within a water region.
+static const uint WATER_PATCH_MAX_SEARCH = 1 << 14;                           ///< Number of patches the high level search may expand before giving up.
+static const uint32 INVALID_WATER_PATCH = UINT32_MAX;                         ///< Patch of tiles ships cannot use.
+
+/**
+ * Connectivity of the water tiles within a square region of the map.
+ * Tiles ships can move between without leaving the region share a patch. Patches
+ * are identified by (region index << 8 | patch number); the patches of adjacent
+ * regions and of both ends of an aqueduct form the graph ship routes are planned on.
+ */
+struct WaterRegion {
+	bool valid;                          ///< Whether the patches still match the map.
+	bool has_aqueducts;                  ///< Whether an aqueduct ramp lies within the region.
+	byte num_patches;                    ///< Number of patches within the region.
+	byte patch[WATER_REGION_TILES];      ///< Patch of each tile, 0 when ships cannot use the tile.
+	byte edges[WATER_REGION_TILES];      ///< Tile edges touched by water tracks, one bit per DiagDirection.
+};
+
+typedef std::set<uint32> WaterCorridor; ///< Patches the detailed ship search is limited to.
+
+/** Outcome of planning a ship route on the water region graph. */
+enum WaterRouteResult {
+	WRR_FOUND,       ///< A route exists, the corridor holds the patches around it.
+	WRR_UNREACHABLE, ///< The destination is not connected to the origin at all.
+	WRR_UNKNOWN,     ///< The region graph cannot tell, search without restrictions.
+};
+
+static WaterRegion *_water_regions;          ///< Water regions of the map, computed when first used by a ship.
+static uint         _water_regions_map_size; ///< Map size #_water_regions has been allocated for.
+
+/** Forget all water regions, e.g. because another map has been loaded. */
+static void FlushWaterRegions()
+{
+	free(_water_regions);
+	_water_regions = CallocT<WaterRegion>(MapSize() >> (2 * WATER_REGION_BITS));
+	_water_regions_map_size = MapSize();
+}
+
+/**
+ * Get the index of the water region a tile lies in.
+ * @param tile The tile.
+ * @return The water region index.
+ */
+static inline uint GetWaterRegionIndex(TileIndex tile)
+{
+	return (TileY(tile) >> WATER_REGION_BITS) * (MapSizeX() >> WATER_REGION_BITS) + (TileX(tile) >> WATER_REGION_BITS);
+}
+
+/**
+ * Get the position of a tile within its water region.
+ * @param tile The tile.
+ * @return Index into the per tile arrays of the water region.
+ */
+static inline uint GetWaterRegionTileIndex(TileIndex tile)
+{
+	return (TileY(tile) & (WATER_REGION_SIZE - 1)) * WATER_REGION_SIZE + (TileX(tile) & (WATER_REGION_SIZE - 1));
+}
+
+/**
+ * Get the tile at a position within a water region.
+ * @param index The water region index.
+ * @param i The position within the water region.
+ * @return The tile.
+ */
+static inline TileIndex GetWaterRegionTile(uint index, uint i)
+{
+	uint regions_x = MapSizeX() >> WATER_REGION_BITS;
+	return TileXY((index % regions_x) * WATER_REGION_SIZE + i % WATER_REGION_SIZE, (index / regions_x) * WATER_REGION_SIZE + i / WATER_REGION_SIZE);
+}
+
+/**
+ * Recompute the patches of a water region from the map.
+ * @param region The water region to update.
+ * @param index The index of the water region.
+ */
+static void UpdateWaterRegion(WaterRegion &region, uint index)
+{
+	region.has_aqueducts = false;
+	for (uint i = 0; i < WATER_REGION_TILES; i++) {
+		TileIndex tile = GetWaterRegionTile(index, i);
+		TrackBits tracks = TrackStatusToTrackBits(GetTileTrackStatus(tile, TRANSPORT_WATER, 0));
+
+		byte edges = 0;
+		for (DiagDirection side = DIAGDIR_BEGIN; side < DIAGDIR_END; side++) {
+			if ((tracks & DiagdirReachesTracks(ReverseDiagDir(side))) != TRACK_BIT_NONE) SetBit(edges, side);
+		}
+		region.edges[i] = edges;
+		region.patch[i] = 0;
+
+		if (IsTileType(tile, MP_TUNNELBRIDGE) && GetTunnelBridgeTransportType(tile) == TRANSPORT_WATER) region.has_aqueducts = true;
+	}
+
+	/* Flood fill the tiles connected via shared tile edges within the region. */
+	byte stack[WATER_REGION_TILES];
+	region.num_patches = 0;
+	for (uint i = 0; i < WATER_REGION_TILES; i++) {
+		if (region.edges[i] == 0 || region.patch[i] != 0) continue;
+
+		region.patch[i] = ++region.num_patches;
+		uint depth = 0;
+		stack[depth++] = i;
+		while (depth > 0) {
+			uint cur = stack[--depth];
+			for (DiagDirection side = DIAGDIR_BEGIN; side < DIAGDIR_END; side++) {
+				if (!HasBit(region.edges[cur], side)) continue;
+
+				TileIndexDiffC diff = TileIndexDiffCByDiagDir(side);
+				int x = (int)(cur % WATER_REGION_SIZE) + diff.x;
+				int y = (int)(cur / WATER_REGION_SIZE) + diff.y;
+				if (x < 0 || y < 0 || x >= (int)WATER_REGION_SIZE || y >= (int)WATER_REGION_SIZE) continue;
+
+				uint next = y * WATER_REGION_SIZE + x;
+				if (region.patch[next] != 0 || !HasBit(region.edges[next], ReverseDiagDir(side))) continue;
+
+				region.patch[next] = region.num_patches;
+				stack[depth++] = next;
+			}
+		}
+	}
+
+	region.valid = true;
+}
+
+/**
+ * Get a water region, updating it when the map changed since it has been computed.
+ * @param index The water region index.
+ * @return The water region.
+ */
+static const WaterRegion &GetWaterRegion(uint index)
+{
+	WaterRegion &region = _water_regions[index];
+	if (!region.valid) UpdateWaterRegion(region, index);
+	return region;
+}
+
+/**
+ * Get the water patch a tile belongs to.
+ * @param tile The tile.
+ * @return The patch, or #INVALID_WATER_PATCH when ships cannot use the tile.
+ */
+static uint32 GetWaterPatch(TileIndex tile)
+{
+	uint index = GetWaterRegionIndex(tile);
+	byte patch = GetWaterRegion(index).patch[GetWaterRegionTileIndex(tile)];
+	return patch == 0 ? INVALID_WATER_PATCH : (index << 8) | patch;
+}
+
+/**
+ * Get the patches ships can move to from a water patch.
+ * @param patch The patch to get the neighbours of.
+ * @param[out] neighbours The neighbouring patches.
+ */
+static void GetWaterPatchNeighbours(uint32 patch, SmallVector<uint32, 16> &neighbours)
+{
+	uint index = patch >> 8;
+	byte number = GB(patch, 0, 8);
+	const WaterRegion &region = GetWaterRegion(index);
+
+	neighbours.Clear();
+	for (uint i = 0; i < WATER_REGION_TILES; i++) {
+		if (region.patch[i] != number) continue;
+
+		TileIndex tile = GetWaterRegionTile(index, i);
+		for (DiagDirection side = DIAGDIR_BEGIN; side < DIAGDIR_END; side++) {
+			if (!HasBit(region.edges[i], side)) continue;
+
+			/* Only edges leaving the region lead to other patches. */
+			TileIndexDiffC diff = TileIndexDiffCByDiagDir(side);
+			int x = (int)(i % WATER_REGION_SIZE) + diff.x;
+			int y = (int)(i / WATER_REGION_SIZE) + diff.y;
+			if (x >= 0 && y >= 0 && x < (int)WATER_REGION_SIZE && y < (int)WATER_REGION_SIZE) continue;
+
+			int tx = (int)TileX(tile) + diff.x;
+			int ty = (int)TileY(tile) + diff.y;
+			if (tx < 0 || ty < 0 || tx >= (int)MapSizeX() || ty >= (int)MapSizeY()) continue;
+
+			TileIndex next = TileXY(tx, ty);
+			uint next_index = GetWaterRegionIndex(next);
+			const WaterRegion &next_region = GetWaterRegion(next_index);
+			uint j = GetWaterRegionTileIndex(next);
+			if (!HasBit(next_region.edges[j], ReverseDiagDir(side))) continue;
+
+			neighbours.Include((next_index << 8) | next_region.patch[j]);
+		}
+
+		if (region.has_aqueducts && IsTileType(tile, MP_TUNNELBRIDGE) && GetTunnelBridgeTransportType(tile) == TRANSPORT_WATER) {
+			uint32 other = GetWaterPatch(GetOtherBridgeEnd(tile));
+			if (other != INVALID_WATER_PATCH) neighbours.Include(other);
+		}
+	}
+}
+
+/**
+ * Estimate the number of patches between a patch and the destination region.
+ * @param patch The patch.
+ * @param goal_x X coordinate of the destination region.
+ * @param goal_y Y coordinate of the destination region.
+ * @return The Manhattan distance in regions.
+ */
+static inline int EstimateWaterPatchDistance(uint32 patch, uint goal_x, uint goal_y)
+{
+	uint regions_x = MapSizeX() >> WATER_REGION_BITS;
+	return Delta((patch >> 8) % regions_x, goal_x) + Delta((patch >> 8) / regions_x, goal_y);
+}
+
+/**
+ * Plan a ship route on the water region graph.
+ * The regions only know which tiles touch each other, so the route can be found
+ * much cheaper than by the detailed search. When a route exists, the corridor is
+ * filled with the patches along it and the patches next to those, which limits
+ * the detailed search to the surroundings of the route.
+ * @param origin The tile the ship starts from.
+ * @param destination The tile the ship is heading to.
+ * @param[out] corridor The patches the detailed search may use.
+ * @return Whether the destination can be reached.
+ */
+static WaterRouteResult FindWaterRoute(TileIndex origin, TileIndex destination, WaterCorridor &corridor)
+{
+	if (_water_regions_map_size != MapSize()) FlushWaterRegions();
+	if (origin >= MapSize() || destination >= MapSize()) return WRR_UNKNOWN;
+
+	uint32 start = GetWaterPatch(origin);
+	uint32 goal = GetWaterPatch(destination);
+	if (start == INVALID_WATER_PATCH || goal == INVALID_WATER_PATCH) return WRR_UNKNOWN;
+
+	uint goal_x = TileX(destination) >> WATER_REGION_BITS;
+	uint goal_y = TileY(destination) >> WATER_REGION_BITS;
+
+	/* Plain A* with unit cost per patch; the open list holds (-estimate, patch). */
+	typedef std::map<uint32, std::pair<uint32, int> > SeenMap; // patch -> (parent, cost)
+	SeenMap seen;
+	std::priority_queue<std::pair<int, uint32> > open;
+	SmallVector<uint32, 16> neighbours;
+
+	seen[start] = std::make_pair(start, 0);
+	open.push(std::make_pair(-EstimateWaterPatchDistance(start, goal_x, goal_y), start));
+
+	uint expanded = 0;
+	while (!open.empty()) {
+		uint32 patch = open.top().second;
+		int estimate = -open.top().first;
+		open.pop();
+
+		int cost = seen[patch].second;
+		if (estimate > cost + EstimateWaterPatchDistance(patch, goal_x, goal_y)) continue; // outdated entry
+
+		if (patch == goal) {
+			for (;;) {
+				corridor.insert(patch);
+				GetWaterPatchNeighbours(patch, neighbours);
+				corridor.insert(neighbours.Begin(), neighbours.End());
+				if (patch == start) break;
+				patch = seen[patch].first;
+			}
+			return WRR_FOUND;
+		}
+
+		if (++expanded > WATER_PATCH_MAX_SEARCH) return WRR_UNKNOWN;
+
+		GetWaterPatchNeighbours(patch, neighbours);
+		for (const uint32 *it = neighbours.Begin(); it != neighbours.End(); it++) {
+			SeenMap::iterator s = seen.find(*it);
+			if (s != seen.end() && s->second.second <= cost + 1) continue;
+
+			seen[*it] = std::make_pair(patch, cost + 1);
+			open.push(std::make_pair(-(cost + 1 + EstimateWaterPatchDistance(*it, goal_x, goal_y)), *it));
+		}
+	}
+
+	return WRR_UNREACHABLE;
+}
+
 /** Node Follower module of YAPF for ships */
 template <class Types>
 class CYapfFollowShipT
@@ -28,6 +310,8 @@ public:
 	typedef typename Node::Key Key;                      ///< key to hash tables
 
 protected:
+	const WaterCorridor *m_corridor; ///< patches the search is limited to, NULL when unrestricted
+
 	/** to access inherited path finder */
 	inline Tpf& Yapf()
 	{
@@ -35,6 +319,8 @@ protected:
 	}
 
 public:
+	CYapfFollowShipT() : m_corridor(NULL) {}
+
 	/**
 	 * Called by YAPF to move from the given node to the next tile. For each
 	 *  reachable trackdir on the new tile creates new node, initializes it
@@ -44,6 +330,7 @@ public:
 	{
 		TrackFollower F(Yapf().GetVehicle());
 		if (F.Follow(old_node.m_key.m_tile, old_node.m_key.m_td)) {
+			if (m_corridor != NULL && m_corridor->count(GetWaterPatch(F.m_new_tile)) == 0) return;
 			Yapf().AddMultipleNodes(&old_node, F);
 		}
 	}
@@ -54,38 +341,51 @@ public:
 		return 'w';
 	}
 
-	static Trackdir ChooseShipTrack(const Ship *v, TileIndex tile, DiagDirection enterdir, TrackBits tracks, bool &path_found)
+	/**
+	 * Choose the trackdir a ship takes when it does not need to search for a path.
+	 * @param v Ship
+	 * @param enterdir Direction the ship enters the next tile
+	 * @param tracks Tracks available on the next tile
+	 * @return The ship's current trackdir if possible, otherwise the first usable one
+	 */
+	static Trackdir GetPreferredShipTrackdir(const Ship *v, DiagDirection enterdir, TrackBits tracks)
 	{
-		/* handle special case - when next tile is destination tile */
-		if (tile == v->dest_tile) {
-			/* convert tracks to trackdirs */
-			TrackdirBits trackdirs = (TrackdirBits)(tracks | ((int)tracks << 8));
-			/* limit to trackdirs reachable from enterdir */
-			trackdirs &= DiagdirReachesTrackdirs(enterdir);
-
-			/* use vehicle's current direction if that's possible, otherwise use first usable one. */
-			Trackdir veh_dir = v->GetVehicleTrackdir();
-			return ((trackdirs & TrackdirToTrackdirBits(veh_dir)) != 0) ? veh_dir : (Trackdir)FindFirstBit2x64(trackdirs);
-		}
-
-		/* move back to the old tile/trackdir (where ship is coming from) */
-		TileIndex src_tile = TILE_ADD(tile, TileOffsByDiagDir(ReverseDiagDir(enterdir)));
-		Trackdir trackdir = v->GetVehicleTrackdir();
-		assert(IsValidTrackdir(trackdir));
+		/* convert tracks to trackdirs */
+		TrackdirBits trackdirs = (TrackdirBits)(tracks | ((int)tracks << 8));
+		/* limit to trackdirs reachable from enterdir */
+		trackdirs &= DiagdirReachesTrackdirs(enterdir);
+
+		/* use vehicle's current direction if that's possible, otherwise use first usable one. */
+		Trackdir veh_dir = v->GetVehicleTrackdir();
+		return ((trackdirs & TrackdirToTrackdirBits(veh_dir)) != 0) ? veh_dir : (Trackdir)FindFirstBit2x64(trackdirs);
+	}
 
-		/* convert origin trackdir to TrackdirBits */
-		TrackdirBits trackdirs = TrackdirToTrackdirBits(trackdir);
+	/**
+	 * Run the detailed search and return the first trackdir of the found path.
+	 * @param v Ship
+	 * @param tile Tile the ship is about to enter
+	 * @param src_tile Tile the ship is coming from
+	 * @param trackdirs Trackdirs to start from
+	 * @param corridor Patches the search is limited to, or NULL
+	 * @param[out] path_found Whether a path to the destination has been found
+	 * @return The trackdir to take on \a tile, or INVALID_TRACKDIR
+	 */
+	static Trackdir FindShipTrackdir(const Ship *v, TileIndex tile, TileIndex src_tile, TrackdirBits trackdirs, const WaterCorridor *corridor, bool &path_found)
+	{
 		/* get available trackdirs on the destination tile */
 		TrackdirBits dest_trackdirs = TrackStatusToTrackdirBits(GetTileTrackStatus(v->dest_tile, TRANSPORT_WATER, 0));
 
 		/* create pathfinder instance */
 		Tpf pf;
+		pf.m_corridor = corridor;
 		/* set origin and destination nodes */
 		pf.SetOrigin(src_tile, trackdirs);
 		pf.SetDestination(v->dest_tile, dest_trackdirs);
 		/* find best path */
 		path_found = pf.FindPath(v);
 
+		DEBUG(yapf, 3, "[YAPFw] ship %d: %d nodes expanded%s", v->unitnumber, pf.m_nodes.ClosedCount(), corridor != NULL ? " within water region corridor" : "");
+
 		Trackdir next_trackdir = INVALID_TRACKDIR; // this would mean "path not found"
 
 		Node *pNode = pf.GetBestNode();
@@ -104,27 +404,65 @@ public:
 		return next_trackdir;
 	}
 
+	static Trackdir ChooseShipTrack(const Ship *v, TileIndex tile, DiagDirection enterdir, TrackBits tracks, bool &path_found)
+	{
+		/* handle special case - when next tile is destination tile */
+		if (tile == v->dest_tile) return GetPreferredShipTrackdir(v, enterdir, tracks);
+
+		/* move back to the old tile/trackdir (where ship is coming from) */
+		TileIndex src_tile = TILE_ADD(tile, TileOffsByDiagDir(ReverseDiagDir(enterdir)));
+		Trackdir trackdir = v->GetVehicleTrackdir();
+		assert(IsValidTrackdir(trackdir));
+
+		/* plan the route on the water regions first */
+		WaterCorridor corridor;
+		switch (FindWaterRoute(src_tile, v->dest_tile, corridor)) {
+			case WRR_UNREACHABLE:
+				/* the ship is lost; do not search its whole body of water on every junction */
+				DEBUG(yapf, 3, "[YAPFw] ship %d: destination not connected to its water region", v->unitnumber);
+				path_found = false;
+				return GetPreferredShipTrackdir(v, enterdir, tracks);
+
+			case WRR_FOUND: {
+				Trackdir next_trackdir = FindShipTrackdir(v, tile, src_tile, TrackdirToTrackdirBits(trackdir), &corridor, path_found);
+				if (path_found) return next_trackdir;
+				/* the regions only approximate the ship's movement; retry without them */
+				break;
+			}
+
+			default: break;
+		}
+
+		return FindShipTrackdir(v, tile, src_tile, TrackdirToTrackdirBits(trackdir), NULL, path_found);
+	}
+
 	/**
-	 * Check whether a ship should reverse to reach its destination.
-	 * Called when leaving depot.
+	 * Find the better of two trackdirs to start from.
 	 * @param v Ship
 	 * @param tile Current position
 	 * @param td1 Forward direction
 	 * @param td2 Reverse direction
-	 * @return true if the reverse direction is better
+	 * @param corridor Patches the search is limited to, or NULL
+	 * @param[out] reverse Whether the reverse direction is better
+	 * @return Whether a path has been found
 	 */
-	static bool CheckShipReverse(const Ship *v, TileIndex tile, Trackdir td1, Trackdir td2)
+	static bool FindShipReverse(const Ship *v, TileIndex tile, Trackdir td1, Trackdir td2, const WaterCorridor *corridor, bool &reverse)
 	{
 		/* get available trackdirs on the destination tile */
 		TrackdirBits dest_trackdirs = TrackStatusToTrackdirBits(GetTileTrackStatus(v->dest_tile, TRANSPORT_WATER, 0));
 
 		/* create pathfinder instance */
 		Tpf pf;
+		pf.m_corridor = corridor;
 		/* set origin and destination nodes */
 		pf.SetOrigin(tile, TrackdirToTrackdirBits(td1) | TrackdirToTrackdirBits(td2));
 		pf.SetDestination(v->dest_tile, dest_trackdirs);
 		/* find best path */
-		if (!pf.FindPath(v)) return false;
+		bool path_found = pf.FindPath(v);
+
+		DEBUG(yapf, 3, "[YAPFw] ship %d: %d nodes expanded%s", v->unitnumber, pf.m_nodes.ClosedCount(), corridor != NULL ? " within water region corridor" : "");
+
+		if (!path_found) return false;
 
 		Node *pNode = pf.GetBestNode();
 		if (pNode == NULL) return false;
@@ -137,7 +475,36 @@ public:
 
 		Trackdir best_trackdir = pNode->GetTrackdir();
 		assert(best_trackdir == td1 || best_trackdir == td2);
-		return best_trackdir == td2;
+		reverse = best_trackdir == td2;
+		return true;
+	}
+
+	/**
+	 * Check whether a ship should reverse to reach its destination.
+	 * Called when leaving depot.
+	 * @param v Ship
+	 * @param tile Current position
+	 * @param td1 Forward direction
+	 * @param td2 Reverse direction
+	 * @return true if the reverse direction is better
+	 */
+	static bool CheckShipReverse(const Ship *v, TileIndex tile, Trackdir td1, Trackdir td2)
+	{
+		bool reverse = false;
+
+		WaterCorridor corridor;
+		switch (FindWaterRoute(tile, v->dest_tile, corridor)) {
+			case WRR_UNREACHABLE: return false;
+
+			case WRR_FOUND:
+				if (FindShipReverse(v, tile, td1, td2, &corridor, reverse)) return reverse;
+				break;
+
+			default: break;
+		}
+
+		FindShipReverse(v, tile, td1, td2, NULL, reverse);
+		return reverse;
 	}
 };
 
@@ -259,3 +626,13 @@ bool YapfShipCheckReverse(const Ship *v)
 
 	return reverse;
 }
+
+void YapfNotifyWaterLayoutChange(TileIndex tile)
+{
+	if (tile == INVALID_TILE || _water_regions_map_size != MapSize()) {
+		FlushWaterRegions();
+		return;
+	}
+
+	_water_regions[GetWaterRegionIndex(tile)].valid = false;
+}
@@ -0,0 +1,285 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file replay.cpp Headless benchmark that replays a savegame and a command log. */
+
+#include "stdafx.h"
+#include "replay.h"
+#include "openttd.h"
+#include "fios.h"
+#include "fileio_func.h"
+#include "command_func.h"
+#include "company_func.h"
+#include "date_func.h"
+#include "string_func.h"
+#include "sync_checksum.h"
+#include "core/random_func.hpp"
+
+#include "safeguards.h"
+
+ReplayBenchmark _replay;              ///< State of the replay benchmark.
+GameLoopTimings _game_loop_timings;   ///< Timings of the state game loop.
+
+/** Names of the game loop phases, as shown in the report. */
+static const char * const _game_loop_phase_names[] = {
+	"commands",
+	"check caches",
+	"animation",
+	"date",
+	"tile loop",
+	"vehicles",
+	"landscape",
+	"scripts",
+	"windows",
+};
+assert_compile(lengthof(_game_loop_phase_names) == GLP_END);
+
+/**
+ * Reader of a command log as written with '-d desync=1'.
+ * Only the executed commands and the sync states are of interest; all other entries are skipped.
+ */
+struct CommandLogReader {
+	FILE *f;                ///< The command log, or \c NULL when there is none.
+	bool pending;           ///< Whether there is an entry waiting for its date.
+	bool is_sync;           ///< Whether the pending entry is a sync state instead of a command.
+	Date date;              ///< Date of the pending entry.
+	uint32 date_fract;      ///< Date fraction of the pending entry.
+	CompanyID company;      ///< Company executing the pending command.
+	CommandContainer cmd;   ///< The pending command.
+	uint32 sync_state[2];   ///< The pending sync state.
+
+	uint executed;          ///< Number of executed commands.
+	uint failed;            ///< Number of executed commands that failed.
+	uint skipped;           ///< Number of entries that were only read after their date had passed.
+	uint sync_checks;       ///< Number of checked sync states.
+	uint sync_mismatches;   ///< Number of sync states that did not match.
+
+	CommandLogReader() : f(NULL), pending(false), executed(0), failed(0), skipped(0), sync_checks(0), sync_mismatches(0) {}
+
+	~CommandLogReader()
+	{
+		if (this->f != NULL) fclose(this->f);
+	}
+
+	/**
+	 * Open the command log and read its first entry.
+	 * @param filename The command log to open.
+	 * @return Whether the command log could be opened.
+	 */
+	bool Open(const char *filename)
+	{
+		this->f = FioFOpenFile(filename, "rb", SAVE_DIR);
+		if (this->f == NULL) return false;
+
+		this->pending = this->ReadNext();
+		return true;
+	}
+
+	/**
+	 * Read the next command or sync state from the log.
+	 * @return Whether an entry has been read.
+	 */
+	bool ReadNext()
+	{
+		char buff[4096];
+		while (fgets(buff, lengthof(buff), this->f) != NULL) {
+			char *p = buff;
+			/* Ignore the "[date time] " part of the message */
+			if (*p == '[') {
+				p = strchr(p, ']');
+				if (p == NULL) continue;
+				p += 2;
+			}
+
+			if (strncmp(p, "cmd: ", 5) == 0) {
+				uint32 date, company;
+				char text[lengthof(buff)];
+				text[0] = '\0';
+				memset(&this->cmd, 0, sizeof(this->cmd));
+				int ret = sscanf(p + 5, "%x; %x; %x; %x; %x; %x; %x; \"%[^\"]\"", &date, &this->date_fract, &company, &this->cmd.tile, &this->cmd.p1, &this->cmd.p2, &this->cmd.cmd, text);
+				/* The text is optional, as most commands do not use it. */
+				if (ret != 8 && ret != 7) {
+					DEBUG(misc, 0, "[replay] Cannot parse: %s", p);
+					continue;
+				}
+				strecpy(this->cmd.text, text, lastof(this->cmd.text));
+				this->date = (Date)date;
+				this->company = (CompanyID)company;
+				this->is_sync = false;
+				return true;
+			}
+
+			if (strncmp(p, "sync: ", 6) == 0) {
+				uint32 date;
+				int ret = sscanf(p + 6, "%x; %x; %x; %x", &date, &this->date_fract, &this->sync_state[0], &this->sync_state[1]);
+				if (ret != 4) {
+					DEBUG(misc, 0, "[replay] Cannot parse: %s", p);
+					continue;
+				}
+				this->date = (Date)date;
+				this->is_sync = true;
+				return true;
+			}
+
+			/* Messages, joins, loads, saves and failed commands do not change the game state. */
+		}
+
+		return false;
+	}
+
+	/** Execute all entries of the command log that are due at the current date. */
+	void Execute()
+	{
+		while (this->pending) {
+			if (_date < this->date || (_date == this->date && _date_fract < this->date_fract)) break;
+
+			if (_date != this->date || _date_fract != this->date_fract) {
+				DEBUG(misc, 1, "[replay] Skipping entry of %08x; %02x at %08x; %02x", this->date, this->date_fract, _date, _date_fract);
+				this->skipped++;
+			} else if (this->is_sync) {
+				this->sync_checks++;
+				if (this->sync_state[0] != _random.state[0] || this->sync_state[1] != _random.state[1]) {
+					DEBUG(misc, 0, "[replay] Sync mismatch at %08x; %02x: expected {%08x, %08x}, got {%08x, %08x}",
+							_date, _date_fract, this->sync_state[0], this->sync_state[1], _random.state[0], _random.state[1]);
+					this->sync_mismatches++;
+				}
+			} else {
+				_current_company = this->company;
+				this->cmd.cmd |= CMD_NETWORK_COMMAND;
+				if (!DoCommandP(&this->cmd, false)) this->failed++;
+				this->executed++;
+				_current_company = _local_company;
+			}
+
+			this->pending = this->ReadNext();
+		}
+	}
+};
+
+/**
+ * Parse the argument of the replay benchmark and enable it.
+ * @param arg The argument in the form "savegame,commandlog,ticks"; the command log may be empty.
+ * @param savegame Buffer for the filename of the savegame.
+ * @param last Last element of the \a savegame buffer.
+ * @return Whether the argument is valid.
+ */
+bool ParseReplayBenchmark(const char *arg, char *savegame, const char *last)
+{
+	if (StrEmpty(arg)) return false;
+
+	char buf[MAX_PATH * 2];
+	strecpy(buf, arg, lastof(buf));
+
+	char *ticks = strrchr(buf, ',');
+	if (ticks == NULL) return false;
+	*ticks++ = '\0';
+
+	char *log = strrchr(buf, ',');
+	if (log == NULL) return false;
+	*log++ = '\0';
+
+	if (StrEmpty(buf) || atoi(ticks) <= 0) return false;
+
+	strecpy(savegame, buf, last);
+	strecpy(_replay.command_log, log, lastof(_replay.command_log));
+	_replay.replay_commands = !StrEmpty(log);
+	_replay.ticks = atoi(ticks);
+	_replay.active = true;
+	return true;
+}
+
+/**
+ * Mix a value into a checksum.
+ * @param checksum The checksum so far.
+ * @param value The value to add.
+ * @return The new checksum.
+ */
+static inline uint32 MixChecksum(uint32 checksum, uint32 value)
+{
+	return (checksum ^ value) * 16777619;
+}
+
+/**
+ * Calculate a checksum over the game state, so two runs of the benchmark can
+ * be compared for determinism. It combines the random state and the date with
+ * the checksums of the parts of the game state that sync checks compare.
+ * @param checksums The array to write the checksums of the parts to, to show where two runs differ.
+ * @return The checksum.
+ */
+static uint32 CalculateStateChecksum(uint32 checksums[SCS_END])
+{
+	CalculateSyncChecksums(checksums);
+
+	uint32 checksum = 2166136261U;
+	checksum = MixChecksum(checksum, _random.state[0]);
+	checksum = MixChecksum(checksum, _random.state[1]);
+	checksum = MixChecksum(checksum, _date);
+	checksum = MixChecksum(checksum, _date_fract);
+	for (uint i = 0; i < SCS_END; i++) checksum = MixChecksum(checksum, checksums[i]);
+	return checksum;
+}
+
+/**
+ * Load the savegame, run the requested number of ticks as fast as possible
+ * while replaying the command log, and report the timings.
+ */
+void RunReplayBenchmark()
+{
+	extern void StateGameLoop();
+
+	/* Loading the savegame normally happens in the first game loop. */
+	if (_switch_mode != SM_NONE) {
+		SwitchToMode(_switch_mode);
+		_switch_mode = SM_NONE;
+	}
+
+	if (_game_mode != GM_NORMAL) {
+		ShowInfoF("replay: cannot load savegame '%s'", _file_to_saveload.name);
+		return;
+	}
+
+	CommandLogReader reader;
+	if (_replay.replay_commands && !reader.Open(_replay.command_log)) {
+		ShowInfoF("replay: cannot open command log '%s'", _replay.command_log);
+		return;
+	}
+
+	memset(_game_loop_timings.phase_time, 0, sizeof(_game_loop_timings.phase_time));
+	_game_loop_timings.max_tick_time = 0;
+
+	uint64 start = GetPerformanceTimer();
+	for (uint i = 0; i < _replay.ticks; i++) {
+		/* The tick starts before the commands; the state game loop continues it. */
+		StartGameLoopPhases();
+		reader.Execute();
+		EndGameLoopPhase(GLP_COMMANDS);
+
+		StateGameLoop();
+		/* A paused game does not run the state game loop, which would end the tick. */
+		if (_game_loop_timings.in_tick) EndGameLoopPhases();
+	}
+	uint64 elapsed = max<uint64>(GetPerformanceTimer() - start, 1);
+
+	ShowInfoF("replay: %u ticks in " OTTD_PRINTF64 " ms, " OTTD_PRINTF64 " ticks/s", _replay.ticks, elapsed / 1000, (uint64)_replay.ticks * 1000000 / elapsed);
+	ShowInfoF("replay: slowest tick took " OTTD_PRINTF64 " us", _game_loop_timings.max_tick_time);
+	for (uint i = 0; i < GLP_END; i++) {
+		uint64 time = _game_loop_timings.phase_time[i];
+		ShowInfoF("replay:   %-12s " OTTD_PRINTF64 " ms (" OTTD_PRINTF64 "%%)", _game_loop_phase_names[i], time / 1000, time * 100 / elapsed);
+	}
+	if (_replay.replay_commands) {
+		ShowInfoF("replay: %u commands executed, %u failed, %u entries skipped, %u of %u sync checks mismatched",
+				reader.executed, reader.failed, reader.skipped, reader.sync_mismatches, reader.sync_checks);
+	}
+	uint32 checksums[SCS_END];
+	uint32 checksum = CalculateStateChecksum(checksums);
+	ShowInfoF("replay: final date %08x; %02x, state checksum %08x", _date, _date_fract, checksum);
+	for (uint i = 0; i < SCS_END; i++) {
+		ShowInfoF("replay:   %-13s checksum %08x", GetSyncChecksumName((SyncChecksumSubsystem)i), checksums[i]);
+	}
+}
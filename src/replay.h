@@ -0,0 +1,86 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file replay.h Headless benchmark that replays a savegame and a command log. */
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "debug.h"
+#include "core/math_func.hpp"
+
+/** Parts of the state game loop that are timed separately, for the replay benchmark and the admin port. */
+enum GameLoopPhase {
+	GLP_COMMANDS,     ///< Executing the commands of the command log.
+	GLP_CHECK_CACHES, ///< Checking the caches against their sources.
+	GLP_ANIMATION,    ///< Animating the animated tiles.
+	GLP_DATE,         ///< Increasing the date, including the daily/monthly/yearly loops.
+	GLP_TILE_LOOP,    ///< The tile loop.
+	GLP_VEHICLES,     ///< Vehicle ticks.
+	GLP_LANDSCAPE,    ///< Landscape ticks.
+	GLP_SCRIPTS,      ///< AI and game scripts.
+	GLP_WINDOWS,      ///< Window ticks and news.
+	GLP_END,          ///< End marker.
+};
+
+/** State of the replay benchmark. */
+struct ReplayBenchmark {
+	bool active;                  ///< Whether the benchmark runs instead of the normal main loop.
+	bool replay_commands;         ///< Whether commands come from a command log; scripts are not run then.
+	uint ticks;                   ///< Number of ticks to run.
+	char command_log[MAX_PATH];   ///< Filename of the command log.
+};
+
+/** Timings of the state game loop; all times are in microseconds. */
+struct GameLoopTimings {
+	uint64 tick_start;            ///< Time the current tick started.
+	uint64 phase_start;           ///< Time the current phase started.
+	uint64 phase_time[GLP_END];   ///< Time spent in each of the phases.
+	uint64 last_tick_time;        ///< Time spent in the last completed tick.
+	uint64 max_tick_time;         ///< Time spent in the slowest completed tick.
+	uint64 ticks;                 ///< Number of timed ticks.
+	bool in_tick;                 ///< Whether a tick has been started, but not finished yet.
+};
+
+extern ReplayBenchmark _replay;
+extern GameLoopTimings _game_loop_timings;
+
+bool ParseReplayBenchmark(const char *arg, char *savegame, const char *last);
+void RunReplayBenchmark();
+
+/** Start timing the phases of a game loop tick, unless the tick has been started already. */
+static inline void StartGameLoopPhases()
+{
+	if (_game_loop_timings.in_tick) return;
+	_game_loop_timings.in_tick = true;
+	_game_loop_timings.phase_start = GetPerformanceTimer();
+	_game_loop_timings.tick_start = _game_loop_timings.phase_start;
+}
+
+/**
+ * Attribute the time since the previous phase ended to the given phase.
+ * @param phase The phase that just ended.
+ */
+static inline void EndGameLoopPhase(GameLoopPhase phase)
+{
+	uint64 now = GetPerformanceTimer();
+	_game_loop_timings.phase_time[phase] += now - _game_loop_timings.phase_start;
+	_game_loop_timings.phase_start = now;
+}
+
+/** Finish timing a game loop tick, after its last phase ended. */
+static inline void EndGameLoopPhases()
+{
+	_game_loop_timings.last_tick_time = _game_loop_timings.phase_start - _game_loop_timings.tick_start;
+	_game_loop_timings.max_tick_time = max(_game_loop_timings.max_tick_time, _game_loop_timings.last_tick_time);
+	_game_loop_timings.ticks++;
+	_game_loop_timings.in_tick = false;
+}
+
+#endif /* REPLAY_H */
@@ -378,15 +378,16 @@ void RoadStop::Entry::Rebuild(const RoadStop *rs, int side)
 /**
  * Check the integrity of the data in this struct.
  * @param rs the roadstop this entry is part of
+ * @return Whether the cached length and occupation match the actual ones.
  */
-void RoadStop::Entry::CheckIntegrity(const RoadStop *rs) const
+bool RoadStop::Entry::CheckIntegrity(const RoadStop *rs) const
 {
-	if (!HasBit(rs->status, RSSFB_BASE_ENTRY)) return;
+	if (!HasBit(rs->status, RSSFB_BASE_ENTRY)) return true;
 
 	/* The tile 'before' the road stop must not be part of this 'line' */
 	assert(!IsDriveThroughRoadStopContinuation(rs->xy, rs->xy - abs(TileOffsByDiagDir(GetRoadStopDir(rs->xy)))));
 
 	Entry temp;
 	temp.Rebuild(rs, rs->east == this);
-	if (temp.length != this->length || temp.occupied != this->occupied) NOT_REACHED();
+	return temp.length == this->length && temp.occupied == this->occupied;
 }
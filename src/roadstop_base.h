@@ -62,7 +62,7 @@ struct RoadStop : RoadStopPool::PoolItem<&_roadstop_pool> {
 
 		void Leave(const RoadVehicle *rv);
 		void Enter(const RoadVehicle *rv);
-		void CheckIntegrity(const RoadStop *rs) const;
+		bool CheckIntegrity(const RoadStop *rs) const;
 		void Rebuild(const RoadStop *rs, int side = -1);
 	};
 
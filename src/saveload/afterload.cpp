@@ -1326,6 +1326,9 @@ bool AfterLoadGame()
 	}
 
 	YapfNotifyTrackLayoutChange(INVALID_TILE, INVALID_TRACK);
+	FlushSignalBlockCache();
+	YapfNotifyRoadLayoutChange(INVALID_TILE);
+	YapfNotifyWaterLayoutChange(INVALID_TILE);
 
 	if (IsSavegameVersionBefore(34)) {
 		Company *c;
@@ -2968,6 +2971,11 @@ bool AfterLoadGame()
 #endif
 	}
 
+	/* Before savegame version 195 all monthly and yearly work was done at the
+	 * start of the first day of the period, so it must not be done again in
+	 * the remaining ticks of that day. */
+	if (IsSavegameVersionBefore(195)) _period_tick_date = INVALID_DATE;
+
 
 	/* Station acceptance is some kind of cache */
 	if (IsSavegameVersionBefore(127)) {
@@ -92,6 +92,7 @@ static const SaveLoadGlobVarList _date_desc[] = {
 	    SLEG_VAR(_trees_tick_ctr,         SLE_UINT8),
 	SLEG_CONDVAR(_pause_mode,             SLE_UINT8,                   4, SL_MAX_VERSION),
 	SLE_CONDNULL(4, 11, 119),
+	SLEG_CONDVAR(_period_tick_date,       SLE_INT32,                 195, SL_MAX_VERSION),
 	    SLEG_END()
 };
 
@@ -117,6 +118,7 @@ static const SaveLoadGlobVarList _date_check_desc[] = {
 	    SLE_NULL(1),                       // _trees_tick_ctr
 	SLE_CONDNULL(1, 4, SL_MAX_VERSION),    // _pause_mode
 	SLE_CONDNULL(4, 11, 119),
+	SLE_CONDNULL(4, 195, SL_MAX_VERSION),  // _period_tick_date
 	    SLEG_END()
 };
 
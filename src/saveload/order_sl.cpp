@@ -274,10 +274,10 @@ const SaveLoad *GetOrderBackupDescription()
 
 static void Save_BKOR()
 {
-	/* We only save this when we're a network server
+	/* We only save this when we're a network server or relay
 	 * as we want this information on our clients. For
 	 * normal games this information isn't needed. */
-	if (!_networking || !_network_server) return;
+	if (!_networking || (!_network_server && !_network_relay)) return;
 
 	OrderBackup *ob;
 	FOR_ALL_ORDER_BACKUPS(ob) {
@@ -25,6 +25,9 @@
 #include "window_func.h"
 #include "tile_map.h"
 #include "landscape.h"
+#include "console_func.h"
+#include "spritecache.h"
+#include "thread/thread.h"
 
 #include "table/strings.h"
 
@@ -66,6 +69,7 @@ typedef bool ScreenshotHandlerProc(const char *name, ScreenshotCallback *callb,
 struct ScreenshotFormat {
 	const char *extension;       ///< File extension.
 	ScreenshotHandlerProc *proc; ///< Function for writing the screenshot.
+	bool bottom_up;              ///< Whether the lines are written from the bottom to the top.
 };
 
 /*************************************************
@@ -571,10 +575,10 @@ static bool MakePCXImage(const char *name, ScreenshotCallback *callb, void *user
 /** Available screenshot formats. */
 static const ScreenshotFormat _screenshot_formats[] = {
 #if defined(WITH_PNG)
-	{"png", &MakePNGImage},
+	{"png", &MakePNGImage, false},
 #endif
-	{"bmp", &MakeBMPImage},
-	{"pcx", &MakePCXImage},
+	{"bmp", &MakeBMPImage, true},
+	{"pcx", &MakePCXImage, false},
 };
 
 /** Get filename extension of current screenshot file format. */
@@ -664,6 +668,207 @@ static void LargeWorldCallback(void *userdata, void *buf, uint y, uint pitch, ui
 	_screen_disable_anim = old_disable_anim;
 }
 
+/** Number of strips of a large screenshot that can be rendered ahead of the encoder. */
+static const uint SCREENSHOT_PIPELINE_STRIPS = 3;
+/** Memory aimed for per rendered strip of a large screenshot. */
+static const uint SCREENSHOT_STRIP_MEMORY = 4 * 1024 * 1024;
+
+/**
+ * Pipeline for large screenshots: the main thread renders strips of the
+ * image while a second thread encodes the previously rendered strips.
+ * At most #SCREENSHOT_PIPELINE_STRIPS strips are in memory at any time.
+ * Rendering itself stays on the main thread, as drawing the viewport uses
+ * global state.
+ */
+struct ScreenshotPipeline {
+	ThreadMutex *mutex;              ///< Mutex protecting the progress of rendering and encoding.
+	ScreenshotCallback *callb;       ///< Callback rendering the lines of the image.
+	void *userdata;                  ///< User data of #callb.
+
+	const ScreenshotFormat *sf;      ///< Format to encode the image in.
+	const char *name;                ///< Filename of the image.
+	uint width;                      ///< Width of the image in pixels.
+	uint height;                     ///< Height of the image in pixels.
+	int pixelformat;                 ///< Bits per pixel of the image.
+	const Colour *palette;           ///< Palette of 8bpp images.
+	bool bottom_up;                  ///< Whether the encoder requests the lines bottom up.
+
+	uint strip_lines;                ///< Number of lines per strip.
+	uint num_strips;                 ///< Number of strips of the image.
+	byte *strips[SCREENSHOT_PIPELINE_STRIPS];  ///< Buffers of the strips.
+	uint copied[SCREENSHOT_PIPELINE_STRIPS];   ///< Number of lines of the strips passed to the encoder.
+	uint rendered;                   ///< Number of strips rendered.
+	uint consumed;                   ///< Number of strips fully passed to the encoder.
+	bool done;                       ///< Whether the encoder has finished.
+	bool result;                     ///< Whether the encoder has written the image successfully.
+
+	/**
+	 * Get the lines of a strip; strips are numbered in the order the encoder uses them.
+	 * @param strip The strip.
+	 * @param[out] first First line of the strip.
+	 * @param[out] count Number of lines of the strip.
+	 */
+	void GetStripLines(uint strip, uint *first, uint *count) const
+	{
+		if (this->bottom_up) {
+			uint end = this->height - strip * this->strip_lines;
+			*first = end > this->strip_lines ? end - this->strip_lines : 0;
+			*count = end - *first;
+		} else {
+			*first = strip * this->strip_lines;
+			*count = min(this->strip_lines, this->height - *first);
+		}
+	}
+
+	/**
+	 * Pass a single line to the encoder, waiting until it has been rendered.
+	 * @param buf Destination of the line.
+	 * @param y The line.
+	 */
+	void CopyLine(byte *buf, uint y)
+	{
+		uint strip = (this->bottom_up ? this->height - 1 - y : y) / this->strip_lines;
+		uint slot = strip % SCREENSHOT_PIPELINE_STRIPS;
+
+		this->mutex->BeginCritical();
+		while (this->rendered <= strip) this->mutex->WaitForSignal();
+		this->mutex->EndCritical();
+
+		uint first, count;
+		this->GetStripLines(strip, &first, &count);
+		size_t line_size = this->width * this->pixelformat / 8;
+		memcpy(buf, this->strips[slot] + (y - first) * line_size, line_size);
+
+		if (++this->copied[slot] == count) {
+			this->mutex->BeginCritical();
+			this->copied[slot] = 0;
+			this->consumed++;
+			this->mutex->SendSignal();
+			this->mutex->EndCritical();
+		}
+	}
+};
+
+/**
+ * Callback of the encoder of a screenshot pipeline.
+ * @see ScreenshotCallback
+ */
+static void ScreenshotPipelineCallback(void *userdata, void *buf, uint y, uint pitch, uint n)
+{
+	ScreenshotPipeline *pipeline = (ScreenshotPipeline *)userdata;
+	size_t line_size = pitch * pipeline->pixelformat / 8;
+
+	/* Pass the lines in the order the encoder asks for them. */
+	for (uint i = 0; i < n; i++) {
+		uint line = pipeline->bottom_up ? n - 1 - i : i;
+		pipeline->CopyLine((byte *)buf + line * line_size, y + line);
+	}
+}
+
+/**
+ * Entry point of the encoder thread of a screenshot pipeline.
+ * @param arg The pipeline.
+ */
+static void ScreenshotEncoderThread(void *arg)
+{
+	ScreenshotPipeline *pipeline = (ScreenshotPipeline *)arg;
+	bool result = pipeline->sf->proc(pipeline->name, ScreenshotPipelineCallback, pipeline, pipeline->width, pipeline->height, pipeline->pixelformat, pipeline->palette);
+
+	pipeline->mutex->BeginCritical();
+	pipeline->result = result;
+	pipeline->done = true;
+	pipeline->mutex->SendSignal();
+	pipeline->mutex->EndCritical();
+}
+
+/**
+ * Write a large image, rendering it on the main thread while it is encoded
+ * on another. Progress and throughput are reported on the console.
+ * @param sf          Format to write the image in.
+ * @param name        Filename, including extension.
+ * @param callb       Callback function for rendering lines of pixels.
+ * @param userdata    User data, passed on to \a callb.
+ * @param w           Width of the image in pixels.
+ * @param h           Height of the image in pixels.
+ * @param pixelformat Bits per pixel (bpp), either 8 or 32.
+ * @param palette     %Colour palette (for 8bpp images).
+ * @return File was written successfully.
+ */
+static bool MakePipelinedImage(const ScreenshotFormat *sf, const char *name, ScreenshotCallback *callb, void *userdata, uint w, uint h, int pixelformat, const Colour *palette)
+{
+	if (w == 0 || h == 0 || (pixelformat != 8 && pixelformat != 32)) return sf->proc(name, callb, userdata, w, h, pixelformat, palette);
+
+	ScreenshotPipeline pipeline;
+	memset(&pipeline, 0, sizeof(pipeline));
+	pipeline.callb = callb;
+	pipeline.userdata = userdata;
+	pipeline.sf = sf;
+	pipeline.name = name;
+	pipeline.width = w;
+	pipeline.height = h;
+	pipeline.pixelformat = pixelformat;
+	pipeline.palette = palette;
+	pipeline.bottom_up = sf->bottom_up;
+	pipeline.strip_lines = Clamp<uint>(SCREENSHOT_STRIP_MEMORY / (w * pixelformat / 8), 16, 1024);
+	pipeline.num_strips = CeilDiv(h, pipeline.strip_lines);
+	pipeline.mutex = ThreadMutex::New();
+
+	ThreadObject *thread;
+	if (!ThreadObject::New(&ScreenshotEncoderThread, &pipeline, &thread)) {
+		/* No threads; render each part when the encoder asks for it. */
+		delete pipeline.mutex;
+		return sf->proc(name, callb, userdata, w, h, pixelformat, palette);
+	}
+
+	size_t strip_size = (size_t)pipeline.strip_lines * w * pixelformat / 8;
+	for (uint i = 0; i < SCREENSHOT_PIPELINE_STRIPS; i++) pipeline.strips[i] = CallocT<byte>(strip_size);
+
+	uint64 start = GetPerformanceTimer();
+	uint lines = 0;
+	uint reported = 0;
+	for (uint strip = 0; strip < pipeline.num_strips; strip++) {
+		/* Wait for a free buffer; stop when the encoder gave up. */
+		pipeline.mutex->BeginCritical();
+		while (strip - pipeline.consumed >= SCREENSHOT_PIPELINE_STRIPS && !pipeline.done) pipeline.mutex->WaitForSignal();
+		bool done = pipeline.done;
+		pipeline.mutex->EndCritical();
+		if (done) break;
+
+		uint first, count;
+		pipeline.GetStripLines(strip, &first, &count);
+		callb(userdata, pipeline.strips[strip % SCREENSHOT_PIPELINE_STRIPS], first, w, count);
+
+		pipeline.mutex->BeginCritical();
+		pipeline.rendered = strip + 1;
+		pipeline.mutex->SendSignal();
+		pipeline.mutex->EndCritical();
+
+		lines += count;
+		uint percentage = (uint)(lines * 100ULL / h);
+		if (percentage / 10 != reported / 10) {
+			reported = percentage;
+			uint64 elapsed = max<uint64>(GetPerformanceTimer() - start, 1);
+			IConsolePrintF(CC_DEFAULT, "Screenshot: %u%% rendered (%u of %u lines), " OTTD_PRINTF64 " kpixels/s",
+					percentage, lines, h, (uint64)lines * w * 1000 / elapsed);
+		}
+	}
+
+	pipeline.mutex->BeginCritical();
+	while (!pipeline.done) pipeline.mutex->WaitForSignal();
+	pipeline.mutex->EndCritical();
+
+	thread->Join();
+	delete thread;
+	delete pipeline.mutex;
+	for (uint i = 0; i < SCREENSHOT_PIPELINE_STRIPS; i++) free(pipeline.strips[i]);
+
+	uint64 elapsed = max<uint64>(GetPerformanceTimer() - start, 1);
+	IConsolePrintF(CC_DEFAULT, "Screenshot: %ux%u pixels in " OTTD_PRINTF64 " ms, " OTTD_PRINTF64 " kpixels/s, %u lines per strip",
+			w, h, elapsed / 1000, (uint64)w * h * 1000 / elapsed, pipeline.strip_lines);
+
+	return pipeline.result;
+}
+
 /**
  * Construct a pathname for a screenshot file.
  * @param default_fn Default filename.
@@ -753,6 +958,36 @@ void SetupScreenshotViewport(ScreenshotType t, ViewPort *vp)
 	vp->overlay = NULL;
 }
 
+/**
+ * Without a blitter that draws, e.g. on a dedicated server, temporarily
+ * select one that does, so the map can be drawn into an image.
+ * @param old_blitter Buffer for the name of the blitter to restore afterwards; empty when nothing has to be restored.
+ * @param last Last element of \a old_blitter.
+ * @return Whether a drawing blitter is active.
+ */
+static bool SelectDrawingBlitter(char *old_blitter, const char *last)
+{
+	*old_blitter = '\0';
+	if (BlitterFactory::GetCurrentBlitter()->GetScreenDepth() != 0) return true;
+
+	strecpy(old_blitter, BlitterFactory::GetCurrentBlitter()->GetName(), last);
+	if (BlitterFactory::SelectBlitter("8bpp-optimized") == NULL) return false;
+	GfxClearSpriteCache();
+	return true;
+}
+
+/**
+ * Restore the blitter replaced by #SelectDrawingBlitter.
+ * @param old_blitter Name of the blitter to restore, or an empty string.
+ */
+static void RestoreBlitter(const char *old_blitter)
+{
+	if (StrEmpty(old_blitter)) return;
+
+	BlitterFactory::SelectBlitter(old_blitter);
+	GfxClearSpriteCache();
+}
+
 /**
  * Make a screenshot of the map.
  * @param t Screenshot type: World or viewport screenshot
@@ -760,14 +995,210 @@ void SetupScreenshotViewport(ScreenshotType t, ViewPort *vp)
  */
 static bool MakeLargeWorldScreenshot(ScreenshotType t)
 {
+	/* Only the whole map can be drawn without a main window. */
+	if (t != SC_WORLD && FindWindowById(WC_MAIN_WINDOW, 0) == NULL) return false;
+
+	char old_blitter[32];
+	if (!SelectDrawingBlitter(old_blitter, lastof(old_blitter))) return false;
+
 	ViewPort vp;
 	SetupScreenshotViewport(t, &vp);
 
 	const ScreenshotFormat *sf = _screenshot_formats + _cur_screenshot_format;
-	return sf->proc(MakeScreenshotName(SCREENSHOT_NAME, sf->extension), LargeWorldCallback, &vp, vp.width, vp.height,
+	bool ret = MakePipelinedImage(sf, MakeScreenshotName(SCREENSHOT_NAME, sf->extension), LargeWorldCallback, &vp, vp.width, vp.height,
 			BlitterFactory::GetCurrentBlitter()->GetScreenDepth(), _cur_palette.palette);
+
+	RestoreBlitter(old_blitter);
+
+	return ret;
+}
+
+/** Width and height of the tiles of a map tile pyramid, in pixels. */
+static const uint MAP_TILE_SIZE = 256;
+
+/** State of the map tile pyramid, used to only render the changed tiles again. */
+struct MapTilePyramid {
+	char directory[MAX_PATH]; ///< Directory the tiles have last been exported to; empty when no tiles have been exported.
+	ViewPort world;           ///< Area of the world covered by the tiles, at the most detailed zoom level.
+	uint cells_x;             ///< Number of tiles at the most detailed zoom level in x direction.
+	uint cells_y;             ///< Number of tiles at the most detailed zoom level in y direction.
+	ZoomLevel zoom_min;       ///< Most detailed zoom level that has been exported.
+	ZoomLevel zoom_max;       ///< Least detailed zoom level that has been exported; it is level 0 of the pyramid.
+	byte *dirty;              ///< Per tile at the most detailed zoom level whether it changed since the last export.
+};
+
+static MapTilePyramid _map_tiles; ///< The last exported map tile pyramid.
+
+/**
+ * Record that an area of the world has changed, so the tiles of the map tile
+ * pyramid covering it are rendered again on the next export.
+ * @param left   Left edge of the area, in virtual coordinates.
+ * @param top    Top edge of the area, in virtual coordinates.
+ * @param right  Right edge of the area, in virtual coordinates.
+ * @param bottom Bottom edge of the area, in virtual coordinates.
+ */
+void MarkMapTilesDirty(int left, int top, int right, int bottom)
+{
+	if (_map_tiles.dirty == NULL) return;
+
+	const ViewPort &vp = _map_tiles.world;
+	int cell_size = ScaleByZoom(MAP_TILE_SIZE, vp.zoom);
+	left = max(left - vp.virtual_left, 0) / cell_size;
+	top = max(top - vp.virtual_top, 0) / cell_size;
+	right = min<int>((right - vp.virtual_left) / cell_size, _map_tiles.cells_x - 1);
+	bottom = min<int>((bottom - vp.virtual_top) / cell_size, _map_tiles.cells_y - 1);
+
+	for (int y = top; y <= bottom; y++) {
+		for (int x = left; x <= right; x++) {
+			_map_tiles.dirty[y * _map_tiles.cells_x + x] = 1;
+		}
+	}
 }
 
+#if defined(WITH_PNG)
+/**
+ * Configure a ViewPort covering the whole map for a map tile pyramid.
+ * Unlike for world screenshots, the area does not depend on the height of
+ * the tiles at the edges, so terraforming there does not move all tiles.
+ * @param zoom Most detailed zoom level of the pyramid.
+ * @param [out] vp Result viewport.
+ */
+static void SetupMapTilesViewport(ZoomLevel zoom, ViewPort *vp)
+{
+	TileIndex north_tile = _settings_game.construction.freeform_edges ? TileXY(1, 1) : TileXY(0, 0);
+	TileIndex south_tile = MapSize() - 1;
+	int extra_height_top = _settings_game.construction.max_heightlevel * TILE_HEIGHT + 150;
+
+	vp->zoom = zoom;
+	vp->virtual_left   = RemapCoords(TileX(south_tile) * TILE_SIZE, TileY(north_tile) * TILE_SIZE, 0).x;
+	vp->virtual_top    = RemapCoords(TileX(north_tile) * TILE_SIZE, TileY(north_tile) * TILE_SIZE, extra_height_top).y;
+	vp->virtual_width  = RemapCoords(TileX(north_tile) * TILE_SIZE, TileY(south_tile) * TILE_SIZE, 0).x - vp->virtual_left + 1;
+	vp->virtual_height = RemapCoords(TileX(south_tile) * TILE_SIZE, TileY(south_tile) * TILE_SIZE, 0).y - vp->virtual_top  + 1;
+	vp->left = 0;
+	vp->top = 0;
+	vp->width  = UnScaleByZoom(vp->virtual_width,  vp->zoom);
+	vp->height = UnScaleByZoom(vp->virtual_height, vp->zoom);
+	vp->overlay = NULL;
+}
+
+/**
+ * Export the map as a tile pyramid for web map viewers: PNG tiles of
+ * #MAP_TILE_SIZE pixels in a "z/x/y.png" layout, where zoom level 0 is the
+ * most zoomed out level and every next level doubles the resolution, up to
+ * the zoom level of world screenshots. Only the zoom levels allowed by the
+ * zoom_min and zoom_max settings are exported, as the blitters only encode
+ * the sprites for those levels. After the first export into a
+ * directory, only the tiles showing parts of the map that changed are
+ * rendered again.
+ * @param name Name of the directory in the screenshot directory, or \c NULL for the default.
+ * @param full Whether to render all tiles, even the unchanged ones.
+ * @return Whether all tiles have been written successfully.
+ */
+bool MakeMapTiles(const char *name, bool full)
+{
+	char directory[MAX_PATH];
+	seprintf(directory, lastof(directory), "%s%s" PATHSEP, FiosGetScreenshotDir(), StrEmpty(name) ? "maptiles" : name);
+
+	char old_blitter[32];
+	if (!SelectDrawingBlitter(old_blitter, lastof(old_blitter))) return false;
+	int pixelformat = BlitterFactory::GetCurrentBlitter()->GetScreenDepth();
+
+	ZoomLevel zoom_min = max<ZoomLevel>(_settings_client.gui.zoom_min, ZOOM_LVL_WORLD_SCREENSHOT);
+	ZoomLevel zoom_max = _settings_client.gui.zoom_max;
+
+	/* Start over when the pyramid has been exported elsewhere, the map changed size or other zoom levels are allowed. */
+	ViewPort world;
+	SetupMapTilesViewport(zoom_min, &world);
+	uint cells_x = CeilDiv(world.width, MAP_TILE_SIZE);
+	uint cells_y = CeilDiv(world.height, MAP_TILE_SIZE);
+	if (full || _map_tiles.dirty == NULL || strcmp(directory, _map_tiles.directory) != 0 ||
+			world.virtual_left != _map_tiles.world.virtual_left || world.virtual_top != _map_tiles.world.virtual_top ||
+			cells_x != _map_tiles.cells_x || cells_y != _map_tiles.cells_y ||
+			zoom_min != _map_tiles.zoom_min || zoom_max != _map_tiles.zoom_max) {
+		free(_map_tiles.dirty);
+		_map_tiles.dirty = MallocT<byte>(cells_x * cells_y);
+		memset(_map_tiles.dirty, 1, cells_x * cells_y);
+		strecpy(_map_tiles.directory, directory, lastof(_map_tiles.directory));
+		_map_tiles.world = world;
+		_map_tiles.cells_x = cells_x;
+		_map_tiles.cells_y = cells_y;
+		_map_tiles.zoom_min = zoom_min;
+		_map_tiles.zoom_max = zoom_max;
+	}
+
+	/* The changed tiles of the current zoom level; each next level combines 2x2 tiles. */
+	byte *dirty = MallocT<byte>(cells_x * cells_y);
+	memcpy(dirty, _map_tiles.dirty, cells_x * cells_y);
+	memset(_map_tiles.dirty, 0, cells_x * cells_y);
+
+	uint64 start = GetPerformanceTimer();
+	uint rendered = 0;
+	uint total = 0;
+	bool ret = true;
+	uint tiles_x = cells_x;
+	uint tiles_y = cells_y;
+
+	FioCreateDirectory(directory);
+	for (ZoomLevel zoom = zoom_min; zoom <= zoom_max; zoom++) {
+		char path[MAX_PATH];
+		seprintf(path, lastof(path), "%s%d", directory, zoom_max - zoom);
+		FioCreateDirectory(path);
+
+		for (uint x = 0; x < tiles_x; x++) {
+			seprintf(path, lastof(path), "%s%d" PATHSEP "%u", directory, zoom_max - zoom, x);
+			FioCreateDirectory(path);
+
+			for (uint y = 0; y < tiles_y; y++) {
+				total++;
+				if (!dirty[y * tiles_x + x]) continue;
+
+				ViewPort vp = world;
+				vp.zoom = zoom;
+				vp.virtual_left += ScaleByZoom(x * MAP_TILE_SIZE, zoom);
+				vp.virtual_top += ScaleByZoom(y * MAP_TILE_SIZE, zoom);
+				vp.virtual_width = ScaleByZoom(MAP_TILE_SIZE, zoom);
+				vp.virtual_height = ScaleByZoom(MAP_TILE_SIZE, zoom);
+				vp.width = MAP_TILE_SIZE;
+				vp.height = MAP_TILE_SIZE;
+
+				seprintf(path, lastof(path), "%s%d" PATHSEP "%u" PATHSEP "%u.png", directory, zoom_max - zoom, x, y);
+				if (!MakePNGImage(path, LargeWorldCallback, &vp, MAP_TILE_SIZE, MAP_TILE_SIZE, pixelformat, _cur_palette.palette)) {
+					DEBUG(misc, 0, "Failed to write map tile %s", path);
+					ret = false;
+				}
+				rendered++;
+			}
+		}
+
+		/* Combine the changed tiles for the next, less detailed, zoom level. */
+		uint next_x = CeilDiv(tiles_x, 2);
+		uint next_y = CeilDiv(tiles_y, 2);
+		for (uint y = 0; y < next_y; y++) {
+			for (uint x = 0; x < next_x; x++) {
+				byte d = dirty[2 * y * tiles_x + 2 * x];
+				if (2 * x + 1 < tiles_x) d |= dirty[2 * y * tiles_x + 2 * x + 1];
+				if (2 * y + 1 < tiles_y) d |= dirty[(2 * y + 1) * tiles_x + 2 * x];
+				if (2 * x + 1 < tiles_x && 2 * y + 1 < tiles_y) d |= dirty[(2 * y + 1) * tiles_x + 2 * x + 1];
+				dirty[y * next_x + x] = d;
+			}
+		}
+		tiles_x = next_x;
+		tiles_y = next_y;
+	}
+	free(dirty);
+
+	RestoreBlitter(old_blitter);
+
+	/* Render the failed tiles again next time. */
+	if (!ret) memset(_map_tiles.dirty, 1, cells_x * cells_y);
+
+	uint64 elapsed = GetPerformanceTimer() - start;
+	IConsolePrintF(CC_DEFAULT, "Map tiles: rendered %u of %u tiles at %d zoom levels in " OTTD_PRINTF64 " ms",
+			rendered, total, zoom_max - zoom_min + 1, elapsed / 1000);
+	return ret;
+}
+#endif /* WITH_PNG */
+
 /**
  * Callback for generating a heightmap. Supports 8bpp grayscale only.
  * @param userdata Pointer to user data.
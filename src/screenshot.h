@@ -29,6 +29,8 @@ enum ScreenshotType {
 void SetupScreenshotViewport(ScreenshotType t, struct ViewPort *vp);
 bool MakeHeightmapScreenshot(const char *filename);
 bool MakeScreenshot(ScreenshotType t, const char *name);
+bool MakeMapTiles(const char *name, bool full);
+void MarkMapTilesDirty(int left, int top, int right, int bottom);
 
 extern char _screenshot_format_name[8];
 extern uint _num_screenshot_formats;
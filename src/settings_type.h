@@ -150,6 +150,7 @@ struct GUISettings {
 #endif
 
 	uint8  developer;                        ///< print non-fatal warnings in console (>= 1), copy debug output to console (== 2)
+	uint16 cache_check_budget;               ///< time in microseconds per tick to spend on checking a slice of the caches (0 = off)
 	bool   show_date_in_logs;                ///< whether to show dates in console logs
 	bool   newgrf_developer_tools;           ///< activate NewGRF developer tools and allow modifying NewGRFs in an existing game
 	bool   ai_developer_tools;               ///< activate AI developer tools
@@ -228,9 +229,12 @@ struct NewsSettings {
 struct NetworkSettings {
 #ifdef ENABLE_NETWORK
 	uint16 sync_freq;                                     ///< how often do we check whether we are still in-sync
+	bool   sync_checksums;                                ///< whether to send checksums of parts of the game state with the sync checks
 	uint8  frame_freq;                                    ///< how often do we send commands to the clients
 	uint16 commands_per_frame;                            ///< how many commands may be sent each frame_freq frames?
 	uint16 max_commands_in_queue;                         ///< how many commands may there be in the incoming queue before dropping the connection?
+	uint16 command_cost_per_frame;                        ///< how much command cost (roughly the number of affected tiles) may, over a long period, be executed per frame for a client?
+	uint16 command_cost_burst;                            ///< how much command cost may, over a short period, be executed for a client?
 	uint16 bytes_per_frame;                               ///< how many bytes may, over a long period, be received per frame?
 	uint16 bytes_per_frame_burst;                         ///< how many bytes may, over a short period, be received?
 	uint16 max_init_time;                                 ///< maximum amount of time, in game ticks, a client may take to initiate joining
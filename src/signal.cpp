@@ -18,6 +18,8 @@
 #include "train.h"
 #include "company_base.h"
 
+#include <map>
+
 #include "safeguards.h"
 
 
@@ -26,6 +28,7 @@ static const uint SIG_TBU_SIZE    =  64; ///< number of signals entering to bloc
 static const uint SIG_TBD_SIZE    = 256; ///< number of intersections - open nodes in current block
 static const uint SIG_GLOB_SIZE   = 128; ///< number of open blocks (block can be opened more times until detected)
 static const uint SIG_GLOB_UPDATE =  64; ///< how many items need to be in _globset to force update
+static const uint SIG_BLOCK_CACHE_SIZE = 4096; ///< number of explored signal blocks to remember
 
 assert_compile(SIG_GLOB_UPDATE <= SIG_GLOB_SIZE);
 
@@ -189,6 +192,41 @@ static SmallSet<DiagDirection, SIG_TBD_SIZE> _tbdset("_tbdset");    ///< set of
 static SmallSet<DiagDirection, SIG_GLOB_SIZE> _globset("_globset"); ///< set of places to be updated in following runs
 
 
+/** Tile side visited while exploring a signal block */
+struct SignalBlockSide {
+	TileIndex tile;     ///< tile
+	DiagDirection side; ///< side of the tile, INVALID_DIAGDIR for depot insides and wormholes
+};
+
+/** Tile of a signal block that is checked for trains */
+struct SignalBlockTile {
+	TileIndex tile;     ///< tile
+	TrackBits tracks;   ///< tracks to check for trains, TRACK_BIT_NONE to check the whole tile
+};
+
+/** Signal at the border of a signal block */
+struct SignalBlockSignal {
+	TileIndex tile;     ///< tile of the signal
+	Trackdir trackdir;  ///< trackdir of the signal
+};
+
+/**
+ * Everything exploring a signal block from a given start yields that does not
+ * depend on trains or signal states. As long as the track layout does not change,
+ * the block can be updated from these lists instead of exploring it again.
+ */
+struct SignalBlock {
+	SmallVector<SignalBlockSide, 16> sides;     ///< tile sides removed from _globset, in order of removal
+	SmallVector<SignalBlockTile, 16> tiles;     ///< tiles that are checked for trains
+	SmallVector<SignalBlockSignal, 4> signals;  ///< signals to update, in order of discovery
+	SmallVector<SignalBlockSignal, 4> exits;    ///< pre-signal exits leading out of the block, in order of discovery
+	bool pbs;                                   ///< whether the block is a PBS block
+};
+
+typedef std::map<uint64, SignalBlock *> SignalBlockMap;
+static SignalBlockMap _signal_blocks; ///< explored signal blocks, by start tile, start side and owner
+
+
 /** Check whether there is a train on rail, not in a depot */
 static Vehicle *TrainOnTileEnum(Vehicle *v, void *)
 {
@@ -197,6 +235,29 @@ static Vehicle *TrainOnTileEnum(Vehicle *v, void *)
 	return v;
 }
 
+/**
+ * Check whether there is a train on a tile of a signal block.
+ * @param tile tile to check
+ * @param tracks tracks to check, TRACK_BIT_NONE to check the whole tile
+ * @return is there a train, not in a depot?
+ */
+static inline bool IsTrainOnSignalBlockTile(TileIndex tile, TrackBits tracks)
+{
+	if (tracks != TRACK_BIT_NONE) return EnsureNoTrainOnTrackBits(tile, tracks).Failed();
+	return HasVehicleOnPos(tile, NULL, &TrainOnTileEnum);
+}
+
+/**
+ * Forget all explored signal blocks.
+ * Has to be called whenever track, signals, depots, stations, crossings,
+ * tunnels or bridges are built or removed, or when tracks change owner.
+ */
+void FlushSignalBlockCache()
+{
+	for (SignalBlockMap::iterator it = _signal_blocks.begin(); it != _signal_blocks.end(); it++) delete it->second;
+	_signal_blocks.clear();
+}
+
 
 /**
  * Perform some operations before adding data into Todo set
@@ -209,13 +270,22 @@ static Vehicle *TrainOnTileEnum(Vehicle *v, void *)
  * @param d1 direction (tile side) we are entering
  * @param t2 tile we are leaving
  * @param d2 direction (tile side) we are leaving
+ * @param block signal block to record the visited sides in, or NULL
  * @return false iff reverse direction was in Todo set
  */
-static inline bool CheckAddToTodoSet(TileIndex t1, DiagDirection d1, TileIndex t2, DiagDirection d2)
+static inline bool CheckAddToTodoSet(TileIndex t1, DiagDirection d1, TileIndex t2, DiagDirection d2, SignalBlock *block)
 {
 	_globset.Remove(t1, d1); // it can be in Global but not in Todo
 	_globset.Remove(t2, d2); // remove in all cases
 
+	if (block != NULL) {
+		SignalBlockSide *s = block->sides.Append(2);
+		s[0].tile = t1;
+		s[0].side = d1;
+		s[1].tile = t2;
+		s[1].side = d2;
+	}
+
 	assert(!_tbdset.IsIn(t1, d1)); // it really shouldn't be there already
 
 	if (_tbdset.Remove(t2, d2)) return false;
@@ -235,11 +305,12 @@ static inline bool CheckAddToTodoSet(TileIndex t1, DiagDirection d1, TileIndex t
  * @param d1 direction (tile side) we are entering
  * @param t2 tile we are leaving
  * @param d2 direction (tile side) we are leaving
+ * @param block signal block to record the visited sides in, or NULL
  * @return false iff the Todo buffer would be overrun
  */
-static inline bool MaybeAddToTodoSet(TileIndex t1, DiagDirection d1, TileIndex t2, DiagDirection d2)
+static inline bool MaybeAddToTodoSet(TileIndex t1, DiagDirection d1, TileIndex t2, DiagDirection d2, SignalBlock *block)
 {
-	if (!CheckAddToTodoSet(t1, d1, t2, d2)) return true;
+	if (!CheckAddToTodoSet(t1, d1, t2, d2, block)) return true;
 
 	return _tbdset.Add(t1, d1);
 }
@@ -260,13 +331,48 @@ enum SigFlags {
 DECLARE_ENUM_AS_BIT_SET(SigFlags)
 
 
+/**
+ * Check a tile of the signal block for trains, unless one has been found already
+ *
+ * @param flags flags of the block to set SF_TRAIN in
+ * @param tile tile to check
+ * @param tracks tracks to check, TRACK_BIT_NONE to check the whole tile
+ * @param block signal block to record the tile in, or NULL
+ */
+static inline void CheckSignalBlockTile(SigFlags &flags, TileIndex tile, TrackBits tracks, SignalBlock *block)
+{
+	if (block != NULL) {
+		SignalBlockTile *t = block->tiles.Append();
+		t->tile = tile;
+		t->tracks = tracks;
+	}
+
+	if (!(flags & SF_TRAIN) && IsTrainOnSignalBlockTile(tile, tracks)) flags |= SF_TRAIN;
+}
+
+/**
+ * Record a signal of the signal block
+ *
+ * @param list list to add the signal to
+ * @param tile tile of the signal
+ * @param trackdir trackdir of the signal
+ */
+static inline void RecordSignalBlockSignal(SmallVector<SignalBlockSignal, 4> &list, TileIndex tile, Trackdir trackdir)
+{
+	SignalBlockSignal *s = list.Append();
+	s->tile = tile;
+	s->trackdir = trackdir;
+}
+
+
 /**
  * Search signal block
  *
  * @param owner owner whose signals we are updating
+ * @param block signal block to record the layout found in, or NULL
  * @return SigFlags
  */
-static SigFlags ExploreSegment(Owner owner)
+static SigFlags ExploreSegment(Owner owner, SignalBlock *block)
 {
 	SigFlags flags = SF_NONE;
 
@@ -283,13 +389,13 @@ static SigFlags ExploreSegment(Owner owner)
 
 				if (IsRailDepot(tile)) {
 					if (enterdir == INVALID_DIAGDIR) { // from 'inside' - train just entered or left the depot
-						if (!(flags & SF_TRAIN) && HasVehicleOnPos(tile, NULL, &TrainOnTileEnum)) flags |= SF_TRAIN;
+						CheckSignalBlockTile(flags, tile, TRACK_BIT_NONE, block);
 						exitdir = GetRailDepotDirection(tile);
 						tile += TileOffsByDiagDir(exitdir);
 						enterdir = ReverseDiagDir(exitdir);
 						break;
 					} else if (enterdir == GetRailDepotDirection(tile)) { // entered a depot
-						if (!(flags & SF_TRAIN) && HasVehicleOnPos(tile, NULL, &TrainOnTileEnum)) flags |= SF_TRAIN;
+						CheckSignalBlockTile(flags, tile, TRACK_BIT_NONE, block);
 						continue;
 					} else {
 						continue;
@@ -303,10 +409,10 @@ static SigFlags ExploreSegment(Owner owner)
 				if (tracks == TRACK_BIT_HORZ || tracks == TRACK_BIT_VERT) { // there is exactly one incidating track, no need to check
 					tracks = tracks_masked;
 					/* If no train detected yet, and there is not no train -> there is a train -> set the flag */
-					if (!(flags & SF_TRAIN) && EnsureNoTrainOnTrackBits(tile, tracks).Failed()) flags |= SF_TRAIN;
+					CheckSignalBlockTile(flags, tile, tracks, block);
 				} else {
 					if (tracks_masked == TRACK_BIT_NONE) continue; // no incidating track
-					if (!(flags & SF_TRAIN) && HasVehicleOnPos(tile, NULL, &TrainOnTileEnum)) flags |= SF_TRAIN;
+					CheckSignalBlockTile(flags, tile, TRACK_BIT_NONE, block);
 				}
 
 				if (HasSignals(tile)) { // there is exactly one track - not zero, because there is exit from this tile
@@ -323,10 +429,16 @@ static SigFlags ExploreSegment(Owner owner)
 								flags |= SF_PBS;
 							} else if (!_tbuset.Add(tile, reversedir)) {
 								return flags | SF_FULL;
+							} else if (block != NULL) {
+								RecordSignalBlockSignal(block->signals, tile, reversedir);
 							}
 						}
 						if (HasSignalOnTrackdir(tile, trackdir) && !IsOnewaySignal(tile, track)) flags |= SF_PBS;
 
+						if (block != NULL && IsPresignalExit(tile, track) && HasSignalOnTrackdir(tile, trackdir)) {
+							RecordSignalBlockSignal(block->exits, tile, trackdir);
+						}
+
 						/* if it is a presignal EXIT in OUR direction and we haven't found 2 green exits yes, do special check */
 						if (!(flags & SF_GREEN2) && IsPresignalExit(tile, track) && HasSignalOnTrackdir(tile, trackdir)) { // found presignal exit
 							if (flags & SF_EXIT) flags |= SF_EXIT2; // found two (or more) exits
@@ -345,7 +457,7 @@ static SigFlags ExploreSegment(Owner owner)
 					if (dir != enterdir && (tracks & _enterdir_to_trackbits[dir])) { // any track incidating?
 						TileIndex newtile = tile + TileOffsByDiagDir(dir);  // new tile to check
 						DiagDirection newdir = ReverseDiagDir(dir); // direction we are entering from
-						if (!MaybeAddToTodoSet(newtile, newdir, tile, dir)) return flags | SF_FULL;
+						if (!MaybeAddToTodoSet(newtile, newdir, tile, dir, block)) return flags | SF_FULL;
 					}
 				}
 
@@ -358,7 +470,7 @@ static SigFlags ExploreSegment(Owner owner)
 				if (DiagDirToAxis(enterdir) != GetRailStationAxis(tile)) continue; // different axis
 				if (IsStationTileBlocked(tile)) continue; // 'eye-candy' station tile
 
-				if (!(flags & SF_TRAIN) && HasVehicleOnPos(tile, NULL, &TrainOnTileEnum)) flags |= SF_TRAIN;
+				CheckSignalBlockTile(flags, tile, TRACK_BIT_NONE, block);
 				tile += TileOffsByDiagDir(exitdir);
 				break;
 
@@ -367,7 +479,7 @@ static SigFlags ExploreSegment(Owner owner)
 				if (GetTileOwner(tile) != owner) continue;
 				if (DiagDirToAxis(enterdir) == GetCrossingRoadAxis(tile)) continue; // different axis
 
-				if (!(flags & SF_TRAIN) && HasVehicleOnPos(tile, NULL, &TrainOnTileEnum)) flags |= SF_TRAIN;
+				CheckSignalBlockTile(flags, tile, TRACK_BIT_NONE, block);
 				tile += TileOffsByDiagDir(exitdir);
 				break;
 
@@ -377,13 +489,13 @@ static SigFlags ExploreSegment(Owner owner)
 				DiagDirection dir = GetTunnelBridgeDirection(tile);
 
 				if (enterdir == INVALID_DIAGDIR) { // incoming from the wormhole
-					if (!(flags & SF_TRAIN) && HasVehicleOnPos(tile, NULL, &TrainOnTileEnum)) flags |= SF_TRAIN;
+					CheckSignalBlockTile(flags, tile, TRACK_BIT_NONE, block);
 					enterdir = dir;
 					exitdir = ReverseDiagDir(dir);
 					tile += TileOffsByDiagDir(exitdir); // just skip to next tile
 				} else { // NOT incoming from the wormhole!
 					if (ReverseDiagDir(enterdir) != dir) continue;
-					if (!(flags & SF_TRAIN) && HasVehicleOnPos(tile, NULL, &TrainOnTileEnum)) flags |= SF_TRAIN;
+					CheckSignalBlockTile(flags, tile, TRACK_BIT_NONE, block);
 					tile = GetOtherTunnelBridgeEnd(tile); // just skip to exit tile
 					enterdir = INVALID_DIAGDIR;
 					exitdir = INVALID_DIAGDIR;
@@ -395,7 +507,51 @@ static SigFlags ExploreSegment(Owner owner)
 				continue; // continue the while() loop
 		}
 
-		if (!MaybeAddToTodoSet(tile, enterdir, oldtile, exitdir)) return flags | SF_FULL;
+		if (!MaybeAddToTodoSet(tile, enterdir, oldtile, exitdir, block)) return flags | SF_FULL;
+	}
+
+	if (block != NULL) block->pbs = (flags & SF_PBS) != 0;
+
+	return flags;
+}
+
+
+/**
+ * Update the state of an explored signal block without exploring it again.
+ * Has exactly the same effect on the sets and returns the same flags as
+ * ExploreSegment() would.
+ *
+ * @param block the signal block
+ * @return SigFlags
+ */
+static SigFlags ReplaySegment(const SignalBlock *block)
+{
+	SigFlags flags = block->pbs ? SF_PBS : SF_NONE;
+
+	if (!_globset.IsEmpty()) {
+		for (const SignalBlockSide *s = block->sides.Begin(); s != block->sides.End(); s++) {
+			_globset.Remove(s->tile, s->side);
+		}
+	}
+
+	for (const SignalBlockSignal *s = block->exits.Begin(); s != block->exits.End() && !(flags & SF_GREEN2); s++) {
+		if (flags & SF_EXIT) flags |= SF_EXIT2; // found two (or more) exits
+		flags |= SF_EXIT;
+		if (GetSignalStateByTrackdir(s->tile, s->trackdir) == SIGNAL_STATE_GREEN) { // found green presignal exit
+			if (flags & SF_GREEN) flags |= SF_GREEN2;
+			flags |= SF_GREEN;
+		}
+	}
+
+	for (const SignalBlockSignal *s = block->signals.Begin(); s != block->signals.End(); s++) {
+		_tbuset.Add(s->tile, s->trackdir);
+	}
+
+	for (const SignalBlockTile *t = block->tiles.Begin(); t != block->tiles.End(); t++) {
+		if (IsTrainOnSignalBlockTile(t->tile, t->tracks)) {
+			flags |= SF_TRAIN;
+			break;
+		}
 	}
 
 	return flags;
@@ -483,53 +639,70 @@ static SigSegState UpdateSignalsInBuffer(Owner owner)
 		assert(_tbuset.IsEmpty());
 		assert(_tbdset.IsEmpty());
 
-		/* After updating signal, data stored are always MP_RAILWAY with signals.
-		 * Other situations happen when data are from outside functions -
-		 * modification of railbits (including both rail building and removal),
-		 * train entering/leaving block, train leaving depot...
-		 */
-		switch (GetTileType(tile)) {
-			case MP_TUNNELBRIDGE:
-				/* 'optimization assert' - do not try to update signals when it is not needed */
-				assert(GetTunnelBridgeTransportType(tile) == TRANSPORT_RAIL);
-				assert(dir == INVALID_DIAGDIR || dir == ReverseDiagDir(GetTunnelBridgeDirection(tile)));
-				_tbdset.Add(tile, INVALID_DIAGDIR);  // we can safely start from wormhole centre
-				_tbdset.Add(GetOtherTunnelBridgeEnd(tile), INVALID_DIAGDIR);
-				break;
+		SigFlags flags;
+		uint64 key = (uint64)tile << 16 | (uint)dir << 8 | owner;
+		SignalBlockMap::const_iterator cached = _signal_blocks.find(key);
 
-			case MP_RAILWAY:
-				if (IsRailDepot(tile)) {
-					/* 'optimization assert' do not try to update signals in other cases */
-					assert(dir == INVALID_DIAGDIR || dir == GetRailDepotDirection(tile));
-					_tbdset.Add(tile, INVALID_DIAGDIR); // start from depot inside
-					break;
-				}
-				/* FALL THROUGH */
-			case MP_STATION:
-			case MP_ROAD:
-				if ((TrackStatusToTrackBits(GetTileTrackStatus(tile, TRANSPORT_RAIL, 0)) & _enterdir_to_trackbits[dir]) != TRACK_BIT_NONE) {
-					/* only add to set when there is some 'interesting' track */
-					_tbdset.Add(tile, dir);
-					_tbdset.Add(tile + TileOffsByDiagDir(dir), ReverseDiagDir(dir));
-					break;
-				}
-				/* FALL THROUGH */
-			default:
-				/* jump to next tile */
-				tile = tile + TileOffsByDiagDir(dir);
-				dir = ReverseDiagDir(dir);
-				if ((TrackStatusToTrackBits(GetTileTrackStatus(tile, TRANSPORT_RAIL, 0)) & _enterdir_to_trackbits[dir]) != TRACK_BIT_NONE) {
-					_tbdset.Add(tile, dir);
+		if (cached != _signal_blocks.end()) {
+			/* the block has been explored from here before and the track layout did not change since */
+			flags = ReplaySegment(cached->second);
+		} else {
+			/* After updating signal, data stored are always MP_RAILWAY with signals.
+			 * Other situations happen when data are from outside functions -
+			 * modification of railbits (including both rail building and removal),
+			 * train entering/leaving block, train leaving depot...
+			 */
+			switch (GetTileType(tile)) {
+				case MP_TUNNELBRIDGE:
+					/* 'optimization assert' - do not try to update signals when it is not needed */
+					assert(GetTunnelBridgeTransportType(tile) == TRANSPORT_RAIL);
+					assert(dir == INVALID_DIAGDIR || dir == ReverseDiagDir(GetTunnelBridgeDirection(tile)));
+					_tbdset.Add(tile, INVALID_DIAGDIR);  // we can safely start from wormhole centre
+					_tbdset.Add(GetOtherTunnelBridgeEnd(tile), INVALID_DIAGDIR);
 					break;
-				}
-				/* happens when removing a rail that wasn't connected at one or both sides */
-				continue; // continue the while() loop
-		}
 
-		assert(!_tbdset.Overflowed()); // it really shouldn't overflow by these one or two items
-		assert(!_tbdset.IsEmpty()); // it wouldn't hurt anyone, but shouldn't happen too
+				case MP_RAILWAY:
+					if (IsRailDepot(tile)) {
+						/* 'optimization assert' do not try to update signals in other cases */
+						assert(dir == INVALID_DIAGDIR || dir == GetRailDepotDirection(tile));
+						_tbdset.Add(tile, INVALID_DIAGDIR); // start from depot inside
+						break;
+					}
+					/* FALL THROUGH */
+				case MP_STATION:
+				case MP_ROAD:
+					if ((TrackStatusToTrackBits(GetTileTrackStatus(tile, TRANSPORT_RAIL, 0)) & _enterdir_to_trackbits[dir]) != TRACK_BIT_NONE) {
+						/* only add to set when there is some 'interesting' track */
+						_tbdset.Add(tile, dir);
+						_tbdset.Add(tile + TileOffsByDiagDir(dir), ReverseDiagDir(dir));
+						break;
+					}
+					/* FALL THROUGH */
+				default:
+					/* jump to next tile */
+					tile = tile + TileOffsByDiagDir(dir);
+					dir = ReverseDiagDir(dir);
+					if ((TrackStatusToTrackBits(GetTileTrackStatus(tile, TRANSPORT_RAIL, 0)) & _enterdir_to_trackbits[dir]) != TRACK_BIT_NONE) {
+						_tbdset.Add(tile, dir);
+						break;
+					}
+					/* happens when removing a rail that wasn't connected at one or both sides */
+					continue; // continue the while() loop
+			}
+
+			assert(!_tbdset.Overflowed()); // it really shouldn't overflow by these one or two items
+			assert(!_tbdset.IsEmpty()); // it wouldn't hurt anyone, but shouldn't happen too
+
+			SignalBlock *block = new SignalBlock();
+			flags = ExploreSegment(owner, block);
 
-		SigFlags flags = ExploreSegment(owner);
+			if (flags & SF_FULL) {
+				delete block;
+			} else {
+				if (_signal_blocks.size() >= SIG_BLOCK_CACHE_SIZE) FlushSignalBlockCache();
+				_signal_blocks[key] = block;
+			}
+		}
 
 		if (first) {
 			first = false;
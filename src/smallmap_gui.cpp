@@ -284,6 +284,8 @@ void BuildLandLegend()
 	/* The smallmap window has never been initialized, so no need to change the legend. */
 	if (_heightmap_schemes[0].height_colours == NULL) return;
 
+	InvalidateSmallMapColours();
+
 	/*
 	 * The general idea of this function is to fill the legend with an appropriate evenly spaced
 	 * selection of height levels. All entries with STR_TINY_BLACK_HEIGHT are reserved for this.
@@ -600,6 +602,117 @@ static const byte _vehicle_type_colours[6] = {
 };
 
 
+/**
+ * Cache of the colours of the cells of the smallmap, i.e. the colours of the
+ * zoom x zoom tile areas, for one map type and zoom level. The cells are
+ * kept in blocks that are only allocated when they are drawn; cells are
+ * invalidated when their tiles are marked dirty, and the whole cache when
+ * anything else the colours depend on changes.
+ */
+struct SmallMapColourCache {
+	static const uint BLOCK_BITS = 6;                   ///< Number of bits of the cell coordinates within a block.
+	static const uint BLOCK_SIZE = 1 << BLOCK_BITS;     ///< Width and height of a block, in cells.
+
+	/** Colours of a block of cells. */
+	struct Block {
+		uint32 colours[BLOCK_SIZE * BLOCK_SIZE];        ///< Colours of the cells.
+		std::bitset<BLOCK_SIZE * BLOCK_SIZE> valid;     ///< Whether the colour of a cell is valid.
+	};
+
+	int map_type;                          ///< Map type of the cached colours.
+	int zoom;                              ///< Zoom level of the cached colours, or \c 0 when nothing is cached.
+	uint blocks_x;                         ///< Number of blocks in x direction.
+	uint blocks_y;                         ///< Number of blocks in y direction.
+	Block **blocks;                        ///< The blocks, \c NULL for blocks that have not been drawn yet.
+
+	/** Free all cached colours. */
+	void Free()
+	{
+		if (this->blocks != NULL) {
+			for (uint i = 0; i < this->blocks_x * this->blocks_y; i++) delete this->blocks[i];
+			free(this->blocks);
+		}
+		this->blocks = NULL;
+		this->zoom = 0;
+	}
+
+	/**
+	 * Make sure the cache is for the given map type and zoom level, and the current map.
+	 * @param map_type Map type of the smallmap.
+	 * @param zoom     Zoom level of the smallmap.
+	 */
+	void Validate(int map_type, int zoom)
+	{
+		uint blocks_x = CeilDiv(CeilDiv(MapSizeX(), zoom), BLOCK_SIZE);
+		uint blocks_y = CeilDiv(CeilDiv(MapSizeY(), zoom), BLOCK_SIZE);
+		if (this->zoom == zoom && this->map_type == map_type && this->blocks_x == blocks_x && this->blocks_y == blocks_y) return;
+
+		this->Free();
+		this->map_type = map_type;
+		this->zoom = zoom;
+		this->blocks_x = blocks_x;
+		this->blocks_y = blocks_y;
+		this->blocks = CallocT<Block *>(blocks_x * blocks_y);
+	}
+
+	/** Invalidate the colours of all cells. */
+	void InvalidateAll()
+	{
+		if (this->blocks == NULL) return;
+
+		for (uint i = 0; i < this->blocks_x * this->blocks_y; i++) {
+			if (this->blocks[i] != NULL) this->blocks[i]->valid.reset();
+		}
+	}
+
+	/**
+	 * Invalidate the colour of the cell containing a tile.
+	 * @param tile The tile.
+	 */
+	void InvalidateTile(TileIndex tile)
+	{
+		if (this->blocks == NULL) return;
+
+		uint cx = TileX(tile) / this->zoom;
+		uint cy = TileY(tile) / this->zoom;
+		Block *block = this->blocks[(cy >> BLOCK_BITS) * this->blocks_x + (cx >> BLOCK_BITS)];
+		if (block != NULL) block->valid.reset(((cy % BLOCK_SIZE) << BLOCK_BITS) + cx % BLOCK_SIZE);
+	}
+
+	/**
+	 * Get the block containing a cell, allocating it when needed.
+	 * @param cx X coordinate of the cell.
+	 * @param cy Y coordinate of the cell.
+	 * @param[out] index Index of the cell within the block.
+	 * @return The block.
+	 */
+	Block *GetBlock(uint cx, uint cy, uint *index)
+	{
+		Block *&block = this->blocks[(cy >> BLOCK_BITS) * this->blocks_x + (cx >> BLOCK_BITS)];
+		if (block == NULL) block = new Block();
+
+		*index = ((cy % BLOCK_SIZE) << BLOCK_BITS) + cx % BLOCK_SIZE;
+		return block;
+	}
+};
+
+static SmallMapColourCache _smallmap_colours; ///< Colours of the cells of the smallmap.
+
+/**
+ * Invalidate the cached smallmap colour of a tile, as its appearance changed.
+ * @param tile The tile.
+ */
+void InvalidateSmallMapTile(TileIndex tile)
+{
+	_smallmap_colours.InvalidateTile(tile);
+}
+
+/** Invalidate the cached smallmap colours of all tiles. */
+void InvalidateSmallMapColours()
+{
+	_smallmap_colours.InvalidateAll();
+}
+
 inline Point SmallMapWindow::SmallmapRemapCoords(int x, int y) const
 {
 	Point pt;
@@ -825,7 +938,19 @@ void SmallMapWindow::DrawSmallMapColumn(void *dst, uint xc, uint yc, int pitch,
 		}
 		ta.ClampToMap(); // Clamp to map boundaries (may contain MP_VOID tiles!).
 
-		uint32 val = this->GetTileColours(ta);
+		uint32 val;
+		if (xc % this->zoom == 0 && yc % this->zoom == 0) {
+			/* The area is a cell of the colour cache. */
+			uint index;
+			SmallMapColourCache::Block *block = _smallmap_colours.GetBlock(xc / this->zoom, yc / this->zoom, &index);
+			if (!block->valid.test(index)) {
+				block->colours[index] = this->GetTileColours(ta);
+				block->valid.set(index);
+			}
+			val = block->colours[index];
+		} else {
+			val = this->GetTileColours(ta);
+		}
 		uint8 *val8 = (uint8 *)&val;
 		int idx = max(0, -start_pos);
 		for (int pos = max(0, start_pos); pos < end_pos; pos++) {
@@ -947,6 +1072,8 @@ void SmallMapWindow::DrawSmallMap(DrawPixelInfo *dpi) const
 	/* Clear it */
 	GfxFillRect(dpi->left, dpi->top, dpi->left + dpi->width - 1, dpi->top + dpi->height - 1, PC_BLACK);
 
+	_smallmap_colours.Validate(this->map_type, this->zoom);
+
 	/* Which tile is displayed at (dpi->left, dpi->top)? */
 	int dx;
 	Point tile = this->PixelToTile(dpi->left, dpi->top, &dx);
@@ -1062,6 +1189,12 @@ SmallMapWindow::SmallMapWindow(WindowDesc *desc, int window_number) : Window(des
 	this->SetOverlayCargoMask();
 }
 
+SmallMapWindow::~SmallMapWindow()
+{
+	delete this->overlay;
+	_smallmap_colours.Free();
+}
+
 /**
  * Rebuilds the colour indices used for fast access to the smallmap contour colours based on the heightlevel.
  */
@@ -1070,6 +1203,8 @@ void SmallMapWindow::RebuildColourIndexIfNecessary()
 	/* Rebuild colour indices if necessary. */
 	if (SmallMapWindow::max_heightlevel == _settings_game.construction.max_heightlevel) return;
 
+	InvalidateSmallMapColours();
+
 	for (uint n = 0; n < lengthof(_heightmap_schemes); n++) {
 		/* The heights go from 0 up to and including maximum. */
 		int heights = _settings_game.construction.max_heightlevel + 1;
@@ -1367,6 +1502,7 @@ int SmallMapWindow::GetPositionOnLegend(Point pt)
 		_smallmap_industry_highlight = new_highlight;
 		this->refresh = _smallmap_industry_highlight != INVALID_INDUSTRYTYPE ? BLINK_PERIOD : FORCE_REFRESH_PERIOD;
 		_smallmap_industry_highlight_state = true;
+		InvalidateSmallMapColours();
 		this->SetDirty();
 	}
 }
@@ -1453,6 +1589,7 @@ int SmallMapWindow::GetPositionOnLegend(Point pt)
 						this->SelectLegendItem(click_pos, _legend_land_owners, _smallmap_company_count, NUM_NO_COMPANY_ENTRIES);
 					}
 				}
+				InvalidateSmallMapColours();
 				this->SetDirty();
 			}
 			break;
@@ -1478,6 +1615,7 @@ int SmallMapWindow::GetPositionOnLegend(Point pt)
 				tbl->show_on_map = (widget == WID_SM_ENABLE_ALL);
 			}
 			if (this->map_type == SMT_LINKSTATS) this->SetOverlayCargoMask();
+			InvalidateSmallMapColours();
 			this->SetDirty();
 			break;
 		}
@@ -1485,6 +1623,7 @@ int SmallMapWindow::GetPositionOnLegend(Point pt)
 		case WID_SM_SHOW_HEIGHT: // Enable/disable showing of heightmap.
 			_smallmap_show_heightmap = !_smallmap_show_heightmap;
 			this->SetWidgetLoweredState(WID_SM_SHOW_HEIGHT, _smallmap_show_heightmap);
+			InvalidateSmallMapColours();
 			this->SetDirty();
 			break;
 	}
@@ -1524,6 +1663,7 @@ int SmallMapWindow::GetPositionOnLegend(Point pt)
 
 		default: NOT_REACHED();
 	}
+	InvalidateSmallMapColours();
 	this->SetDirty();
 }
 
@@ -1562,6 +1702,8 @@ int SmallMapWindow::GetPositionOnLegend(Point pt)
 		}
 	}
 	_smallmap_industry_highlight_state = !_smallmap_industry_highlight_state;
+	/* Blinking changes the colours of the highlighted industries. */
+	if (this->map_type == SMT_INDUSTRY && _smallmap_industry_highlight != INVALID_INDUSTRYTYPE) InvalidateSmallMapColours();
 
 	this->refresh = _smallmap_industry_highlight != INVALID_INDUSTRYTYPE ? BLINK_PERIOD : FORCE_REFRESH_PERIOD;
 	this->SetDirty();
@@ -1598,6 +1740,12 @@ void SmallMapWindow::SetNewScroll(int sx, int sy, int sub)
 		sub = 0;
 	}
 
+	/* Keep the displayed tiles aligned to the zoom level, so the colours of the cells can be cached.
+	 * This moves the map less than a pixel, as a pixel shows 'zoom' tiles. */
+	int align = this->zoom * TILE_SIZE;
+	sx -= ((sx % align) + align) % align;
+	sy -= ((sy % align) + align) % align;
+
 	this->scroll_x = sx;
 	this->scroll_y = sy;
 	this->subscroll = sub;
@@ -19,6 +19,8 @@
 #include "blitter/factory.hpp"
 #include "core/math_func.hpp"
 #include "core/mem_func.hpp"
+#include "core/smallvec_type.hpp"
+#include "thread/thread.h"
 
 #include "table/sprites.h"
 #include "table/strings.h"
@@ -36,7 +38,8 @@ struct SpriteCache {
 	size_t file_pos;
 	uint32 id;
 	uint16 file_slot;
-	int16 lru;
+	bool referenced;     ///< Whether the sprite has been used since the clock hand passed it.
+	bool queued;         ///< Whether the sprite is waiting to be prefetched.
 	SpriteTypeByte type; ///< In some cases a single sprite is misused by two NewGRFs. Once as real sprite and once as recolour sprite. If the recolour sprite gets into the cache it might be drawn as real sprite which causes enormous trouble.
 	bool warned;         ///< True iff the user has been warned about incorrect use of this sprite
 	byte container_ver;  ///< Container version of the GRF the sprite is from.
@@ -76,18 +79,47 @@ static SpriteCache *AllocateSpriteCache(uint index)
 }
 
 
-struct MemBlock {
-	size_t size;
-	byte data[];
+/** Size of the slabs that the smaller sprites are allocated from. */
+static const size_t SPRITE_SLAB_SIZE = 64 * 1024;
+/** Largest block, including its header, that is allocated from a slab; larger blocks are allocated on their own. */
+static const size_t SPRITE_SLAB_MAX_BLOCK = 16 * 1024;
+/** Number of size classes of the blocks allocated from slabs. */
+static const uint SPRITE_SIZE_CLASSES = 37;
+
+struct SpriteSlab;
+
+/** Header in front of every block of sprite memory. */
+struct SpriteBlock {
+	SpriteSlab *slab; ///< Slab the block is part of, or \c NULL when the block has been allocated on its own.
+	size_t size;      ///< Size of the block including this header.
+	byte data[];      ///< The sprite data.
 };
 
-static uint _sprite_lru_counter;
-static MemBlock *_spritecache_ptr;
-static uint _allocated_sprite_cache_size = 0;
-static int _compact_cache_counter;
+/**
+ * A slab of memory that is divided into blocks of a single size class.
+ * Slabs with free blocks are kept in a list per size class.
+ */
+struct SpriteSlab {
+	SpriteSlab *prev;        ///< Previous slab of the size class with free blocks.
+	SpriteSlab *next;        ///< Next slab of the size class with free blocks.
+	SpriteBlock *free_block; ///< First block of the list of freed blocks; the next free block is stored in the data of the block.
+	uint16 size_class;       ///< Size class of the blocks.
+	uint16 used;             ///< Number of blocks in use.
+	uint16 carved;           ///< Number of blocks that have been handed out at least once.
+	uint16 capacity;         ///< Number of blocks that fit in the slab.
+	byte data[];             ///< The blocks.
+};
+
+static SpriteSlab *_sprite_slabs[SPRITE_SIZE_CLASSES]; ///< Per size class the slabs that have free blocks.
+static size_t _sprite_cache_budget;                    ///< Amount of sprite memory the cache tries to stay within.
+static SpriteCacheStats _sprite_cache_stats;           ///< Statistics of the sprite cache.
+static uint _sprite_clock_hand;                        ///< Next sprite that is considered for eviction.
+static SmallVector<SpriteBlock *, 64> _sprite_blocks_to_free; ///< Evicted blocks that still may be in use by a drawing thread.
+static ThreadMutex *_spritecache_mutex = NULL;         ///< Mutex serialising the loading of sprites into the cache.
+static bool _sprite_loading_in_background = false;     ///< Whether the prefetch thread is loading a sprite; only changed with the sprite cache mutex held.
 
-static void CompactSpriteCache();
 static void *AllocSprite(size_t mem_req);
+static void DeleteEntryFromSpriteCache(uint item);
 
 /**
  * Skip the given amount of sprite graphics data.
@@ -389,13 +421,13 @@ static void *ReadSprite(const SpriteCache *sc, SpriteID id, SpriteType sprite_ty
 	assert(IsMapgenSpriteID(id) == (sprite_type == ST_MAPGEN));
 	assert(sc->type == sprite_type);
 
-	DEBUG(sprite, 9, "Load sprite %d", id);
+	if (!_sprite_loading_in_background) DEBUG(sprite, 9, "Load sprite %d", id);
 
 	SpriteLoader::Sprite sprite[ZOOM_LVL_COUNT];
 	uint8 sprite_avail = 0;
 	sprite[ZOOM_LVL_NORMAL].type = sprite_type;
 
-	SpriteLoaderGrf sprite_loader(sc->container_ver);
+	SpriteLoaderGrf sprite_loader(sc->container_ver, _sprite_loading_in_background);
 	if (sprite_type != ST_MAPGEN && BlitterFactory::GetCurrentBlitter()->GetScreenDepth() == 32) {
 		/* Try for 32bpp sprites first. */
 		sprite_avail = sprite_loader.LoadSprite(sprite, file_slot, file_pos, sprite_type, true);
@@ -405,7 +437,8 @@ static void *ReadSprite(const SpriteCache *sc, SpriteID id, SpriteType sprite_ty
 	}
 
 	if (sprite_avail == 0) {
-		if (sprite_type == ST_MAPGEN) return NULL;
+		/* The prefetch thread leaves broken sprites to the main thread, which reports them. */
+		if (sprite_type == ST_MAPGEN || _sprite_loading_in_background) return NULL;
 		if (id == SPR_IMG_QUERY) usererror("Okay... something went horribly wrong. I couldn't load the fallback sprite. What should I do?");
 		return (void*)GetRawSprite(SPR_IMG_QUERY, ST_NORMAL, allocator);
 	}
@@ -439,6 +472,7 @@ static void *ReadSprite(const SpriteCache *sc, SpriteID id, SpriteType sprite_ty
 	}
 
 	if (!ResizeSprites(sprite, sprite_avail, file_slot, sc->id)) {
+		if (_sprite_loading_in_background) return NULL;
 		if (id == SPR_IMG_QUERY) usererror("Okay... something went horribly wrong. I couldn't resize the fallback sprite. What should I do?");
 		return (void*)GetRawSprite(SPR_IMG_QUERY, ST_NORMAL, allocator);
 	}
@@ -556,10 +590,12 @@ bool LoadNextSprite(int load_index, byte file_slot, uint file_sprite_id, byte co
 	}
 
 	SpriteCache *sc = AllocateSpriteCache(load_index);
+	/* Release the memory of the sprite that is overridden. */
+	if (sc->ptr != NULL) DeleteEntryFromSpriteCache(load_index);
 	sc->file_slot = file_slot;
 	sc->file_pos = file_pos;
 	sc->ptr = data;
-	sc->lru = 0;
+	sc->referenced = false;
 	sc->id = file_sprite_id;
 	sc->type = type;
 	sc->warned = false;
@@ -574,6 +610,7 @@ void DupSprite(SpriteID old_spr, SpriteID new_spr)
 	SpriteCache *scnew = AllocateSpriteCache(new_spr); // may reallocate: so put it first
 	SpriteCache *scold = GetSpriteCache(old_spr);
 
+	if (scnew->ptr != NULL) DeleteEntryFromSpriteCache(new_spr);
 	scnew->file_slot = scold->file_slot;
 	scnew->file_pos = scold->file_pos;
 	scnew->ptr = NULL;
@@ -583,189 +620,401 @@ void DupSprite(SpriteID old_spr, SpriteID new_spr)
 	scnew->container_ver = scold->container_ver;
 }
 
+assert_compile(sizeof(SpriteBlock) == 2 * sizeof(size_t));
+
 /**
- * S_FREE_MASK is used to mask-out lower bits of MemBlock::size
- * If they are non-zero, the block is free.
- * S_FREE_MASK has to ensure MemBlock is correctly aligned -
- * it means 8B (S_FREE_MASK == 7) on 64bit systems!
+ * Get the size class of a block. The classes are 32 bytes and then four
+ * classes per power of two, i.e. 40, 48, 56, 64, 80, 96, ..., 16384 bytes,
+ * so at most 25% of a block is wasted.
+ * @param size Size of the block including its header; at most #SPRITE_SLAB_MAX_BLOCK.
+ * @return The size class.
  */
-static const size_t S_FREE_MASK = sizeof(size_t) - 1;
+static inline uint GetSizeClass(size_t size)
+{
+	assert(size <= SPRITE_SLAB_MAX_BLOCK);
+	if (size <= 32) return 0;
 
-/* to make sure nobody adds things to MemBlock without checking S_FREE_MASK first */
-assert_compile(sizeof(MemBlock) == sizeof(size_t));
-/* make sure it's a power of two */
-assert_compile((sizeof(size_t) & (sizeof(size_t) - 1)) == 0);
+	uint bit = FindLastBit(size - 1);
+	uint steps = (uint)((size - 1) >> (bit - 2));
+	return 1 + (bit - 5) * 4 + (steps - 4);
+}
 
-static inline MemBlock *NextBlock(MemBlock *block)
+/**
+ * Get the size of the blocks of a size class.
+ * @param size_class The size class.
+ * @return Size of the blocks, including their header.
+ */
+static inline size_t GetSizeClassSize(uint size_class)
 {
-	return (MemBlock*)((byte*)block + (block->size & ~S_FREE_MASK));
+	assert(size_class < SPRITE_SIZE_CLASSES);
+	if (size_class == 0) return 32;
+
+	uint bit = 5 + (size_class - 1) / 4;
+	uint steps = 4 + (size_class - 1) % 4;
+	return (size_t)(steps + 1) << (bit - 2);
 }
 
-static size_t GetSpriteCacheUsage()
+/**
+ * Add a slab to the front of the list of slabs with free blocks.
+ * @param slab The slab to add.
+ */
+static void LinkSpriteSlab(SpriteSlab *slab)
 {
-	size_t tot_size = 0;
-	MemBlock *s;
+	slab->prev = NULL;
+	slab->next = _sprite_slabs[slab->size_class];
+	if (slab->next != NULL) slab->next->prev = slab;
+	_sprite_slabs[slab->size_class] = slab;
+}
 
-	for (s = _spritecache_ptr; s->size != 0; s = NextBlock(s)) {
-		if (!(s->size & S_FREE_MASK)) tot_size += s->size;
+/**
+ * Remove a slab from the list of slabs with free blocks.
+ * @param slab The slab to remove.
+ */
+static void UnlinkSpriteSlab(SpriteSlab *slab)
+{
+	if (slab->prev != NULL) {
+		slab->prev->next = slab->next;
+	} else {
+		_sprite_slabs[slab->size_class] = slab->next;
 	}
-
-	return tot_size;
+	if (slab->next != NULL) slab->next->prev = slab->prev;
+	slab->prev = slab->next = NULL;
 }
 
-
-void IncreaseSpriteLRU()
+/**
+ * Allocate a block of a size class from a slab, allocating a new slab when all are full.
+ * @param size_class The size class of the block.
+ * @return The block.
+ */
+static SpriteBlock *AllocSlabBlock(uint size_class)
 {
-	/* Increase all LRU values */
-	if (_sprite_lru_counter > 16384) {
-		SpriteID i;
-
-		DEBUG(sprite, 3, "Fixing lru %u, inuse=" PRINTF_SIZE, _sprite_lru_counter, GetSpriteCacheUsage());
-
-		for (i = 0; i != _spritecache_items; i++) {
-			SpriteCache *sc = GetSpriteCache(i);
-			if (sc->ptr != NULL) {
-				if (sc->lru >= 0) {
-					sc->lru = -1;
-				} else if (sc->lru != -32768) {
-					sc->lru--;
-				}
-			}
-		}
-		_sprite_lru_counter = 0;
+	size_t size = GetSizeClassSize(size_class);
+
+	SpriteSlab *slab = _sprite_slabs[size_class];
+	if (slab == NULL) {
+		slab = (SpriteSlab *)MallocT<byte>(SPRITE_SLAB_SIZE);
+		slab->free_block = NULL;
+		slab->size_class = size_class;
+		slab->used = 0;
+		slab->carved = 0;
+		slab->capacity = (uint16)((SPRITE_SLAB_SIZE - sizeof(SpriteSlab)) / size);
+		LinkSpriteSlab(slab);
+		_sprite_cache_stats.slabs++;
 	}
 
-	/* Compact sprite cache every now and then. */
-	if (++_compact_cache_counter >= 740) {
-		CompactSpriteCache();
-		_compact_cache_counter = 0;
+	SpriteBlock *block;
+	if (slab->free_block != NULL) {
+		block = slab->free_block;
+		slab->free_block = *(SpriteBlock **)block->data;
+	} else {
+		block = (SpriteBlock *)(slab->data + slab->carved * size);
+		slab->carved++;
 	}
+
+	if (++slab->used == slab->capacity) UnlinkSpriteSlab(slab);
+
+	block->slab = slab;
+	block->size = size;
+	return block;
 }
 
 /**
- * Called when holes in the sprite cache should be removed.
- * That is accomplished by moving the cached data.
+ * Return the memory of a block to its slab, or to the system when it has
+ * been allocated on its own. Slabs without blocks in use are released.
+ * @param block The block to free.
  */
-static void CompactSpriteCache()
+static void FreeSpriteBlock(SpriteBlock *block)
 {
-	MemBlock *s;
-
-	DEBUG(sprite, 3, "Compacting sprite cache, inuse=" PRINTF_SIZE, GetSpriteCacheUsage());
-
-	for (s = _spritecache_ptr; s->size != 0;) {
-		if (s->size & S_FREE_MASK) {
-			MemBlock *next = NextBlock(s);
-			MemBlock temp;
-			SpriteID i;
+	SpriteSlab *slab = block->slab;
+	if (slab == NULL) {
+		free(block);
+		_sprite_cache_stats.large_blocks--;
+		return;
+	}
 
-			/* Since free blocks are automatically coalesced, this should hold true. */
-			assert(!(next->size & S_FREE_MASK));
+	*(SpriteBlock **)block->data = slab->free_block;
+	slab->free_block = block;
 
-			/* If the next block is the sentinel block, we can safely return */
-			if (next->size == 0) break;
+	/* A full slab is not in the list of slabs with free blocks. */
+	if (slab->used-- == slab->capacity) LinkSpriteSlab(slab);
 
-			/* Locate the sprite belonging to the next pointer. */
-			for (i = 0; GetSpriteCache(i)->ptr != next->data; i++) {
-				assert(i != _spritecache_items);
-			}
+	if (slab->used == 0) {
+		UnlinkSpriteSlab(slab);
+		free(slab);
+		_sprite_cache_stats.slabs--;
+	}
+}
 
-			GetSpriteCache(i)->ptr = s->data; // Adjust sprite array entry
-			/* Swap this and the next block */
-			temp = *s;
-			memmove(s, next, next->size);
-			s = NextBlock(s);
-			*s = temp;
+/**
+ * Free the memory of the sprites that have been removed from the cache.
+ * Drawing may still use sprites after they have been evicted, so this
+ * is only done once per game loop, when no sprites are being drawn.
+ */
+void ReleaseEvictedSprites()
+{
+	if (_sprite_blocks_to_free.Length() == 0) return;
 
-			/* Coalesce free blocks */
-			while (NextBlock(s)->size & S_FREE_MASK) {
-				s->size += NextBlock(s)->size & ~S_FREE_MASK;
-			}
-		} else {
-			s = NextBlock(s);
-		}
+	_spritecache_mutex->BeginCritical(true);
+	for (SpriteBlock **block = _sprite_blocks_to_free.Begin(); block != _sprite_blocks_to_free.End(); block++) {
+		FreeSpriteBlock(*block);
 	}
+	_sprite_blocks_to_free.Clear();
+	_spritecache_mutex->EndCritical(true);
 }
 
 /**
  * Delete a single entry from the sprite cache.
+ * The memory of the sprite is freed by the next call to #ReleaseEvictedSprites.
  * @param item Entry to delete.
  */
 static void DeleteEntryFromSpriteCache(uint item)
 {
-	/* Mark the block as free (the block must be in use) */
-	MemBlock *s = (MemBlock*)GetSpriteCache(item)->ptr - 1;
-	assert(!(s->size & S_FREE_MASK));
-	s->size |= S_FREE_MASK;
-	GetSpriteCache(item)->ptr = NULL;
-
-	/* And coalesce adjacent free blocks */
-	for (s = _spritecache_ptr; s->size != 0; s = NextBlock(s)) {
-		if (s->size & S_FREE_MASK) {
-			while (NextBlock(s)->size & S_FREE_MASK) {
-				s->size += NextBlock(s)->size & ~S_FREE_MASK;
-			}
-		}
-	}
+	SpriteCache *sc = GetSpriteCache(item);
+	SpriteBlock *block = (SpriteBlock *)sc->ptr - 1;
+	sc->ptr = NULL;
+
+	_sprite_cache_stats.used -= block->size;
+	*_sprite_blocks_to_free.Append() = block;
 }
 
-static void DeleteEntryFromSpriteCache()
+/**
+ * Evict a sprite from the cache using the CLOCK algorithm: the hand sweeps
+ * over the cached sprites, and the first one that has not been used since
+ * the previous sweep is evicted. Recolour sprites are never evicted.
+ * @return Whether a sprite has been evicted.
+ */
+static bool EvictSprite()
 {
-	uint best = UINT_MAX;
-	int cur_lru;
+	/* Within two sweeps all reference bits have been cleared. */
+	for (uint i = 0; i < 2 * _spritecache_items; i++) {
+		if (_sprite_clock_hand >= _spritecache_items) _sprite_clock_hand = 0;
 
-	DEBUG(sprite, 3, "DeleteEntryFromSpriteCache, inuse=" PRINTF_SIZE, GetSpriteCacheUsage());
+		uint item = _sprite_clock_hand++;
+		SpriteCache *sc = GetSpriteCache(item);
+		if (sc->type == ST_RECOLOUR || sc->ptr == NULL) continue;
 
-	cur_lru = 0xffff;
-	for (SpriteID i = 0; i != _spritecache_items; i++) {
-		SpriteCache *sc = GetSpriteCache(i);
-		if (sc->type != ST_RECOLOUR && sc->ptr != NULL && sc->lru < cur_lru) {
-			cur_lru = sc->lru;
-			best = i;
+		if (sc->referenced) {
+			sc->referenced = false;
+			continue;
 		}
-	}
 
-	/* Display an error message and die, in case we found no sprite at all.
-	 * This shouldn't really happen, unless all sprites are locked. */
-	if (best == UINT_MAX) error("Out of sprite memory");
+		if (!_sprite_loading_in_background) DEBUG(sprite, 4, "Evicting sprite %u, inuse=" PRINTF_SIZE, item, _sprite_cache_stats.used);
+		DeleteEntryFromSpriteCache(item);
+		_sprite_cache_stats.evictions++;
+		return true;
+	}
 
-	DeleteEntryFromSpriteCache(best);
+	return false;
 }
 
 static void *AllocSprite(size_t mem_req)
 {
-	mem_req += sizeof(MemBlock);
+	size_t size = Align(mem_req + sizeof(SpriteBlock), sizeof(size_t));
+	uint size_class = 0;
+	if (size <= SPRITE_SLAB_MAX_BLOCK) {
+		size_class = GetSizeClass(size);
+		size = GetSizeClassSize(size_class);
+	}
 
-	/* Align this to correct boundary. This also makes sure at least one
-	 * bit is not used, so we can use it for other things. */
-	mem_req = Align(mem_req, S_FREE_MASK + 1);
+	_spritecache_mutex->BeginCritical(true);
 
-	for (;;) {
-		MemBlock *s;
+	/* Make room; when nothing can be evicted anymore the budget is exceeded instead. */
+	while (_sprite_cache_stats.used + size > _sprite_cache_budget && EvictSprite()) {}
 
-		for (s = _spritecache_ptr; s->size != 0; s = NextBlock(s)) {
-			if (s->size & S_FREE_MASK) {
-				size_t cur_size = s->size & ~S_FREE_MASK;
+	SpriteBlock *block;
+	if (size <= SPRITE_SLAB_MAX_BLOCK) {
+		block = AllocSlabBlock(size_class);
+	} else {
+		block = (SpriteBlock *)MallocT<byte>(size);
+		block->slab = NULL;
+		block->size = size;
+		_sprite_cache_stats.large_blocks++;
+	}
+	_sprite_cache_stats.used += size;
+
+	_spritecache_mutex->EndCritical(true);
+
+	return block->data;
+}
+
+/**
+ * Get the statistics of the sprite cache.
+ * @return The statistics.
+ */
+const SpriteCacheStats &GetSpriteCacheStats()
+{
+	_sprite_cache_stats.budget = _sprite_cache_budget;
+	return _sprite_cache_stats;
+}
+
+/** Reset the hit, miss, eviction and prefetch counters of the sprite cache. */
+void ResetSpriteCacheStats()
+{
+	_sprite_cache_stats.hits = 0;
+	_sprite_cache_stats.misses = 0;
+	_sprite_cache_stats.evictions = 0;
+	_sprite_cache_stats.prefetched = 0;
+}
 
-				/* Is the block exactly the size we need or
-				 * big enough for an additional free block? */
-				if (cur_size == mem_req ||
-						cur_size >= mem_req + sizeof(MemBlock)) {
-					/* Set size and in use */
-					s->size = mem_req;
+/** Maximum number of sprites waiting to be prefetched. */
+static const uint SPRITE_PREFETCH_QUEUE_SIZE = 4096;
+/** Number of sprites following a sprite that had to be loaded that are prefetched. */
+static const uint SPRITE_PREFETCH_READ_AHEAD = 8;
 
-					/* Do we need to inject a free block too? */
-					if (cur_size != mem_req) {
-						NextBlock(s)->size = (cur_size - mem_req) | S_FREE_MASK;
-					}
+static ThreadObject *_sprite_prefetch_thread = NULL; ///< Thread loading sprites in the background, if any.
+static ThreadMutex *_sprite_prefetch_mutex = NULL;   ///< Mutex protecting the queue of sprites to prefetch.
+static SmallVector<SpriteID, 256> _sprite_prefetch_queue; ///< Sprites to load in the background.
+static bool _sprite_prefetch_stop = false;           ///< Whether the prefetch thread has to stop; protected by the queue mutex.
 
-					return s->data;
+/**
+ * Whether a sprite can be loaded by the prefetch thread. Only normal sprites
+ * from memory mapped files can be, as the position and buffer of the Fio slot
+ * layer may only be used by the main thread.
+ * @param sc The sprite.
+ * @return True if the sprite can be loaded in the background.
+ * @pre The prefetch thread holds #FioLockSlots when it calls this.
+ */
+static bool CanPrefetchSprite(const SpriteCache *sc)
+{
+	size_t size;
+	return sc->type == ST_NORMAL && sc->ptr == NULL && FioGetMappedData(sc->file_slot, sc->file_pos, &size) != NULL;
+}
+
+/**
+ * Entry point of the prefetch thread: load the queued sprites into the cache,
+ * the most recently queued first, until the thread is told to stop. The sprite
+ * cache mutex is taken before the queue mutex, like when the queue is cleared,
+ * so the queue cannot be cleared while a sprite is taken from the queue.
+ * The files are kept open and mapped while the sprite is decoded.
+ */
+static void SpritePrefetchThread(void *)
+{
+	for (;;) {
+		_sprite_prefetch_mutex->BeginCritical();
+		while (_sprite_prefetch_queue.Length() == 0 && !_sprite_prefetch_stop) _sprite_prefetch_mutex->WaitForSignal();
+		bool stop = _sprite_prefetch_stop;
+		_sprite_prefetch_mutex->EndCritical();
+		if (stop) return;
+
+		_spritecache_mutex->BeginCritical(true);
+		_sprite_prefetch_mutex->BeginCritical();
+		SpriteCache *sc = NULL;
+		SpriteID sprite = 0;
+		if (_sprite_prefetch_queue.Length() != 0) {
+			sprite = *_sprite_prefetch_queue.Get(_sprite_prefetch_queue.Length() - 1);
+			_sprite_prefetch_queue.Erase(_sprite_prefetch_queue.End() - 1);
+			sc = GetSpriteCache(sprite);
+			sc->queued = false;
+		}
+		_sprite_prefetch_mutex->EndCritical();
+
+		/* Loading a sprite excludes drawing only from loading sprites itself; cache hits go on. */
+		if (sc != NULL) {
+			FioLockSlots();
+			if (CanPrefetchSprite(sc)) {
+				_sprite_loading_in_background = true;
+				sc->ptr = ReadSprite(sc, sprite, ST_NORMAL, AllocSprite);
+				_sprite_loading_in_background = false;
+				if (sc->ptr != NULL) {
+					sc->referenced = true;
+					_sprite_cache_stats.prefetched++;
 				}
 			}
+			FioUnlockSlots();
 		}
+		_spritecache_mutex->EndCritical(true);
+	}
+}
+
+/**
+ * Start loading sprites in the background, when there is a core to spare and
+ * sprites are drawn at all. Only sprites that follow a sprite that had to be
+ * loaded are loaded in the background; what is around the viewports is not
+ * looked at.
+ */
+void GfxStartSpritePrefetch()
+{
+	if (_sprite_prefetch_thread != NULL) return;
+	if (BlitterFactory::GetCurrentBlitter()->GetScreenDepth() == 0 || GetCPUCoreCount() <= 1) return;
+
+	if (_sprite_prefetch_mutex == NULL) _sprite_prefetch_mutex = ThreadMutex::New();
+	_sprite_prefetch_stop = false;
+	if (!ThreadObject::New(&SpritePrefetchThread, NULL, &_sprite_prefetch_thread)) {
+		DEBUG(sprite, 1, "Can't create sprite prefetch thread, sprites are only loaded when drawn");
+		_sprite_prefetch_thread = NULL;
+	}
+}
+
+/**
+ * Stop loading sprites in the background and wait for the prefetch thread to end.
+ * The sprites that were still queued are not loaded.
+ * @pre The sprite cache mutex is not held, so the thread can finish the sprite it is loading.
+ */
+void GfxStopSpritePrefetch()
+{
+	if (_sprite_prefetch_thread == NULL) return;
+
+	_sprite_prefetch_mutex->BeginCritical();
+	_sprite_prefetch_stop = true;
+	_sprite_prefetch_mutex->SendSignal();
+	_sprite_prefetch_mutex->EndCritical();
+
+	_sprite_prefetch_thread->Join();
+	delete _sprite_prefetch_thread;
+	_sprite_prefetch_thread = NULL;
+}
 
-		/* Reached sentinel, but no block found yet. Delete some old entry. */
-		DeleteEntryFromSpriteCache();
+/**
+ * Queue a sprite to be loaded into the cache in the background.
+ * Nothing happens when the sprite is cached already, is queued already,
+ * cannot be loaded in the background, or the queue is full.
+ * @param sprite The sprite to prefetch.
+ */
+void PrefetchSprite(SpriteID sprite)
+{
+	if (_sprite_prefetch_thread == NULL || !SpriteExists(sprite)) return;
+
+	SpriteCache *sc = GetSpriteCache(sprite);
+	if (!CanPrefetchSprite(sc)) return;
+
+	_sprite_prefetch_mutex->BeginCritical();
+	if (!sc->queued && _sprite_prefetch_queue.Length() < SPRITE_PREFETCH_QUEUE_SIZE) {
+		sc->queued = true;
+		*_sprite_prefetch_queue.Append() = sprite;
+		_sprite_prefetch_mutex->SendSignal();
 	}
+	_sprite_prefetch_mutex->EndCritical();
+}
+
+/**
+ * Lock the buffers used for decoding and encoding sprites, when sprites are
+ * encoded outside of loading them from a GRF. This excludes the prefetch thread.
+ */
+void LockSpriteEncoding()
+{
+	if (_spritecache_mutex != NULL) _spritecache_mutex->BeginCritical(true);
+}
+
+/** Unlock the buffers used for decoding and encoding sprites. */
+void UnlockSpriteEncoding()
+{
+	if (_spritecache_mutex != NULL) _spritecache_mutex->EndCritical(true);
+}
+
+/**
+ * Remove all sprites from the prefetch queue.
+ * @pre The sprite cache mutex is held, so the prefetch thread is not loading a sprite.
+ */
+static void ClearSpritePrefetchQueue()
+{
+	if (_sprite_prefetch_mutex == NULL) return;
+
+	_sprite_prefetch_mutex->BeginCritical();
+	for (SpriteID *sprite = _sprite_prefetch_queue.Begin(); sprite != _sprite_prefetch_queue.End(); sprite++) {
+		if (*sprite < _spritecache_items) GetSpriteCache(*sprite)->queued = false;
+	}
+	_sprite_prefetch_queue.Clear();
+	_sprite_prefetch_mutex->EndCritical();
 }
 
 /**
@@ -839,82 +1088,72 @@ void *GetRawSprite(SpriteID sprite, SpriteType type, AllocatorProc *allocator)
 
 	if (allocator == NULL) {
 		/* Load sprite into/from spritecache */
+		void *ptr = sc->ptr;
+		if (ptr != NULL) {
+			/* Cache hit; evicted sprites stay valid until the next game loop, so no locking is needed. */
+			sc->referenced = true;
+			_sprite_cache_stats.hits++;
+			return ptr;
+		}
 
-		/* Update LRU */
-		sc->lru = ++_sprite_lru_counter;
+		/* Load the sprite; another thread might have done so in the meantime. */
+		_spritecache_mutex->BeginCritical(true);
+		bool miss = sc->ptr == NULL;
+		if (miss) {
+			_sprite_cache_stats.misses++;
+			sc->ptr = ReadSprite(sc, sprite, type, AllocSprite);
+		}
+		sc->referenced = true;
+		ptr = sc->ptr;
+		_spritecache_mutex->EndCritical(true);
 
-		/* Load the sprite, if it is not loaded, yet */
-		if (sc->ptr == NULL) sc->ptr = ReadSprite(sc, sprite, type, AllocSprite);
+		/* Sprites that are drawn together, like the views of a vehicle, usually follow each other. */
+		if (miss && type == ST_NORMAL) {
+			for (uint i = 1; i <= SPRITE_PREFETCH_READ_AHEAD; i++) PrefetchSprite(sprite + i);
+		}
 
-		return sc->ptr;
+		return ptr;
 	} else {
-		/* Do not use the spritecache, but a different allocator. */
-		return ReadSprite(sc, sprite, type, allocator);
+		/* Do not use the spritecache, but a different allocator.
+		 * Loading uses shared buffers, so it still has to exclude the prefetch thread. */
+		_spritecache_mutex->BeginCritical(true);
+		void *ptr = ReadSprite(sc, sprite, type, allocator);
+		_spritecache_mutex->EndCritical(true);
+		return ptr;
 	}
 }
 
 
 static void GfxInitSpriteCache()
 {
-	/* initialize sprite cache heap */
+	/* Determine the budget of the sprite cache; memory is allocated when needed. */
 	int bpp = BlitterFactory::GetCurrentBlitter()->GetScreenDepth();
-	uint target_size = (bpp > 0 ? _sprite_cache_size * bpp / 8 : 1) * 1024 * 1024;
-
-	/* Remember 'target_size' from the previous allocation attempt, so we do not try to reach the target_size multiple times in case of failure. */
-	static uint last_alloc_attempt = 0;
+	_sprite_cache_budget = (bpp > 0 ? _sprite_cache_size * bpp / 8 : 1) * 1024 * 1024;
 
-	if (_spritecache_ptr == NULL || (_allocated_sprite_cache_size != target_size && target_size != last_alloc_attempt)) {
-		delete[] reinterpret_cast<byte *>(_spritecache_ptr);
-
-		last_alloc_attempt = target_size;
-		_allocated_sprite_cache_size = target_size;
-
-		do {
-			try {
-				/* Try to allocate 50% more to make sure we do not allocate almost all available. */
-				_spritecache_ptr = reinterpret_cast<MemBlock *>(new byte[_allocated_sprite_cache_size + _allocated_sprite_cache_size / 2]);
-			} catch (std::bad_alloc &) {
-				_spritecache_ptr = NULL;
-			}
-
-			if (_spritecache_ptr != NULL) {
-				/* Allocation succeeded, but we wanted less. */
-				delete[] reinterpret_cast<byte *>(_spritecache_ptr);
-				_spritecache_ptr = reinterpret_cast<MemBlock *>(new byte[_allocated_sprite_cache_size]);
-			} else if (_allocated_sprite_cache_size < 2 * 1024 * 1024) {
-				usererror("Cannot allocate spritecache");
-			} else {
-				/* Try again to allocate half. */
-				_allocated_sprite_cache_size >>= 1;
-			}
-		} while (_spritecache_ptr == NULL);
-
-		if (_allocated_sprite_cache_size != target_size) {
-			DEBUG(misc, 0, "Not enough memory to allocate %d MiB of spritecache. Spritecache was reduced to %d MiB.", target_size / 1024 / 1024, _allocated_sprite_cache_size / 1024 / 1024);
-
-			ErrorMessageData msg(STR_CONFIG_ERROR_OUT_OF_MEMORY, STR_CONFIG_ERROR_SPRITECACHE_TOO_BIG);
-			msg.SetDParam(0, target_size);
-			msg.SetDParam(1, _allocated_sprite_cache_size);
-			ScheduleErrorMessage(msg);
-		}
-	}
-
-	/* A big free block */
-	_spritecache_ptr->size = (_allocated_sprite_cache_size - sizeof(MemBlock)) | S_FREE_MASK;
-	/* Sentinel block (identified by size == 0) */
-	NextBlock(_spritecache_ptr)->size = 0;
+	if (_spritecache_mutex == NULL) _spritecache_mutex = ThreadMutex::New();
 }
 
 void GfxInitSpriteMem()
 {
+	/* The sprites are loaded again; the prefetch thread is started when that is done. */
+	GfxStopSpritePrefetch();
 	GfxInitSpriteCache();
 
+	/* Free all sprites, including the recolour sprites. */
+	_spritecache_mutex->BeginCritical(true);
+	ClearSpritePrefetchQueue();
+	for (uint i = 0; i != _spritecache_items; i++) {
+		if (GetSpriteCache(i)->ptr != NULL) DeleteEntryFromSpriteCache(i);
+	}
+	_spritecache_mutex->EndCritical(true);
+	ReleaseEvictedSprites();
+
 	/* Reset the spritecache 'pool' */
 	free(_spritecache);
 	_spritecache_items = 0;
 	_spritecache = NULL;
 
-	_compact_cache_counter = 0;
+	_sprite_clock_hand = 0;
 }
 
 /**
@@ -923,11 +1162,20 @@ void GfxInitSpriteMem()
  */
 void GfxClearSpriteCache()
 {
+	/* The blitter might have changed, so restart the prefetch thread when it is allowed to run. */
+	bool prefetch = _sprite_prefetch_thread != NULL;
+	GfxStopSpritePrefetch();
+
 	/* Clear sprite ptr for all cached items */
+	_spritecache_mutex->BeginCritical(true);
+	ClearSpritePrefetchQueue();
 	for (uint i = 0; i != _spritecache_items; i++) {
 		SpriteCache *sc = GetSpriteCache(i);
 		if (sc->type != ST_RECOLOUR && sc->ptr != NULL) DeleteEntryFromSpriteCache(i);
 	}
+	_spritecache_mutex->EndCritical(true);
+
+	if (prefetch) GfxStartSpritePrefetch();
 }
 
 /* static */ ReusableBuffer<SpriteLoader::CommonPixel> SpriteLoader::Sprite::buffer[ZOOM_LVL_COUNT];
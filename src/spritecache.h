@@ -23,6 +23,18 @@ struct Sprite {
 	byte data[];   ///< Sprite data.
 };
 
+/** Statistics of the sprite cache. */
+struct SpriteCacheStats {
+	uint64 hits;       ///< Number of requests for sprites that were in the cache.
+	uint64 misses;     ///< Number of requests for sprites that had to be loaded.
+	uint64 evictions;  ///< Number of sprites removed from the cache to make room for others.
+	uint64 prefetched; ///< Number of sprites loaded in the background because a preceding sprite had to be loaded.
+	size_t used;       ///< Bytes of sprite memory in use, including the unused parts of the blocks.
+	size_t budget;     ///< Bytes of sprite memory the cache tries to stay within.
+	uint slabs;        ///< Number of allocated slabs.
+	uint large_blocks; ///< Number of blocks that are too large for a slab.
+};
+
 extern uint _sprite_cache_size;
 
 typedef void *AllocatorProc(size_t size);
@@ -49,7 +61,14 @@ static inline const byte *GetNonSprite(SpriteID sprite, SpriteType type)
 
 void GfxInitSpriteMem();
 void GfxClearSpriteCache();
-void IncreaseSpriteLRU();
+void ReleaseEvictedSprites();
+const SpriteCacheStats &GetSpriteCacheStats();
+void ResetSpriteCacheStats();
+void PrefetchSprite(SpriteID sprite);
+void GfxStartSpritePrefetch();
+void GfxStopSpritePrefetch();
+void LockSpriteEncoding();
+void UnlockSpriteEncoding();
 
 void ReadGRFSpriteOffsets(byte container_version);
 size_t GetGRFSpriteOffset(uint32 id);
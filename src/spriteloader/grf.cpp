@@ -34,16 +34,132 @@ enum SpriteColourComponent {
 };
 DECLARE_ENUM_AS_BIT_SET(SpriteColourComponent)
 
+/**
+ * Reader of the data of a sprite. The data of memory mapped files is decoded
+ * directly from the mapping, without touching the shared position and buffer
+ * of the Fio slot layer; other files are read through the Fio slot layer,
+ * which only the main thread may do.
+ */
+class SpriteDataReader {
+	const byte *data;  ///< Current position in the mapped data, or \c NULL when reading through the Fio slot layer.
+	const byte *start; ///< Start of the mapped data.
+	const byte *end;   ///< End of the mapped data.
+	size_t start_pos;  ///< Position in the file of the start of the mapped data.
+	bool quiet;        ///< Whether problems with the sprite are not reported.
+
+public:
+	/**
+	 * Start reading at the given position of a file.
+	 * @param file_slot File slot.
+	 * @param file_pos File position.
+	 * @param quiet Whether problems with the sprite are not reported.
+	 * @pre Sprites read quietly, i.e. not by the main thread, are in memory mapped files.
+	 */
+	SpriteDataReader(uint8 file_slot, size_t file_pos, bool quiet) : end(NULL), start_pos(file_pos), quiet(quiet)
+	{
+		size_t size = 0;
+		this->start = this->data = FioGetMappedData(file_slot, file_pos, &size);
+		if (this->data == NULL) {
+			assert(!quiet);
+			FioSeekToFile(file_slot, file_pos);
+		} else {
+			this->end = this->data + size;
+		}
+	}
+
+	/**
+	 * Read a byte.
+	 * @return Read byte, or 0 when reading past the end of the file.
+	 */
+	inline byte ReadByte()
+	{
+		if (this->data == NULL) return FioReadByte();
+		return this->data < this->end ? *this->data++ : 0;
+	}
+
+	/**
+	 * Read a word (16 bits) in low endian format.
+	 * @return Read word.
+	 */
+	inline uint16 ReadWord()
+	{
+		byte b = this->ReadByte();
+		return (this->ReadByte() << 8) | b;
+	}
+
+	/**
+	 * Read a double word (32 bits) in low endian format.
+	 * @return Read double word.
+	 */
+	inline uint32 ReadDword()
+	{
+		uint b = this->ReadWord();
+		return (this->ReadWord() << 16) | b;
+	}
+
+	/**
+	 * Read a block of bytes; bytes past the end of the file are read as 0.
+	 * @param dest Destination buffer.
+	 * @param size Number of bytes to read.
+	 */
+	inline void ReadBlock(byte *dest, size_t size)
+	{
+		if (this->data == NULL) {
+			for (; size > 0; size--) *dest++ = FioReadByte();
+			return;
+		}
+
+		size_t available = min<size_t>(size, this->end - this->data);
+		memcpy(dest, this->data, available);
+		memset(dest + available, 0, size - available);
+		this->data += available;
+	}
+
+	/**
+	 * Skip bytes ahead.
+	 * @param n Number of bytes to skip.
+	 */
+	inline void SkipBytes(int n)
+	{
+		if (this->data == NULL) {
+			FioSkipBytes(n);
+		} else if (n > 0) {
+			this->data += min<size_t>(n, this->end - this->data);
+		}
+	}
+
+	/**
+	 * Get the current position in the file.
+	 * @return Position in the file.
+	 */
+	inline size_t GetPos() const
+	{
+		return this->data == NULL ? FioGetPos() : this->start_pos + (this->data - this->start);
+	}
+
+	/**
+	 * Whether problems with the sprite are not reported, as it is not read by the main thread.
+	 * @return True if problems are not reported.
+	 */
+	inline bool IsQuiet() const
+	{
+		return this->quiet;
+	}
+};
+
 /**
  * We found a corrupted sprite. This means that the sprite itself
  * contains invalid data or is too small for the given dimensions.
+ * @param reader the reader of the sprite; nothing is reported when it is quiet
  * @param file_slot the file the errored sprite is in
  * @param file_pos the location in the file of the errored sprite
  * @param line the line where the error occurs.
  * @return always false (to tell loading the sprite failed)
  */
-static bool WarnCorruptSprite(uint8 file_slot, size_t file_pos, int line)
+static bool WarnCorruptSprite(const SpriteDataReader &reader, uint8 file_slot, size_t file_pos, int line)
 {
+	if (reader.IsQuiet()) return false;
+
 	static byte warning_level = 0;
 	if (warning_level == 0) {
 		SetDParamStr(0, FioGetFilename(file_slot));
@@ -57,6 +173,7 @@ static bool WarnCorruptSprite(uint8 file_slot, size_t file_pos, int line)
 /**
  * Decode the image data of a single sprite.
  * @param[in,out] sprite Filled with the sprite image data.
+ * @param reader Reader positioned at the image data.
  * @param file_slot File slot.
  * @param file_pos File position.
  * @param sprite_type Type of the sprite we're decoding.
@@ -67,7 +184,7 @@ static bool WarnCorruptSprite(uint8 file_slot, size_t file_pos, int line)
  * @param container_format Container format of the GRF this sprite is in.
  * @return True if the sprite was successfully loaded.
  */
-bool DecodeSingleSprite(SpriteLoader::Sprite *sprite, uint8 file_slot, size_t file_pos, SpriteType sprite_type, int64 num, byte type, ZoomLevel zoom_lvl, byte colour_fmt, byte container_format)
+static bool DecodeSingleSprite(SpriteLoader::Sprite *sprite, SpriteDataReader &reader, uint8 file_slot, size_t file_pos, SpriteType sprite_type, int64 num, byte type, ZoomLevel zoom_lvl, byte colour_fmt, byte container_format)
 {
 	AutoFreePtr<byte> dest_orig(MallocT<byte>(num));
 	byte *dest = dest_orig;
@@ -75,24 +192,22 @@ bool DecodeSingleSprite(SpriteLoader::Sprite *sprite, uint8 file_slot, size_t fi
 
 	/* Read the file, which has some kind of compression */
 	while (num > 0) {
-		int8 code = FioReadByte();
+		int8 code = reader.ReadByte();
 
 		if (code >= 0) {
 			/* Plain bytes to read */
 			int size = (code == 0) ? 0x80 : code;
 			num -= size;
-			if (num < 0) return WarnCorruptSprite(file_slot, file_pos, __LINE__);
-			for (; size > 0; size--) {
-				*dest = FioReadByte();
-				dest++;
-			}
+			if (num < 0) return WarnCorruptSprite(reader, file_slot, file_pos, __LINE__);
+			reader.ReadBlock(dest, size);
+			dest += size;
 		} else {
 			/* Copy bytes from earlier in the sprite */
-			const uint data_offset = ((code & 7) << 8) | FioReadByte();
-			if (dest - data_offset < dest_orig) return WarnCorruptSprite(file_slot, file_pos, __LINE__);
+			const uint data_offset = ((code & 7) << 8) | reader.ReadByte();
+			if (dest - data_offset < dest_orig) return WarnCorruptSprite(reader, file_slot, file_pos, __LINE__);
 			int size = -(code >> 3);
 			num -= size;
-			if (num < 0) return WarnCorruptSprite(file_slot, file_pos, __LINE__);
+			if (num < 0) return WarnCorruptSprite(reader, file_slot, file_pos, __LINE__);
 			for (; size > 0; size--) {
 				*dest = *(dest - data_offset);
 				dest++;
@@ -100,7 +215,7 @@ bool DecodeSingleSprite(SpriteLoader::Sprite *sprite, uint8 file_slot, size_t fi
 		}
 	}
 
-	if (num != 0) return WarnCorruptSprite(file_slot, file_pos, __LINE__);
+	if (num != 0) return WarnCorruptSprite(reader, file_slot, file_pos, __LINE__);
 
 	sprite->AllocateData(zoom_lvl, sprite->width * sprite->height);
 
@@ -127,7 +242,7 @@ bool DecodeSingleSprite(SpriteLoader::Sprite *sprite, uint8 file_slot, size_t fi
 
 			do {
 				if (dest + (container_format >= 2 && sprite->width > 256 ? 4 : 2) > dest_orig + dest_size) {
-					return WarnCorruptSprite(file_slot, file_pos, __LINE__);
+					return WarnCorruptSprite(reader, file_slot, file_pos, __LINE__);
 				}
 
 				SpriteLoader::CommonPixel *data;
@@ -153,7 +268,7 @@ bool DecodeSingleSprite(SpriteLoader::Sprite *sprite, uint8 file_slot, size_t fi
 				data = &sprite->data[y * sprite->width + skip];
 
 				if (skip + length > sprite->width || dest + length * bpp > dest_orig + dest_size) {
-					return WarnCorruptSprite(file_slot, file_pos, __LINE__);
+					return WarnCorruptSprite(reader, file_slot, file_pos, __LINE__);
 				}
 
 				for (int x = 0; x < length; x++) {
@@ -179,10 +294,10 @@ bool DecodeSingleSprite(SpriteLoader::Sprite *sprite, uint8 file_slot, size_t fi
 		}
 	} else {
 		if (dest_size < sprite->width * sprite->height * bpp) {
-			return WarnCorruptSprite(file_slot, file_pos, __LINE__);
+			return WarnCorruptSprite(reader, file_slot, file_pos, __LINE__);
 		}
 
-		if (dest_size > sprite->width * sprite->height * bpp) {
+		if (dest_size > sprite->width * sprite->height * bpp && !reader.IsQuiet()) {
 			static byte warning_level = 0;
 			DEBUG(sprite, warning_level, "Ignoring " OTTD_PRINTF64 " unused extra bytes from the sprite from %s at position %i", dest_size - sprite->width * sprite->height * bpp, FioGetFilename(file_slot), (int)file_pos);
 			warning_level = 6;
@@ -215,30 +330,30 @@ bool DecodeSingleSprite(SpriteLoader::Sprite *sprite, uint8 file_slot, size_t fi
 	return true;
 }
 
-uint8 LoadSpriteV1(SpriteLoader::Sprite *sprite, uint8 file_slot, size_t file_pos, SpriteType sprite_type, bool load_32bpp)
+uint8 LoadSpriteV1(SpriteLoader::Sprite *sprite, uint8 file_slot, size_t file_pos, SpriteType sprite_type, bool load_32bpp, bool quiet)
 {
 	/* Check the requested colour depth. */
 	if (load_32bpp) return 0;
 
 	/* Open the right file and go to the correct position */
-	FioSeekToFile(file_slot, file_pos);
+	SpriteDataReader reader(file_slot, file_pos, quiet);
 
 	/* Read the size and type */
-	int num = FioReadWord();
-	byte type = FioReadByte();
+	int num = reader.ReadWord();
+	byte type = reader.ReadByte();
 
 	/* Type 0xFF indicates either a colourmap or some other non-sprite info; we do not handle them here */
 	if (type == 0xFF) return 0;
 
 	ZoomLevel zoom_lvl = (sprite_type != ST_MAPGEN) ? ZOOM_LVL_OUT_4X : ZOOM_LVL_NORMAL;
 
-	sprite[zoom_lvl].height = FioReadByte();
-	sprite[zoom_lvl].width  = FioReadWord();
-	sprite[zoom_lvl].x_offs = FioReadWord();
-	sprite[zoom_lvl].y_offs = FioReadWord();
+	sprite[zoom_lvl].height = reader.ReadByte();
+	sprite[zoom_lvl].width  = reader.ReadWord();
+	sprite[zoom_lvl].x_offs = reader.ReadWord();
+	sprite[zoom_lvl].y_offs = reader.ReadWord();
 
 	if (sprite[zoom_lvl].width > INT16_MAX) {
-		WarnCorruptSprite(file_slot, file_pos, __LINE__);
+		WarnCorruptSprite(reader, file_slot, file_pos, __LINE__);
 		return 0;
 	}
 
@@ -246,12 +361,12 @@ uint8 LoadSpriteV1(SpriteLoader::Sprite *sprite, uint8 file_slot, size_t file_po
 	 * In case it is uncompressed, the size is 'num' - 8 (header-size). */
 	num = (type & 0x02) ? sprite[zoom_lvl].width * sprite[zoom_lvl].height : num - 8;
 
-	if (DecodeSingleSprite(&sprite[zoom_lvl], file_slot, file_pos, sprite_type, num, type, zoom_lvl, SCC_PAL, 1)) return 1 << zoom_lvl;
+	if (DecodeSingleSprite(&sprite[zoom_lvl], reader, file_slot, file_pos, sprite_type, num, type, zoom_lvl, SCC_PAL, 1)) return 1 << zoom_lvl;
 
 	return 0;
 }
 
-uint8 LoadSpriteV2(SpriteLoader::Sprite *sprite, uint8 file_slot, size_t file_pos, SpriteType sprite_type, bool load_32bpp)
+uint8 LoadSpriteV2(SpriteLoader::Sprite *sprite, uint8 file_slot, size_t file_pos, SpriteType sprite_type, bool load_32bpp, bool quiet)
 {
 	static const ZoomLevel zoom_lvl_map[6] = {ZOOM_LVL_OUT_4X, ZOOM_LVL_NORMAL, ZOOM_LVL_OUT_2X, ZOOM_LVL_OUT_8X, ZOOM_LVL_OUT_16X, ZOOM_LVL_OUT_32X};
 
@@ -259,39 +374,39 @@ uint8 LoadSpriteV2(SpriteLoader::Sprite *sprite, uint8 file_slot, size_t file_po
 	if (file_pos == SIZE_MAX) return 0;
 
 	/* Open the right file and go to the correct position */
-	FioSeekToFile(file_slot, file_pos);
+	SpriteDataReader reader(file_slot, file_pos, quiet);
 
-	uint32 id = FioReadDword();
+	uint32 id = reader.ReadDword();
 
 	uint8 loaded_sprites = 0;
 	do {
-		int64 num = FioReadDword();
-		size_t start_pos = FioGetPos();
-		byte type = FioReadByte();
+		int64 num = reader.ReadDword();
+		size_t start_pos = reader.GetPos();
+		byte type = reader.ReadByte();
 
 		/* Type 0xFF indicates either a colourmap or some other non-sprite info; we do not handle them here. */
 		if (type == 0xFF) return 0;
 
 		byte colour = type & SCC_MASK;
-		byte zoom = FioReadByte();
+		byte zoom = reader.ReadByte();
 
 		if (colour != 0 && (load_32bpp ? colour != SCC_PAL : colour == SCC_PAL) && (sprite_type != ST_MAPGEN ? zoom < lengthof(zoom_lvl_map) : zoom == 0)) {
 			ZoomLevel zoom_lvl = (sprite_type != ST_MAPGEN) ? zoom_lvl_map[zoom] : ZOOM_LVL_NORMAL;
 
 			if (HasBit(loaded_sprites, zoom_lvl)) {
 				/* We already have this zoom level, skip sprite. */
-				DEBUG(sprite, 1, "Ignoring duplicate zoom level sprite %u from %s", id, FioGetFilename(file_slot));
-				FioSkipBytes(num - 2);
+				if (!reader.IsQuiet()) DEBUG(sprite, 1, "Ignoring duplicate zoom level sprite %u from %s", id, FioGetFilename(file_slot));
+				reader.SkipBytes(num - 2);
 				continue;
 			}
 
-			sprite[zoom_lvl].height = FioReadWord();
-			sprite[zoom_lvl].width  = FioReadWord();
-			sprite[zoom_lvl].x_offs = FioReadWord();
-			sprite[zoom_lvl].y_offs = FioReadWord();
+			sprite[zoom_lvl].height = reader.ReadWord();
+			sprite[zoom_lvl].width  = reader.ReadWord();
+			sprite[zoom_lvl].x_offs = reader.ReadWord();
+			sprite[zoom_lvl].y_offs = reader.ReadWord();
 
 			if (sprite[zoom_lvl].width > INT16_MAX || sprite[zoom_lvl].height > INT16_MAX) {
-				WarnCorruptSprite(file_slot, file_pos, __LINE__);
+				WarnCorruptSprite(reader, file_slot, file_pos, __LINE__);
 				return 0;
 			}
 
@@ -306,21 +421,21 @@ uint8 LoadSpriteV2(SpriteLoader::Sprite *sprite, uint8 file_slot, size_t file_po
 
 			/* For chunked encoding we store the decompressed size in the file,
 			 * otherwise we can calculate it from the image dimensions. */
-			uint decomp_size = (type & 0x08) ? FioReadDword() : sprite[zoom_lvl].width * sprite[zoom_lvl].height * bpp;
+			uint decomp_size = (type & 0x08) ? reader.ReadDword() : sprite[zoom_lvl].width * sprite[zoom_lvl].height * bpp;
 
-			bool valid = DecodeSingleSprite(&sprite[zoom_lvl], file_slot, file_pos, sprite_type, decomp_size, type, zoom_lvl, colour, 2);
-			if (FioGetPos() != start_pos + num) {
-				WarnCorruptSprite(file_slot, file_pos, __LINE__);
+			bool valid = DecodeSingleSprite(&sprite[zoom_lvl], reader, file_slot, file_pos, sprite_type, decomp_size, type, zoom_lvl, colour, 2);
+			if (reader.GetPos() != start_pos + num) {
+				WarnCorruptSprite(reader, file_slot, file_pos, __LINE__);
 				return 0;
 			}
 
 			if (valid) SetBit(loaded_sprites, zoom_lvl);
 		} else {
 			/* Not the wanted zoom level or colour depth, continue searching. */
-			FioSkipBytes(num - 2);
+			reader.SkipBytes(num - 2);
 		}
 
-	} while (FioReadDword() == id);
+	} while (reader.ReadDword() == id);
 
 	return loaded_sprites;
 }
@@ -328,8 +443,8 @@ uint8 LoadSpriteV2(SpriteLoader::Sprite *sprite, uint8 file_slot, size_t file_po
 uint8 SpriteLoaderGrf::LoadSprite(SpriteLoader::Sprite *sprite, uint8 file_slot, size_t file_pos, SpriteType sprite_type, bool load_32bpp)
 {
 	if (this->container_ver >= 2) {
-		return LoadSpriteV2(sprite, file_slot, file_pos, sprite_type, load_32bpp);
+		return LoadSpriteV2(sprite, file_slot, file_pos, sprite_type, load_32bpp, this->quiet);
 	} else {
-		return LoadSpriteV1(sprite, file_slot, file_pos, sprite_type, load_32bpp);
+		return LoadSpriteV1(sprite, file_slot, file_pos, sprite_type, load_32bpp, this->quiet);
 	}
 }
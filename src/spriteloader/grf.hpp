@@ -17,8 +17,9 @@
 /** Sprite loader for graphics coming from a (New)GRF. */
 class SpriteLoaderGrf : public SpriteLoader {
 	byte container_ver;
+	bool quiet;          ///< Whether problems with the sprites are not reported, as they are not loaded by the main thread.
 public:
-	SpriteLoaderGrf(byte container_ver) : container_ver(container_ver) {}
+	SpriteLoaderGrf(byte container_ver, bool quiet = false) : container_ver(container_ver), quiet(quiet) {}
 	uint8 LoadSprite(SpriteLoader::Sprite *sprite, uint8 file_slot, size_t file_pos, SpriteType sprite_type, bool load_32bpp);
 };
 
@@ -0,0 +1,204 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file sync_checksum.cpp Checksums of parts of the game state, to find where a desync or a replay diverges. */
+
+#include "stdafx.h"
+#include "sync_checksum.h"
+#include "map_func.h"
+#include "vehicle_base.h"
+#include "station_base.h"
+#include "cargopacket.h"
+#include "company_base.h"
+#include "linkgraph/linkgraph.h"
+
+#include "safeguards.h"
+
+/** Names of the subsystems, as shown when their checksums do not match. */
+static const char * const _sync_checksum_names[] = {
+	"map",
+	"vehicles",
+	"stations",
+	"cargo packets",
+	"companies",
+	"link graphs",
+};
+assert_compile(lengthof(_sync_checksum_names) == SCS_END);
+
+/**
+ * Mix a value into a checksum.
+ * @param checksum The checksum so far.
+ * @param value The value to add.
+ * @return The new checksum.
+ */
+static inline uint32 MixChecksum(uint32 checksum, uint32 value)
+{
+	return (checksum ^ value) * 16777619;
+}
+
+/**
+ * Mix a 64 bits value into a checksum.
+ * @param checksum The checksum so far.
+ * @param value The value to add.
+ * @return The new checksum.
+ */
+static inline uint32 MixChecksum64(uint32 checksum, int64 value)
+{
+	return MixChecksum(MixChecksum(checksum, GB(value, 0, 32)), GB(value, 32, 32));
+}
+
+/**
+ * Calculate the checksum of the map arrays.
+ * The fields are combined by value, so the checksum does not depend on the endianness.
+ * @return The checksum.
+ */
+static uint32 CalculateMapChecksum()
+{
+	uint32 checksum = 2166136261U;
+	for (TileIndex t = 0; t < MapSize(); t++) {
+		const Tile &m = _m[t];
+		checksum = MixChecksum(checksum, m.type | m.height << 8 | m.m2 << 16);
+		checksum = MixChecksum(checksum, m.m1 | m.m3 << 8 | m.m4 << 16 | m.m5 << 24);
+		checksum = MixChecksum(checksum, _me[t].m6 | _me[t].m7 << 8);
+	}
+	return checksum;
+}
+
+/**
+ * Calculate the checksum of the positions, speeds and loads of the vehicles.
+ * @return The checksum.
+ */
+static uint32 CalculateVehicleChecksum()
+{
+	uint32 checksum = 2166136261U;
+	const Vehicle *v;
+	FOR_ALL_VEHICLES(v) {
+		checksum = MixChecksum(checksum, v->index);
+		checksum = MixChecksum(checksum, v->tile);
+		checksum = MixChecksum(checksum, v->x_pos);
+		checksum = MixChecksum(checksum, v->y_pos);
+		checksum = MixChecksum(checksum, v->z_pos);
+		checksum = MixChecksum(checksum, v->cur_speed | v->progress << 16 | v->direction << 24);
+		checksum = MixChecksum(checksum, v->vehstatus);
+		checksum = MixChecksum(checksum, v->cargo.TotalCount());
+	}
+	return checksum;
+}
+
+/**
+ * Calculate the checksum of the cargo, ratings and statuses of the goods at the stations.
+ * @return The checksum.
+ */
+static uint32 CalculateStationChecksum()
+{
+	uint32 checksum = 2166136261U;
+	const Station *st;
+	FOR_ALL_STATIONS(st) {
+		checksum = MixChecksum(checksum, st->index);
+		checksum = MixChecksum(checksum, st->xy);
+		for (CargoID c = 0; c < NUM_CARGO; c++) {
+			const GoodsEntry &ge = st->goods[c];
+			checksum = MixChecksum(checksum, ge.status | ge.rating << 8 | ge.time_since_pickup << 16);
+			checksum = MixChecksum(checksum, ge.cargo.TotalCount());
+		}
+	}
+	return checksum;
+}
+
+/**
+ * Calculate the checksum of all cargo packets.
+ * @return The checksum.
+ */
+static uint32 CalculateCargoPacketChecksum()
+{
+	uint32 checksum = 2166136261U;
+	const CargoPacket *cp;
+	FOR_ALL_CARGOPACKETS(cp) {
+		checksum = MixChecksum(checksum, cp->index);
+		checksum = MixChecksum(checksum, cp->Count() | cp->DaysInTransit() << 16);
+		checksum = MixChecksum(checksum, cp->SourceStationXY());
+		checksum = MixChecksum64(checksum, cp->FeederShare());
+	}
+	return checksum;
+}
+
+/**
+ * Calculate the checksum of the finances and limits of the companies.
+ * @return The checksum.
+ */
+static uint32 CalculateCompanyChecksum()
+{
+	uint32 checksum = 2166136261U;
+	const Company *c;
+	FOR_ALL_COMPANIES(c) {
+		checksum = MixChecksum(checksum, c->index);
+		checksum = MixChecksum64(checksum, c->money);
+		checksum = MixChecksum64(checksum, c->current_loan);
+		checksum = MixChecksum64(checksum, c->cur_economy.income);
+		checksum = MixChecksum64(checksum, c->cur_economy.expenses);
+		checksum = MixChecksum(checksum, c->terraform_limit);
+		checksum = MixChecksum(checksum, c->clear_limit);
+	}
+	return checksum;
+}
+
+/**
+ * Calculate the checksum of the nodes and edges of the link graphs.
+ * @return The checksum.
+ */
+static uint32 CalculateLinkGraphChecksum()
+{
+	uint32 checksum = 2166136261U;
+	const LinkGraph *lg;
+	FOR_ALL_LINK_GRAPHS(lg) {
+		checksum = MixChecksum(checksum, lg->index);
+		checksum = MixChecksum(checksum, lg->Size());
+		for (NodeID from = 0; from < lg->Size(); from++) {
+			LinkGraph::ConstNode node = (*lg)[from];
+			checksum = MixChecksum(checksum, node.Station());
+			checksum = MixChecksum(checksum, node.Supply());
+			checksum = MixChecksum(checksum, node.Demand());
+			for (NodeID to = 0; to < lg->Size(); to++) {
+				if (node[to].Capacity() == 0) continue;
+				checksum = MixChecksum(checksum, to);
+				checksum = MixChecksum(checksum, node[to].Capacity());
+				checksum = MixChecksum(checksum, node[to].Usage());
+			}
+		}
+	}
+	return checksum;
+}
+
+/**
+ * Calculate the checksums of all subsystems of the game state.
+ * This walks the whole map and all pools, so it is only done when
+ * the server has sync checksums enabled, and only for the sync frames,
+ * or at the end of a replay benchmark.
+ * @param checksums The array to write the checksums to.
+ */
+void CalculateSyncChecksums(uint32 checksums[SCS_END])
+{
+	checksums[SCS_MAP]           = CalculateMapChecksum();
+	checksums[SCS_VEHICLES]      = CalculateVehicleChecksum();
+	checksums[SCS_STATIONS]      = CalculateStationChecksum();
+	checksums[SCS_CARGO_PACKETS] = CalculateCargoPacketChecksum();
+	checksums[SCS_COMPANIES]     = CalculateCompanyChecksum();
+	checksums[SCS_LINK_GRAPHS]   = CalculateLinkGraphChecksum();
+}
+
+/**
+ * Get the name of a subsystem that has its own sync checksum.
+ * @param subsystem The subsystem.
+ * @return The name.
+ */
+const char *GetSyncChecksumName(SyncChecksumSubsystem subsystem)
+{
+	assert(subsystem < SCS_END);
+	return _sync_checksum_names[subsystem];
+}
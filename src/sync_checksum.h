@@ -0,0 +1,29 @@
+/* $Id$ */
+
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file sync_checksum.h Checksums of parts of the game state. */
+
+#ifndef SYNC_CHECKSUM_H
+#define SYNC_CHECKSUM_H
+
+/** Parts of the game state that have their own checksum in the sync checks. */
+enum SyncChecksumSubsystem {
+	SCS_MAP,           ///< The map arrays.
+	SCS_VEHICLES,      ///< The vehicles.
+	SCS_STATIONS,      ///< The goods at the stations.
+	SCS_CARGO_PACKETS, ///< The cargo packets.
+	SCS_COMPANIES,     ///< The finances of the companies.
+	SCS_LINK_GRAPHS,   ///< The link graphs.
+	SCS_END,           ///< End marker.
+};
+
+void CalculateSyncChecksums(uint32 checksums[SCS_END]);
+const char *GetSyncChecksumName(SyncChecksumSubsystem subsystem);
+
+#endif /* SYNC_CHECKSUM_H */
@@ -18,6 +18,7 @@
 #include "object_base.h"
 #include "company_base.h"
 #include "company_func.h"
+#include "pathfinder/yapf/yapf_cache.h"
 
 #include "table/strings.h"
 
@@ -321,6 +322,8 @@ CommandCost CmdTerraformLand(TileIndex tile, DoCommandFlag flags, uint32 p1, uin
 		/* Finally mark the dirty tiles dirty */
 		for (TileIndexSet::const_iterator it = ts.dirty_tiles.begin(); it != ts.dirty_tiles.end(); it++) {
 			MarkTileDirtyByTile(*it);
+			/* road vehicles are slowed down by slopes */
+			YapfNotifyRoadLayoutChange(*it);
 
 			int height = TerraformGetHeightOfTile(&ts, *it);
 
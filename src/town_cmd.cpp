@@ -3389,11 +3389,16 @@ CommandCost CheckforTownRating(DoCommandFlag flags, Town *t, TownRatingCheckType
 	return CommandCost();
 }
 
-void TownsMonthlyLoop()
+/**
+ * Monthly update of the towns whose index belongs to the current tick.
+ * The towns are spread over the ticks of the first day of the month, so the
+ * statistics of all towns are not rotated in the same tick.
+ */
+void TownsMonthlyTick()
 {
 	Town *t;
 
-	FOR_ALL_TOWNS(t) {
+	FOR_ALL_ITEMS_STEP(Town, town_index, t, _date_fract, DAY_TICKS) {
 		if (t->road_build_months != 0) t->road_build_months--;
 
 		if (t->exclusive_counter != 0) {
@@ -3407,13 +3412,20 @@ void TownsMonthlyLoop()
 		UpdateTownCargoes(t);
 	}
 
-	UpdateTownCargoBitmap();
+	if (_date_fract == DAY_TICKS - 1) UpdateTownCargoBitmap();
 }
 
-void TownsYearlyLoop()
+/**
+ * Yearly update of the houses in the part of the map that belongs to the current tick.
+ * The map is split in as many consecutive parts as there are ticks in a day.
+ */
+void TownsYearlyTick()
 {
+	TileIndex first = (uint64)MapSize() * _date_fract / DAY_TICKS;
+	TileIndex last = (uint64)MapSize() * (_date_fract + 1) / DAY_TICKS;
+
 	/* Increment house ages */
-	for (TileIndex t = 0; t < MapSize(); t++) {
+	for (TileIndex t = first; t < last; t++) {
 		if (!IsTileType(t, MP_HOUSE)) continue;
 		IncrementHouseAge(t);
 	}
@@ -24,6 +24,7 @@
 #include "company_base.h"
 #include "core/random_func.hpp"
 #include "newgrf_generic.h"
+#include "pathfinder/yapf/yapf_cache.h"
 
 #include "table/strings.h"
 #include "table/tree_land.h"
@@ -116,6 +117,8 @@ static void PlantTreesOnTile(TileIndex tile, TreeType treetype, uint count, uint
 	}
 
 	MakeTree(tile, treetype, count, growth, ground, density);
+	/* Trees on the shore remove the water tracks of the coast. */
+	if (ground == TREE_GROUND_SHORE) YapfNotifyWaterLayoutChange(tile);
 }
 
 /**
@@ -719,7 +722,7 @@ static void TileLoop_Trees(TileIndex tile)
 			} else {
 				/* just one tree, change type into MP_CLEAR */
 				switch (GetTreeGround(tile)) {
-					case TREE_GROUND_SHORE: MakeShore(tile); break;
+					case TREE_GROUND_SHORE: MakeShore(tile); YapfNotifyWaterLayoutChange(tile); break;
 					case TREE_GROUND_GRASS: MakeClear(tile, CLEAR_GRASS, GetTreeDensity(tile)); break;
 					case TREE_GROUND_ROUGH: MakeClear(tile, CLEAR_ROUGH, 3); break;
 					case TREE_GROUND_ROUGH_SNOW: {
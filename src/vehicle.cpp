@@ -2631,10 +2631,15 @@ void Vehicle::RemoveFromShared()
 	this->previous_shared = NULL;
 }
 
-void VehiclesYearlyLoop()
+/**
+ * Yearly update of the vehicles whose index belongs to the current tick.
+ * The vehicles are spread over the ticks of the first day of the year; the
+ * group statistics and vehicle lists are updated once all of them are done.
+ */
+void VehiclesYearlyTick()
 {
 	Vehicle *v;
-	FOR_ALL_VEHICLES(v) {
+	FOR_ALL_ITEMS_STEP(Vehicle, vehicle_index, v, _date_fract, DAY_TICKS) {
 		if (v->IsPrimaryVehicle()) {
 			/* show warning if vehicle is not generating enough income last 2 years (corresponds to a red icon in the vehicle list) */
 			Money profit = v->GetDisplayProfitThisYear();
@@ -2652,6 +2657,9 @@ void VehiclesYearlyLoop()
 			SetWindowDirty(WC_VEHICLE_DETAILS, v->index);
 		}
 	}
+
+	if (_date_fract != DAY_TICKS - 1) return;
+
 	GroupStatistics::UpdateProfits();
 	SetWindowClassesDirty(WC_TRAINS_LIST);
 	SetWindowClassesDirty(WC_SHIPS_LIST);
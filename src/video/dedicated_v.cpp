@@ -278,7 +278,10 @@ void VideoDriver_Dedicated::MainLoop()
 	_current_company = _local_company = COMPANY_SPECTATOR;
 
 	/* If SwitchMode is SM_LOAD_GAME, it means that the user used the '-g' options */
-	if (_switch_mode != SM_LOAD_GAME) {
+	if (_network_relay) {
+		/* A relay gets its game from the server it is joining; it is no server itself. */
+		_is_network_server = false;
+	} else if (_switch_mode != SM_LOAD_GAME) {
 		StartNewGameWithoutGUI(GENERATE_NEW_SEED);
 		SwitchToMode(_switch_mode);
 		_switch_mode = SM_NONE;
@@ -298,12 +301,18 @@ void VideoDriver_Dedicated::MainLoop()
 
 	/* Done loading, start game! */
 
-	if (!_networking) {
+	if (!_networking && !_network_relay) {
 		DEBUG(net, 0, "Dedicated server could not be started, aborting");
 		return;
 	}
 
 	while (!_exit_game) {
+		/* Without the relayed server there is nothing to relay. */
+		if (_network_relay && _switch_mode == SM_MENU) {
+			DEBUG(net, 0, "Connection to the relayed server lost, aborting");
+			break;
+		}
+
 		uint32 prev_cur_ticks = cur_ticks; // to check for wrapping
 		InteractiveRandom(); // randomness
 
@@ -12,6 +12,8 @@
 #include "../stdafx.h"
 #include "../gfx_func.h"
 #include "../blitter/factory.hpp"
+#include "../replay.h"
+#include "../genworld.h"
 #include "null_v.h"
 
 #include "../safeguards.h"
@@ -44,6 +46,15 @@ void VideoDriver_Null::MakeDirty(int left, int top, int width, int height) {}
 
 void VideoDriver_Null::MainLoop()
 {
+	if (_replay.active) {
+		RunReplayBenchmark();
+		return;
+	}
+	if (_genworld_benchmark_maps != 0) {
+		RunGenerateWorldBenchmark();
+		return;
+	}
+
 	uint i;
 
 	for (i = 0; i < this->ticks; i++) {
@@ -84,6 +84,8 @@
 #include "linkgraph/linkgraph_gui.h"
 #include "viewport_sprite_sorter.h"
 #include "bridge_map.h"
+#include "screenshot.h"
+#include "smallmap_gui.h"
 
 #include <map>
 
@@ -1871,6 +1873,8 @@ static void MarkViewportDirty(const ViewPort *vp, int left, int top, int right,
  */
 void MarkAllViewportsDirty(int left, int top, int right, int bottom)
 {
+	MarkMapTilesDirty(left, top, right, bottom);
+
 	Window *w;
 	FOR_ALL_WINDOWS_FROM_BACK(w) {
 		ViewPort *vp = w->viewport;
@@ -1903,6 +1907,8 @@ void ConstrainAllViewportsZoom()
  */
 void MarkTileDirtyByTile(TileIndex tile, int bridge_level_offset)
 {
+	InvalidateSmallMapTile(tile);
+
 	Point pt = RemapCoords(TileX(tile) * TILE_SIZE, TileY(tile) * TILE_SIZE, TilePixelHeight(tile));
 	MarkAllViewportsDirty(
 			pt.x - MAX_TILE_EXTENT_LEFT,
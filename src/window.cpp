@@ -101,6 +101,9 @@ WindowDesc::WindowDesc(WindowPosition def_pos, const char *ini_key, int16 def_wi
 	pref_sticky(false),
 	pref_width(0),
 	pref_height(0),
+	invalidations(0),
+	coalesced(0),
+	paints(0),
 	default_width_trad(def_width_trad),
 	default_height_trad(def_height_trad)
 {
@@ -174,6 +177,31 @@ void WindowDesc::SaveToConfig()
 	delete ini;
 }
 
+/**
+ * Print how often the windows of each type were invalidated and painted.
+ */
+void WindowDesc::PrintRedrawStats()
+{
+	for (WindowDesc **it = _window_descs->Begin(); it != _window_descs->End(); ++it) {
+		const WindowDesc *desc = *it;
+		if (desc->invalidations == 0 && desc->paints == 0) continue;
+		IConsolePrintF(CC_DEFAULT, "Class %u (%s): " OTTD_PRINTF64 " invalidations, " OTTD_PRINTF64 " coalesced, " OTTD_PRINTF64 " paints",
+				desc->cls, desc->ini_key == NULL ? "-" : desc->ini_key, desc->invalidations, desc->coalesced, desc->paints);
+	}
+}
+
+/**
+ * Reset the invalidation and paint counters of all window types.
+ */
+void WindowDesc::ResetRedrawStats()
+{
+	for (WindowDesc **it = _window_descs->Begin(); it != _window_descs->End(); ++it) {
+		(*it)->invalidations = 0;
+		(*it)->coalesced = 0;
+		(*it)->paints = 0;
+	}
+}
+
 /**
  * Read default values from WindowDesc configuration an apply them to the window.
  */
@@ -578,6 +606,8 @@ void Window::SetWidgetDirty(byte widget_index) const
 {
 	/* Sometimes this function is called before the window is even fully initialized */
 	if (this->nested_array == NULL) return;
+	/* The whole window is going to be redrawn anyway. */
+	if (this->dirty_scheduled) return;
 
 	this->nested_array[widget_index]->SetDirty(this);
 }
@@ -918,6 +948,7 @@ static void DrawOverlappedWindow(Window *w, int left, int top, int right, int bo
 	dp->pitch = _screen.pitch;
 	dp->dst_ptr = BlitterFactory::GetCurrentBlitter()->MoveTo(_screen.dst_ptr, left, top);
 	dp->zoom = ZOOM_LVL_NORMAL;
+	w->window_desc->paints++;
 	w->OnPaint();
 }
 
@@ -956,6 +987,35 @@ void Window::SetDirty() const
 	SetDirtyBlocks(this->left, this->top, this->left + this->width, this->top + this->height);
 }
 
+/**
+ * Mark entire window as dirty just before the next redraw. Unlike #SetDirty
+ * repeated calls within a tick only mark the window dirty once, so this is
+ * meant for invalidations from the game state that may happen many times
+ * per tick. Do not use it when the window is moved or resized, as the area
+ * it used to cover would not be redrawn.
+ * @ingroup dirty
+ */
+void Window::ScheduleSetDirty()
+{
+	this->window_desc->invalidations++;
+	if (this->dirty_scheduled) {
+		this->window_desc->coalesced++;
+		return;
+	}
+	this->dirty_scheduled = true;
+}
+
+/**
+ * Mark the window dirty when that has been scheduled by #ScheduleSetDirty.
+ */
+void Window::ProcessScheduledDirty()
+{
+	if (!this->dirty_scheduled) return;
+
+	this->dirty_scheduled = false;
+	if (this->window_class != WC_INVALID) this->SetDirty();
+}
+
 /**
  * Re-initialize a window, and optionally change its size.
  * @param rx Horizontal resize of the window.
@@ -3046,6 +3106,7 @@ void UpdateWindows()
 			CLRBITS(w->flags, WF_WHITE_BORDER);
 			w->SetDirty();
 		}
+		w->ProcessScheduledDirty();
 	}
 
 	DrawDirtyBlocks();
@@ -3066,9 +3127,9 @@ void UpdateWindows()
  */
 void SetWindowDirty(WindowClass cls, WindowNumber number)
 {
-	const Window *w;
+	Window *w;
 	FOR_ALL_WINDOWS_FROM_BACK(w) {
-		if (w->window_class == cls && w->window_number == number) w->SetDirty();
+		if (w->window_class == cls && w->window_number == number) w->ScheduleSetDirty();
 	}
 }
 
@@ -3096,7 +3157,7 @@ void SetWindowClassesDirty(WindowClass cls)
 {
 	Window *w;
 	FOR_ALL_WINDOWS_FROM_BACK(w) {
-		if (w->window_class == cls) w->SetDirty();
+		if (w->window_class == cls) w->ScheduleSetDirty();
 	}
 }
 
@@ -3107,10 +3168,14 @@ void SetWindowClassesDirty(WindowClass cls)
  */
 void Window::InvalidateData(int data, bool gui_scope)
 {
-	this->SetDirty();
+	this->ScheduleSetDirty();
 	if (!gui_scope) {
-		/* Schedule GUI-scope invalidation for next redraw. */
-		*this->scheduled_invalidation_data.Append() = data;
+		/* Schedule GUI-scope invalidation for next redraw, unless the same
+		 * invalidation was just scheduled; running it twice in a row does not
+		 * change the outcome. */
+		if (this->scheduled_invalidation_data.Length() == 0 || this->scheduled_invalidation_data.End()[-1] != data) {
+			*this->scheduled_invalidation_data.Append() = data;
+		}
 	}
 	this->OnInvalidateData(data, gui_scope);
 }
@@ -186,11 +186,17 @@ struct WindowDesc : ZeroedMemoryAllocator {
 	int16 pref_width;              ///< User-preferred width of the window. Zero if unset.
 	int16 pref_height;             ///< User-preferred height of the window. Zero if unset.
 
+	uint64 invalidations;          ///< Number of times a window of this type was marked dirty or invalidated from outside.
+	uint64 coalesced;              ///< Number of those requests that were merged with an earlier one of the same tick.
+	uint64 paints;                 ///< Number of times (a part of) a window of this type was painted.
+
 	int16 GetDefaultWidth() const;
 	int16 GetDefaultHeight() const;
 
 	static void LoadFromConfig();
 	static void SaveToConfig();
+	static void PrintRedrawStats();
+	static void ResetRedrawStats();
 
 private:
 	int16 default_width_trad;      ///< Preferred initial width of the window (pixels at 1x zoom).
@@ -303,6 +309,7 @@ public:
 
 	WindowDesc *window_desc;    ///< Window description
 	WindowFlags flags;          ///< Window flags
+	bool dirty_scheduled;       ///< Whether the whole window is to be marked dirty before the next redraw.
 	WindowClass window_class;   ///< Window class
 	WindowNumber window_number; ///< Window number within the window class
 
@@ -513,6 +520,7 @@ public:
 	void DeleteChildWindows(WindowClass wc = WC_INVALID) const;
 
 	void SetDirty() const;
+	void ScheduleSetDirty();
 	void ReInit(int rx = 0, int ry = 0);
 
 	/** Is window shaded currently? */
@@ -526,6 +534,7 @@ public:
 	void InvalidateData(int data = 0, bool gui_scope = true);
 	void ProcessScheduledInvalidations();
 	void ProcessHighlightedInvalidations();
+	void ProcessScheduledDirty();
 
 	/*** Event handling ***/
 